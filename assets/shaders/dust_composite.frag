@@ -0,0 +1,31 @@
+#version 450
+
+layout(location = 0) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+//the dust, drawn at a reduced resolution earlier in the frame
+layout(binding = 0) uniform sampler2D u_dust;
+
+layout(push_constant) uniform Composite
+{
+	vec2 u_invFrameSize;
+	vec2 u_dustTexelSize;
+};
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	//the dust has no depth to guide the upsampling, so it is a plain tent filter over 2x2 dust pixels, built from 4
+	//bilinear taps. that hides the blocks the reduced resolution would otherwise leave at 1/4 scale:
+	vec2 uv = gl_FragCoord.xy * u_invFrameSize;
+	vec2 offset = 0.5 * u_dustTexelSize;
+
+	vec3 light = texture(u_dust, uv + vec2(-offset.x, -offset.y)).rgb +
+	             texture(u_dust, uv + vec2( offset.x, -offset.y)).rgb +
+	             texture(u_dust, uv + vec2(-offset.x,  offset.y)).rgb +
+	             texture(u_dust, uv + vec2( offset.x,  offset.y)).rgb;
+
+	o_color = vec4(0.25 * light, 0.0); //added to the frame, see _draw_create_dust_pass
+}
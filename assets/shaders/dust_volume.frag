@@ -0,0 +1,57 @@
+#version 450
+
+#define MAX_STEPS 512 //more than the diagonal of the largest grid, in voxels
+
+layout(location = 0) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+//the dust's light per voxel, resolved by dust_volume.comp
+layout(binding = 0) uniform sampler3D u_volume;
+
+layout(push_constant) uniform Params
+{
+	mat4 u_invViewProj; //without the view's translation, so it unprojects directions from the camera
+	vec4 u_camPos;
+	vec4 u_origin; //the grid's min corner and the size of its voxels
+	vec4 u_size; //voxels per axis of the grid, and of the texture
+	vec2 u_invFrameSize;
+};
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	//the viewport is flipped, so the first row is at the top:
+	vec2 uv = gl_FragCoord.xy * u_invFrameSize;
+	vec4 farPos = u_invViewProj * vec4(2.0 * uv.x - 1.0, 1.0 - 2.0 * uv.y, 0.5, 1.0);
+	vec3 dir = normalize(farPos.xyz / farPos.w);
+
+	//clip the ray to the grid, in voxels:
+	vec3 start = (u_camPos.xyz - u_origin.xyz) / u_origin.w;
+	vec3 invDir = 1.0 / dir;
+	vec3 t0 = -start * invDir;
+	vec3 t1 = (u_size.xyz - start) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+
+	float enter = max(max(max(tMin.x, tMin.y), tMin.z), 0.0);
+	float exit = min(min(tMax.x, tMax.y), tMax.z);
+	if(exit <= enter)
+		discard;
+
+	//about 1 step per voxel crossed, starting at a different offset per pixel so the steps show as noise instead of
+	//bands (interleaved gradient noise):
+	int numSteps = min(int(ceil(exit - enter)), MAX_STEPS);
+	float stepSize = (exit - enter) / float(numSteps);
+	float jitter = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+
+	vec3 light = vec3(0.0);
+	for(int i = 0; i < numSteps; i++)
+	{
+		vec3 pos = start + dir * (enter + (float(i) + jitter) * stepSize);
+		light += texture(u_volume, pos / u_size.w).rgb;
+	}
+
+	o_color = vec4(light * stepSize, 0.0); //added to the frame, see _draw_create_dust_volume
+}
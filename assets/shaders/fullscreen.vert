@@ -0,0 +1,9 @@
+#version 450
+
+//a triangle covering the whole screen, for the passes that work on every pixel (star splatting, dust composite,
+//dust volume, overdraw heatmap)
+void main()
+{
+	vec2 pos = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -16,9 +16,14 @@ layout(binding = 0) uniform Camera
 	mat4 u_viewProj;
 };
 
-layout(push_constant) uniform Model
+layout(binding = 1) uniform Params
 {
 	mat4 u_model;
+
+	vec2 u_offset;
+	int u_numCells;
+	float u_thickness;
+	float u_scroll; // in [1, 2]
 };
 
 //----------------------------------------------------------------------------//
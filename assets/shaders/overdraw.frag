@@ -0,0 +1,29 @@
+#version 450
+
+layout(location = 0) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+#define MAX_OVERDRAW 1024.0 //the count shown as white
+
+//the particle fragments blended into each pixel, counted earlier in the frame
+layout(binding = 0) uniform sampler2D u_overdraw;
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	float count = texelFetch(u_overdraw, ivec2(gl_FragCoord.xy), 0).r;
+	if(count < 0.5)
+		discard;
+
+	//counts span several orders of magnitude between the edge of the galaxy and close up dust, so the ramp is
+	//logarithmic: blue for single fragments, then cyan, green, yellow, red and white:
+	const vec3 ramp[6] = vec3[](vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 1.0), vec3(0.0, 1.0, 0.0),
+	                            vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), vec3(1.0, 1.0, 1.0));
+
+	float t = clamp(log2(count) / log2(MAX_OVERDRAW), 0.0, 1.0) * 5.0;
+	int idx = min(int(t), 4);
+
+	o_color = vec4(mix(ramp[idx], ramp[idx + 1], t - float(idx)), 1.0);
+}
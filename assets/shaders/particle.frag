@@ -2,7 +2,17 @@
 
 layout(location = 0) in vec2 a_texPos;
 layout(location = 1) in vec4 a_color;
-layout(location = 2) in flat uint a_type;
+
+//----------------------------------------------------------------------------//
+
+//mirrors DRAW_PARTICLE_*
+#define PARTICLE_STAR 0
+#define PARTICLE_DUST 1
+#define PARTICLE_H2 2
+
+layout(constant_id = 0) const bool POINT_SPRITES = false; //drawn as points, see particle_point.vert
+layout(constant_id = 1) const uint PARTICLE_TYPE = PARTICLE_STAR; //each type is drawn with its own pipeline
+layout(constant_id = 2) const bool OVERDRAW = false; //counts fragments for the overdraw view, see overdraw.frag
 
 //----------------------------------------------------------------------------//
 
@@ -12,15 +22,17 @@ layout(location = 0) out vec4 o_color;
 
 void main() 
 {
-	vec2 centeredPos = 2.0 * (a_texPos - 0.5);
+	vec2 texPos = POINT_SPRITES ? gl_PointCoord : a_texPos;
+	vec2 centeredPos = 2.0 * (texPos - 0.5);
 	
+	//the branches are resolved when the pipeline is created:
 	vec4 color = a_color;
-	if(a_type == 0) //stars
+	if(PARTICLE_TYPE == PARTICLE_STAR)
 	{
 		if(dot(centeredPos, centeredPos) > 1.0)
 			discard;
 	}
-	else if(a_type == 1) //dust
+	else if(PARTICLE_TYPE == PARTICLE_DUST)
 	{
 		color.rgb *= vec3(0.5, 0.5, 1.0);
 		color.a *= max(1.0 - length(centeredPos), 0.0);
@@ -33,5 +45,6 @@ void main()
 		color.a = dist * dist;
 	}
 
-	o_color = color;
+	//every fragment that is blended counts, however faint:
+	o_color = OVERDRAW ? vec4(1.0) : color;
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#version 430
+
+//the quad vertex buffer, indexed so that the 2 triangles share their vertices
+layout(location = 0) in vec3 a_pos;
+layout(location = 1) in vec2 a_texPos;
+
+//----------------------------------------------------------------------------//
+
+layout(location = 0) out vec2 o_texPos;
+layout(location = 1) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+//mirrors DRAW_PARTICLE_*
+#define PARTICLE_STAR 0
+#define PARTICLE_DUST 1
+
+layout(constant_id = 1) const uint PARTICLE_TYPE = PARTICLE_STAR; //each type is drawn with its own pipeline
+
+//----------------------------------------------------------------------------//
+
+//written by particle_transform.comp earlier in the frame
+struct RenderParticle
+{
+	vec4 posSize;
+	uint colorRG;
+	uint colorBA;
+	uint type;
+	uint pad;
+};
+
+//----------------------------------------------------------------------------//
+
+layout(binding = 0) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_proj;
+	mat4 u_viewProj;
+};
+
+layout(std430, binding = 1) readonly buffer RenderParticles
+{
+	RenderParticle particles[];
+};
+
+//mirrors ParticleDrawGPU
+layout(push_constant) uniform Draw
+{
+	uint u_commandIdx;
+	float u_pointScale;
+	float u_maxPointSize;
+	uint u_lastParticle; //the last index of the render buffer
+};
+
+//----------------------------------------------------------------------------//
+
+//dust is compacted to the back of the render buffer, see particle_transform.comp
+uint particle_idx(uint idx)
+{
+	return PARTICLE_TYPE == PARTICLE_DUST ? u_lastParticle - idx : idx;
+}
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	//1 instance per particle:
+	RenderParticle particle = particles[particle_idx(gl_InstanceIndex)];
+
+	vec3 camRight = vec3(u_view[0][0], u_view[1][0], u_view[2][0]);
+	vec3 camUp    = vec3(u_view[0][1], u_view[1][1], u_view[2][1]);
+	vec3 worldspacePos = particle.posSize.xyz + ((camRight * a_pos.x) + (camUp * a_pos.z)) * particle.posSize.w;
+
+	o_texPos = a_texPos;
+	o_color = vec4(unpackHalf2x16(particle.colorRG), unpackHalf2x16(particle.colorBA));
+	gl_Position = u_viewProj * vec4(worldspacePos, 1.0);
+}
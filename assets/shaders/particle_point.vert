@@ -0,0 +1,70 @@
+#version 430
+
+//----------------------------------------------------------------------------//
+
+layout(location = 0) out vec2 o_texPos; //unused, the fragment shader reads gl_PointCoord
+layout(location = 1) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+//mirrors DRAW_PARTICLE_*
+#define PARTICLE_STAR 0
+#define PARTICLE_DUST 1
+
+layout(constant_id = 1) const uint PARTICLE_TYPE = PARTICLE_STAR; //each type is drawn with its own pipeline
+
+//----------------------------------------------------------------------------//
+
+//written by particle_transform.comp earlier in the frame
+struct RenderParticle
+{
+	vec4 posSize;
+	uint colorRG;
+	uint colorBA;
+	uint type;
+	uint pad;
+};
+
+//----------------------------------------------------------------------------//
+
+layout(binding = 0) uniform Camera
+{
+	mat4 u_view;
+	mat4 u_proj;
+	mat4 u_viewProj;
+};
+
+layout(std430, binding = 1) readonly buffer RenderParticles
+{
+	RenderParticle particles[];
+};
+
+//mirrors ParticleDrawGPU
+layout(push_constant) uniform Draw
+{
+	uint u_commandIdx;
+	float u_pointScale; //pixels covered by a billboard of size 1 at depth 1
+	float u_maxPointSize; //the device's limit, larger billboards are clamped to it
+	uint u_lastParticle; //the last index of the render buffer
+};
+
+//----------------------------------------------------------------------------//
+
+//dust is compacted to the back of the render buffer, see particle_transform.comp
+uint particle_idx(uint idx)
+{
+	return PARTICLE_TYPE == PARTICLE_DUST ? u_lastParticle - idx : idx;
+}
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	//1 vertex per particle, the sprite is a screen aligned square like the billboards:
+	RenderParticle particle = particles[particle_idx(gl_VertexIndex)];
+
+	o_texPos = vec2(0.5);
+	o_color = vec4(unpackHalf2x16(particle.colorRG), unpackHalf2x16(particle.colorBA));
+	gl_Position = u_viewProj * vec4(particle.posSize.xyz, 1.0);
+	gl_PointSize = clamp(particle.posSize.w * u_pointScale / gl_Position.w, 1.0, u_maxPointSize);
+}
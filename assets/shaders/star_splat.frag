@@ -0,0 +1,30 @@
+#version 450
+
+#define SPLAT_FIXED_SCALE 4096.0 //mirrors particle_transform.comp
+
+//----------------------------------------------------------------------------//
+
+layout(location = 0) out vec4 o_color;
+
+//----------------------------------------------------------------------------//
+
+//the light of the splatted stars, written by particle_transform.comp earlier in the frame
+layout(std430, binding = 0) readonly buffer Splat
+{
+	uint splat[]; //3 fixed point channels per pixel, row by row
+};
+
+layout(push_constant) uniform Composite
+{
+	uint u_width;
+};
+
+//----------------------------------------------------------------------------//
+
+void main()
+{
+	uint idx = (uint(gl_FragCoord.y) * u_width + uint(gl_FragCoord.x)) * 3;
+	vec3 light = vec3(float(splat[idx + 0]), float(splat[idx + 1]), float(splat[idx + 2])) / SPLAT_FIXED_SCALE;
+
+	o_color = vec4(light, 0.0); //added to the frame, see _draw_create_star_splat
+}
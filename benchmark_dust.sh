@@ -0,0 +1,24 @@
+#compares the raster, compute and volume dust renderers at 1080p and 4K and at several camera distances, printing the JSON of
+#every --benchmark run. usage: sh benchmark_dust.sh [executable] [frames], run from the repository root
+
+EXECUTABLE=${1:-./build/bin/vkgalaxy}
+FRAMES=${2:-500}
+
+GREEN='\033[0;32m'
+NC='\033[0m'
+
+for WINDOW in 1920x1080 3840x2160; do
+    for DIST in 0.05 0.15 0.5 1.0; do
+        for RENDERER in raster compute volume; do
+            FLAGS=""
+            if [ "$RENDERER" = "compute" ]; then
+                FLAGS="--dust-compute"
+            elif [ "$RENDERER" = "volume" ]; then
+                FLAGS="--dust-volume 64"
+            fi
+
+            echo "${GREEN}window $WINDOW, distance $DIST, $RENDERER dust${NC}"
+            $EXECUTABLE --window $WINDOW --benchmark $FRAMES --benchmark-dist $DIST $FLAGS
+        done
+    done
+done
@@ -11,8 +11,12 @@ for /r %%i in (*) do (
 	set pathToCreate=!pathOfInput:\assets\shaders\=\assets\spirv\!
 	mkdir !pathToCreate! 2>NUL
 
+	rem mesh shaders need SPIR-V 1.4, which Vulkan 1.1 devices support through VK_KHR_spirv_1_4
+	set target=--target-env=vulkan1.1
+	if "%%~xi"==".mesh" set target=!target! --target-spv=spv1.4
+
 	echo Compiling shader %%i
-	glslc !input! -o !output!
+	glslc !target! !input! -o !output!
 )
 
 cd ../..
\ No newline at end of file
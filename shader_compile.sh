@@ -26,8 +26,14 @@ walk_dir ()
                     mkdir $OUTPUT_FILE_DIR
                 fi
 
+                #mesh shaders need SPIR-V 1.4, which Vulkan 1.1 devices support through VK_KHR_spirv_1_4:
+                TARGET="--target-env=vulkan1.1"
+                case "$INPUT_FILE" in
+                    *.mesh) TARGET="$TARGET --target-spv=spv1.4" ;;
+                esac
+
                 echo "[${NUM}] ${GREEN}Compiling shader $INPUT_FILE ${NC}"
-                glslc "$INPUT_FILE" -o "$OUTPUT_FILE"
+                glslc $TARGET "$INPUT_FILE" -o "$OUTPUT_FILE"
 
                 NUM=`expr ${#NUM} + 1`
             fi
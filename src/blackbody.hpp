@@ -0,0 +1,36 @@
+#ifndef BLACKBODY_H
+#define BLACKBODY_H
+
+#include "globals.hpp"
+#include "libs/quickmath.hpp"
+
+//----------------------------------------------------------------------------//
+
+//table of blackbody colors by temperature, built once on the host and read by the particle transform pass
+
+#define BLACKBODY_DEFAULT_RESOLUTION 200
+#define BLACKBODY_DEFAULT_MIN_TEMP 1000.0f
+#define BLACKBODY_DEFAULT_MAX_TEMP 10000.0f
+#define BLACKBODY_MAX_RESOLUTION 1000 //the table is a uniform buffer, this keeps it within the smallest allowed maxUniformBufferRange
+
+//mirrors Blackbody in particle_transform.comp (std140)
+struct BlackbodyTable
+{
+	f32 minTemp;
+	f32 maxTemp;
+	uint32 numColors;
+	uint32 pad;
+
+	qm::vec4 colors[BLACKBODY_MAX_RESOLUTION]; //color i covers the temperatures from minTemp + i * step, alpha is unused
+};
+
+//----------------------------------------------------------------------------//
+
+//resamples the reference colors (1000K to 10000K) to numColors entries spanning [minTemp, maxTemp], temperatures
+//outside of the reference range get the color of its ends
+void blackbody_table_build(BlackbodyTable* table, f32 minTemp, f32 maxTemp, uint32 numColors);
+
+//the color of a temperature, looked up the same way as color_from_temp in particle_transform.comp
+qm::vec3 blackbody_color(const BlackbodyTable* table, f32 temp);
+
+#endif
@@ -0,0 +1,419 @@
+#include "config.hpp"
+#include "blackbody.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------//
+
+#define CONFIG_DEFAULT_NUM_PARTICLES 80128
+#define CONFIG_DEFAULT_NUM_STARS 75000
+#define CONFIG_DEFAULT_SEED 0x5eed1234
+#define CONFIG_MAX_GALAXIES 256 //must not exceed DRAW_MAX_GALAXIES
+#define CONFIG_DEFAULT_WINDOW_WIDTH 1920
+#define CONFIG_DEFAULT_WINDOW_HEIGHT 1080
+#define CONFIG_MIN_DUST_VOLUME 16
+#define CONFIG_MAX_DUST_VOLUME 256
+#define CONFIG_DEFAULT_FRAMES_IN_FLIGHT 2
+#define CONFIG_MAX_FRAMES_IN_FLIGHT 4
+#define CONFIG_MAX_SWAPCHAIN_IMAGES 8
+
+static const char* CONFIG_PRIMITIVE_MODE_NAMES[CONFIG_PRIMITIVE_COUNT] = {"quads", "instanced", "points", "mesh"};
+static const char* CONFIG_PRESENT_MODE_NAMES[CONFIG_PRESENT_COUNT] = {"immediate", "mailbox", "fifo", "fifo-relaxed"};
+
+//----------------------------------------------------------------------------//
+
+static bool _config_parse_count(const char* str, uint32* count);
+static void _config_print_usage(const char* program);
+
+//----------------------------------------------------------------------------//
+
+static void _config_error_log(const char* message, const char* file, int32 line);
+#define ERROR_LOG(m) _config_error_log(m, __FILENAME__, __LINE__)
+
+//----------------------------------------------------------------------------//
+
+bool config_parse(Config* config, int argc, char** argv)
+{
+	config->numParticles = CONFIG_DEFAULT_NUM_PARTICLES;
+	config->numStars = CONFIG_DEFAULT_NUM_STARS;
+	config->seed = CONFIG_DEFAULT_SEED;
+	config->numGalaxies = 1;
+	config->windowWidth = CONFIG_DEFAULT_WINDOW_WIDTH;
+	config->windowHeight = CONFIG_DEFAULT_WINDOW_HEIGHT;
+	config->framesInFlight = CONFIG_DEFAULT_FRAMES_IN_FLIGHT;
+	config->presentMode = CONFIG_PRESENT_MAILBOX;
+	config->swapchainImages = 0;
+	config->benchCpuGen = false;
+	config->benchmarkFrames = 0;
+	config->benchmarkDist = 0.5f;
+	config->progressive = false;
+	config->particleCache = true;
+	config->lod = true;
+	config->mortonSort = false;
+	config->primitiveMode = CONFIG_PRIMITIVE_QUADS;
+	config->starSplat = false;
+	config->dustScale = 1;
+	config->dustCompute = false;
+	config->dustVolume = 0;
+	config->overdraw = false;
+	config->blackbodyResolution = BLACKBODY_DEFAULT_RESOLUTION;
+	config->blackbodyMinTemp = BLACKBODY_DEFAULT_MIN_TEMP;
+	config->blackbodyMaxTemp = BLACKBODY_DEFAULT_MAX_TEMP;
+
+	bool starsSet = false;
+
+	for(int32 i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+		{
+			_config_print_usage(argv[0]);
+			return false;
+		}
+		else if(strcmp(arg, "--particles") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->numParticles) || config->numParticles == 0)
+			{
+				ERROR_LOG("invalid particle count");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--stars") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->numStars))
+			{
+				ERROR_LOG("invalid star count");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			starsSet = true;
+			i++;
+		}
+		else if(strcmp(arg, "--seed") == 0 && value)
+		{
+			config->seed = (uint32)strtoul(value, NULL, 0);
+			i++;
+		}
+		else if(strcmp(arg, "--galaxies") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->numGalaxies) || config->numGalaxies == 0 || config->numGalaxies > CONFIG_MAX_GALAXIES)
+			{
+				ERROR_LOG("invalid galaxy count");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--window") == 0 && value)
+		{
+			//given as <width>x<height>:
+			char* end;
+			config->windowWidth = (uint32)strtoul(value, &end, 10);
+			bool valid = end != value && *end == 'x';
+			if(valid)
+			{
+				const char* heightStr = end + 1;
+				config->windowHeight = (uint32)strtoul(heightStr, &end, 10);
+				valid = end != heightStr && *end == '\0' && config->windowWidth > 0 && config->windowHeight > 0;
+			}
+
+			if(!valid)
+			{
+				ERROR_LOG("invalid window size");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--frames-in-flight") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->framesInFlight) || config->framesInFlight == 0 ||
+			   config->framesInFlight > CONFIG_MAX_FRAMES_IN_FLIGHT)
+			{
+				ERROR_LOG("invalid frames in flight");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--present-mode") == 0 && value)
+		{
+			config->presentMode = CONFIG_PRESENT_COUNT;
+			for(uint32 j = 0; j < CONFIG_PRESENT_COUNT; j++)
+				if(strcmp(value, CONFIG_PRESENT_MODE_NAMES[j]) == 0)
+					config->presentMode = j;
+
+			if(config->presentMode == CONFIG_PRESENT_COUNT)
+			{
+				ERROR_LOG("invalid present mode");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--swapchain-images") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->swapchainImages) || config->swapchainImages == 0 ||
+			   config->swapchainImages > CONFIG_MAX_SWAPCHAIN_IMAGES)
+			{
+				ERROR_LOG("invalid swapchain image count");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--low-latency") == 0)
+		{
+			//the CPU waits for each frame before recording the next, and the newest frame is shown at the next vblank:
+			config->framesInFlight = 1;
+			config->presentMode = CONFIG_PRESENT_MAILBOX;
+		}
+		else if(strcmp(arg, "--bench-cpu-gen") == 0)
+			config->benchCpuGen = true;
+		else if(strcmp(arg, "--benchmark") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->benchmarkFrames) || config->benchmarkFrames == 0)
+			{
+				ERROR_LOG("invalid benchmark frame count");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--benchmark-dist") == 0 && value)
+		{
+			char* end;
+			config->benchmarkDist = strtof(value, &end);
+			if(end == value || *end != '\0' || config->benchmarkDist <= 0.0f || config->benchmarkDist > 1.0f)
+			{
+				ERROR_LOG("invalid benchmark distance");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--progressive") == 0)
+			config->progressive = true;
+		else if(strcmp(arg, "--no-cache") == 0)
+			config->particleCache = false;
+		else if(strcmp(arg, "--no-lod") == 0)
+			config->lod = false;
+		else if(strcmp(arg, "--morton-sort") == 0)
+			config->mortonSort = true;
+		else if(strcmp(arg, "--primitive") == 0 && value)
+		{
+			config->primitiveMode = CONFIG_PRIMITIVE_COUNT;
+			for(uint32 j = 0; j < CONFIG_PRIMITIVE_COUNT; j++)
+				if(strcmp(value, CONFIG_PRIMITIVE_MODE_NAMES[j]) == 0)
+					config->primitiveMode = j;
+
+			if(config->primitiveMode == CONFIG_PRIMITIVE_COUNT)
+			{
+				ERROR_LOG("invalid primitive mode");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--star-splat") == 0)
+			config->starSplat = true;
+		else if(strcmp(arg, "--dust-scale") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->dustScale) ||
+			   (config->dustScale != 1 && config->dustScale != 2 && config->dustScale != 4))
+			{
+				ERROR_LOG("invalid dust scale");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--dust-compute") == 0)
+			config->dustCompute = true;
+		else if(strcmp(arg, "--dust-volume") == 0 && value)
+		{
+			config->dustVolume = (uint32)strtoul(value, NULL, 10);
+			if(config->dustVolume < CONFIG_MIN_DUST_VOLUME || config->dustVolume > CONFIG_MAX_DUST_VOLUME)
+			{
+				ERROR_LOG("invalid dust volume resolution");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--overdraw") == 0)
+			config->overdraw = true;
+		else if(strcmp(arg, "--blackbody-res") == 0 && value)
+		{
+			if(!_config_parse_count(value, &config->blackbodyResolution) || config->blackbodyResolution == 0 ||
+			   config->blackbodyResolution > BLACKBODY_MAX_RESOLUTION)
+			{
+				ERROR_LOG("invalid blackbody table resolution");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else if(strcmp(arg, "--blackbody-range") == 0 && value)
+		{
+			//given as <min>:<max>, in kelvin:
+			char* end;
+			config->blackbodyMinTemp = strtof(value, &end);
+			bool valid = end != value && *end == ':';
+			if(valid)
+			{
+				const char* maxStr = end + 1;
+				config->blackbodyMaxTemp = strtof(maxStr, &end);
+				valid = end != maxStr && *end == '\0' && config->blackbodyMinTemp >= 0.0f &&
+				        config->blackbodyMinTemp < config->blackbodyMaxTemp;
+			}
+
+			if(!valid)
+			{
+				ERROR_LOG("invalid blackbody temperature range");
+				_config_print_usage(argv[0]);
+				return false;
+			}
+
+			i++;
+		}
+		else
+		{
+			ERROR_LOG("unknown or incomplete argument");
+			_config_print_usage(argv[0]);
+			return false;
+		}
+	}
+
+	//keep the default star/dust ratio when only the total is given:
+	if(!starsSet)
+		config->numStars = (uint32)((uint64)config->numParticles * CONFIG_DEFAULT_NUM_STARS / CONFIG_DEFAULT_NUM_PARTICLES);
+
+	if(config->numStars > config->numParticles)
+	{
+		ERROR_LOG("star count is larger than particle count");
+		return false;
+	}
+
+	if(config->numGalaxies > config->numParticles)
+	{
+		ERROR_LOG("galaxy count is larger than particle count");
+		return false;
+	}
+
+	//the volume replaces the dust draw, which the other dust options change:
+	if(config->dustVolume != 0 && (config->dustScale != 1 || config->dustCompute))
+	{
+		ERROR_LOG("dust volume cannot be combined with a dust scale or compute dust");
+		return false;
+	}
+
+	//the heatmap counts every particle at full resolution, in its own target:
+	if(config->overdraw && (config->dustScale != 1 || config->dustCompute))
+	{
+		ERROR_LOG("overdraw view cannot be combined with a dust scale or compute dust");
+		return false;
+	}
+
+	return true;
+}
+
+const char* config_primitive_mode_name(uint32 mode)
+{
+	return mode < CONFIG_PRIMITIVE_COUNT ? CONFIG_PRIMITIVE_MODE_NAMES[mode] : "unknown";
+}
+
+const char* config_present_mode_name(uint32 mode)
+{
+	return mode < CONFIG_PRESENT_COUNT ? CONFIG_PRESENT_MODE_NAMES[mode] : "unknown";
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _config_parse_count(const char* str, uint32* count)
+{
+	char* end;
+	f64 value = strtod(str, &end);
+	if(end == str)
+		return false;
+
+	//allow shorthand suffixes like 10K, 250M:
+	if(*end == 'k' || *end == 'K')
+	{
+		value *= 1e3;
+		end++;
+	}
+	else if(*end == 'm' || *end == 'M')
+	{
+		value *= 1e6;
+		end++;
+	}
+	else if(*end == 'g' || *end == 'G')
+	{
+		value *= 1e9;
+		end++;
+	}
+
+	if(*end != '\0' || value < 0.0 || value > (f64)UINT32_MAX)
+		return false;
+
+	*count = (uint32)value;
+	return true;
+}
+
+static void _config_print_usage(const char* program)
+{
+	printf("usage: %s [options]\n", program);
+	printf("  --particles <n>  total particle count, accepts K/M/G suffixes (default %u)\n", CONFIG_DEFAULT_NUM_PARTICLES);
+	printf("  --stars <n>      how many of the particles are stars (default keeps the %u/%u ratio)\n", CONFIG_DEFAULT_NUM_STARS, CONFIG_DEFAULT_NUM_PARTICLES);
+	printf("  --seed <n>       galaxy generation seed (default 0x%x)\n", CONFIG_DEFAULT_SEED);
+	printf("  --galaxies <n>   number of galaxies in the cluster, sharing the particles evenly (default 1, at most %u)\n", CONFIG_MAX_GALAXIES);
+	printf("  --window <w>x<h> initial window size in pixels (default %ux%u)\n", CONFIG_DEFAULT_WINDOW_WIDTH, CONFIG_DEFAULT_WINDOW_HEIGHT);
+	printf("  --frames-in-flight <n>  frames recorded ahead of the GPU, 1 to %u (default %u)\n", CONFIG_MAX_FRAMES_IN_FLIGHT, CONFIG_DEFAULT_FRAMES_IN_FLIGHT);
+	printf("  --present-mode <m>  immediate, mailbox (default), fifo or fifo-relaxed, unsupported modes fall back to fifo\n");
+	printf("  --swapchain-images <n>  swapchain images, up to %u and clamped to what the surface supports (default 1 more than its minimum)\n",
+	       CONFIG_MAX_SWAPCHAIN_IMAGES);
+	printf("  --low-latency    the same as --frames-in-flight 1 --present-mode mailbox\n");
+	printf("  --bench-cpu-gen  benchmark the multithreaded CPU generator against the reference and exit\n");
+	printf("  --benchmark <n>  render n frames orbiting the galaxy, print CPU and GPU timings as JSON and exit\n");
+	printf("  --benchmark-dist <f>  camera distance of the benchmark, as a fraction of the maximum (default 0.5)\n");
+	printf("  --progressive    render right away and generate particles over the first frames, within a GPU time budget\n");
+	printf("  --no-cache       always generate particles instead of loading them from the cache/ directory\n");
+	printf("  --no-lod         draw every star by itself, even when many of them cover a single pixel\n");
+	printf("  --morton-sort    reorder the generated particles along a Morton curve of their positions\n");
+	printf("  --primitive <m>  how particles are drawn: quads (default), instanced, points or mesh\n");
+	printf("  --star-splat     splat stars smaller than 2 pixels in the transform pass instead of drawing them\n");
+	printf("  --dust-scale <n> draw dust at 1/n of the window resolution and upsample it, 1 (default), 2 or 4\n");
+	printf("  --dust-compute   draw dust with a tile binned compute pipeline instead of the rasterizer\n");
+	printf("  --dust-volume <n>  splat dust into a grid of n voxels per side (%u to %u) and raymarch it instead of drawing it\n",
+	       CONFIG_MIN_DUST_VOLUME, CONFIG_MAX_DUST_VOLUME);
+	printf("  --overdraw       debug view, show how many particle fragments cover each pixel as a heatmap\n");
+	printf("  --blackbody-res <n>  entries of the star color table (default %u, at most %u)\n", BLACKBODY_DEFAULT_RESOLUTION, BLACKBODY_MAX_RESOLUTION);
+	printf("  --blackbody-range <min:max>  temperatures covered by the star color table, in kelvin (default %.0f:%.0f)\n",
+	       BLACKBODY_DEFAULT_MIN_TEMP, BLACKBODY_DEFAULT_MAX_TEMP);
+	printf("\n");
+}
+
+//----------------------------------------------------------------------------//
+
+static void _config_error_log(const char* message, const char* file, int32 line)
+{
+	printf("CONFIG ERROR in %s at line %i - \"%s\"\n\n", file, line, message);
+}
@@ -0,0 +1,69 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "globals.hpp"
+
+//----------------------------------------------------------------------------//
+
+//how particles are turned into primitives:
+#define CONFIG_PRIMITIVE_QUADS 0 //2 triangles of 6 vertices, nothing is shared between them
+#define CONFIG_PRIMITIVE_INSTANCED 1 //1 instance of the indexed 4 vertex quad per particle
+#define CONFIG_PRIMITIVE_POINTS 2 //point sprites, sized in the vertex shader
+#define CONFIG_PRIMITIVE_MESH 3 //quads emitted by a mesh shader, falls back to CONFIG_PRIMITIVE_QUADS if unsupported
+#define CONFIG_PRIMITIVE_COUNT 4
+
+//how frames are presented, see VkPresentModeKHR:
+#define CONFIG_PRESENT_IMMEDIATE 0 //no vsync, tears
+#define CONFIG_PRESENT_MAILBOX 1 //vsync, newer frames replace queued ones, falls back to CONFIG_PRESENT_FIFO if unsupported
+#define CONFIG_PRESENT_FIFO 2 //vsync, frames queue up
+#define CONFIG_PRESENT_FIFO_RELAXED 3 //vsync, unless a frame is late, which is presented right away and tears
+#define CONFIG_PRESENT_COUNT 4
+
+//runtime settings, filled from the command line
+struct Config
+{
+	uint32 numParticles;
+	uint32 numStars;
+	uint32 seed;
+	uint32 numGalaxies; //the particles are split evenly between them
+
+	uint32 windowWidth;
+	uint32 windowHeight;
+
+	//latency against throughput, fewer frames in flight and images sample the input closer to when it is shown:
+	uint32 framesInFlight; //frames the CPU records ahead of the GPU, 1 to 4
+	uint32 presentMode; //CONFIG_PRESENT_*
+	uint32 swapchainImages; //0 for 1 more than the surface's minimum
+
+	bool benchCpuGen; //benchmark the CPU generator and exit instead of rendering
+	uint32 benchmarkFrames; //if not 0, render this many frames along a fixed camera path, print timings as JSON and exit
+	f32 benchmarkDist; //camera distance of the benchmark path, as a fraction of the maximum distance
+	bool progressive; //start rendering immediately and generate particles over the first frames
+	bool particleCache; //reuse particles generated by earlier runs
+	bool lod; //draw stars that are small on screen as aggregated impostors
+	bool mortonSort; //reorder generated particles along a Morton curve for locality
+	uint32 primitiveMode; //CONFIG_PRIMITIVE_*
+	bool starSplat; //accumulate the smallest stars into a buffer in compute instead of drawing them
+	uint32 dustScale; //1, 2 or 4, dust is drawn at 1/dustScale of the window resolution and upsampled
+	bool dustCompute; //draw dust with the tile binned compute pipeline instead of rasterizing it
+	uint32 dustVolume; //if not 0, splat dust into a grid of this many voxels per side and raymarch it instead of drawing it
+	bool overdraw; //debug view, show how many particle fragments cover each pixel as a heatmap instead of the particles
+
+	//the blackbody color table, see blackbody.hpp:
+	uint32 blackbodyResolution;
+	f32 blackbodyMinTemp;
+	f32 blackbodyMaxTemp;
+};
+
+//----------------------------------------------------------------------------//
+
+//returns false if the arguments could not be parsed, in which case the usage is printed
+bool config_parse(Config* config, int argc, char** argv);
+
+//the name of a CONFIG_PRIMITIVE_* mode, as given on the command line
+const char* config_primitive_mode_name(uint32 mode);
+
+//the name of a CONFIG_PRESENT_* mode, as given on the command line
+const char* config_present_mode_name(uint32 mode);
+
+#endif
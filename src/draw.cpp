@@ -1,4 +1,5 @@
 #include "draw.hpp"
+#include "snapshot.hpp"
 #ifdef __APPLE__
 #include <stdlib.h>
 #else
@@ -9,10 +10,48 @@
 
 //----------------------------------------------------------------------------//
 
-#define DRAW_NUM_PARTICLES 80128
-#define DRAW_NUM_STARS 75000
-
 #define DRAW_PARTICLE_WORK_GROUP_SIZE 256
+#define DRAW_PARTICLE_GEN_CHUNK_SIZE 65536 //particles generated per dispatch, must be a multiple of DRAW_PARTICLE_WORK_GROUP_SIZE
+
+#define DRAW_PARTICLE_MAX_BUFFER_SIZE (256ull * 1024 * 1024) //upper bound for a single particle chunk buffer, in bytes
+
+#define DRAW_PARTICLE_GEN_BUDGET_MS 2.0 //GPU time per frame spent on progressive generation
+#define DRAW_PARTICLE_GEN_FALLBACK_CHUNKS 4 //dispatches per frame when timestamps are unsupported
+
+#define DRAW_PARTICLE_MIN_PIXEL_SIZE 0.5f //billboards projected smaller than this are culled
+#define DRAW_STAR_SPLAT_PIXEL_SIZE 2.0f //stars projected smaller than this are splatted, if star splatting is enabled
+
+#define DRAW_DUST_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT //the dust target, the dust adds up to values far beyond 1 in places
+#define DRAW_DUST_TILE_SIZE 16 //pixels per side of the compute dust's screen tiles, mirrors dust_splat.comp
+#define DRAW_DUST_MAX_SPLATS (1024 * 1024) //visible dust particles the compute dust draws per frame, the rest are dropped
+#define DRAW_DUST_MAX_TILE_SPLATS (16 * 1024 * 1024) //entries of the tiles' splat lists, splats beyond them are dropped
+#define DRAW_DUST_SPLAT_SIZE 32 //bytes per splat, mirrors Splat in dust_splat.comp
+
+#define DRAW_DUST_VOLUME_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT //the dust volume's texture, the alpha is unused
+#define DRAW_DUST_VOLUME_GROUP_SIZE 4 //voxels per side of a resolve workgroup, mirrors dust_volume.comp
+#define DRAW_DUST_VOLUME_MAX_DRIFT 0.5f //voxels the dust may move before the volume is rebuilt
+
+#define DRAW_OVERDRAW_FORMAT VK_FORMAT_R16_SFLOAT //the overdraw view's target, counts are exact up to 2048
+
+#define DRAW_STATS_GRID 0 //the pipeline statistics queries of a frame
+#define DRAW_STATS_PARTICLES 1
+
+#define DRAW_COMMAND_SIZE 32 //bytes per indirect command in the particle draw buffer, fits the command of every primitive mode
+#define DRAW_COMMAND_H2 0 //the H2 regions of every chunk
+#define DRAW_COMMAND_LOD 1 //the LOD impostors
+#define DRAW_COMMAND_CHUNKS 2 //the first command of the chunks, which have 1 for their stars followed by 1 for their dust
+#define DRAW_PARTICLE_MESH_GROUP_SIZE 32 //particles per mesh shader workgroup, mirrors particle.mesh
+
+#define DRAW_LOD_LEVELS 13 //octree depth, the coarsest nodes are DRAW_LOD_CELL_SIZE * 2^12
+#define DRAW_LOD_TABLE_SIZE 524288 //octree nodes per frame, must be a power of 2 and a multiple of DRAW_PARTICLE_WORK_GROUP_SIZE
+#define DRAW_LOD_CELL_SIZE 1.0f //size of the finest octree nodes
+#define DRAW_LOD_PIXEL_SIZE 4.0f //stars and nodes projected smaller than this are aggregated
+
+#define DRAW_GALAXY_SPACING 2.5f //distance between neighbouring galaxies of a cluster, in galaxy radii
+#define DRAW_GALAXY_MAX_TILT 35.0f //in degrees
+
+#define DRAW_UNIFORM_RING_FRAME_SIZE 65536
+#define DRAW_UPLOAD_STAGING_SIZE (4 * 1024 * 1024)
 
 //----------------------------------------------------------------------------//
 
@@ -25,62 +64,152 @@ struct CameraGPU
 };
 
 //parameters for grid rendering
-struct GridParamsVertGPU
+struct GridParamsGPU
 {
 	qm::mat4 model;
-};
 
-//parameters for grid rendering
-struct GridParamsFragGPU
-{
 	qm::vec2 offset;
 	int32 numCells;
 	f32 thickness;
 	f32 scroll;
 };
 
-//parameters for particle vertex shader
-struct ParticleParamsVertGPU
+//parameters for the particle transform pass
+struct ParticleParamsGPU
 {
+	qm::vec4 frustumPlanes[5];
+	qm::vec4 depthPlane;
+	qm::mat4 view;
+
 	f32 time;
+	f32 timeStep;
 
-	uint32 numStars;
+	uint32 numGalaxies;
 
 	f32 starSize;
 	f32 dustSize;
 	f32 h2Size;
 
 	f32 h2Dist;
+
+	f32 projScale;
+	f32 minPixelSize;
+
+	f32 lodPixelSize;
+	f32 lodCellSize;
+
+	//see _draw_primitive_counts:
+	uint32 countField;
+	uint32 countScale;
+	uint32 meshGroupSize;
+
+	//see _draw_star_splat_active:
+	uint32 splatWidth;
+	uint32 splatHeight;
+	f32 splatPixelSize;
+	uint32 pad[3];
+
+	//see _draw_dust_volume_bounds, the voxel size is 0 if the volume is disabled:
+	qm::vec4 volumeOrigin;
+	uint32 volumeSize[3];
+	uint32 volumeBuild;
+};
+
+//push constants of the particle draws, mirrors Draw in particle.vert and the other draw shaders
+struct ParticleDrawGPU
+{
+	uint32 commandIdx;
+	f32 pointScale;
+	f32 maxPointSize;
+	uint32 lastParticle; //dust is read from the back of the render buffer, starting here
+};
+
+//output of the particle transform pass, mirrors RenderParticle in particle_transform.comp and particle.vert
+struct RenderParticleGPU
+{
+	qm::vec4 posSize;
+	uint32 colorRG;
+	uint32 colorBA;
+	uint32 type;
+	uint32 pad;
 };
 
-struct ParticleGenParamsGPU
+//range of particles handled by a single transform dispatch
+struct ParticleTransformChunkGPU
 {
-	uint32 numStars;
+	uint32 firstParticle;
+	uint32 count;
+	uint32 chunkIdx;
+	uint32 numPhases;
+	uint32 renderSize;
+};
+
+//an octree node in the LOD hash table, mirrors LodNode in particle_transform.comp and particle_lod.comp
+struct ParticleLodNodeGPU
+{
+	uint32 key;
+	uint32 count;
+
+	uint32 opacity;
+	uint32 area;
 
-	f32 maxRad;
-	f32 bulgeRad;
+	uint32 color[3];
+	uint32 pad0;
+	uint32 offset[3];
+	uint32 pad1;
+};
+
+//range of particles written by a single generation dispatch, the galaxies' parameters come from the galaxy buffer
+struct ParticleGenChunkGPU
+{
+	uint32 baseIdx;
+	uint32 count;
+	uint32 numGalaxies;
+};
 
-	f32 angleOffset;
-	f32 eccentricity;
+//push constants of the compute dust, mirrors Params in dust_splat.comp
+struct DustSplatParamsGPU
+{
+	uint32 pass; //0 projects a chunk's dust into splats, 1 scatters the splats into the tiles' lists, 2 shades the tiles
 
-	f32 baseHeight;
-	f32 height;
+	uint32 commandIdx;
+	uint32 lastParticle;
+	uint32 countField;
+	uint32 countScale;
 
-	f32 minTemp;
-	f32 maxTemp;
-	f32 dustBaseTemp;
+	uint32 width;
+	uint32 height;
+	uint32 tilesX;
+	uint32 tilesY;
 
-	f32 minStarOpacity;
-	f32 maxStarOpacity;
+	uint32 maxSplats;
+	uint32 maxTileSplats;
+};
 
-	f32 minDustOpacity;
-	f32 maxDustOpacity;
+//push constants of the dust volume's raymarch, mirrors Params in dust_volume.frag
+struct DustVolumeParamsGPU
+{
+	qm::mat4 invViewProj; //without the view's translation
+	qm::vec4 camPos;
+	qm::vec4 origin; //the grid's min corner and the size of its voxels
+	qm::vec4 size; //voxels per axis of the grid, and of the texture
+	qm::vec2 invFrameSize;
+};
 
-	f32 speed;
+//a chunk of particles being sorted, mirrors Chunk in particle_sort.comp
+struct ParticleSortChunkGPU
+{
+	uint32 firstParticle;
+	uint32 count;
+	uint32 numGalaxies;
+	uint32 pass; //0 writes the keys, 1 moves the particles into the order of the sorted keys
 };
 
 //----------------------------------------------------------------------------//
 
+static bool _draw_create_deletion_queue(DrawState* state);
+static void _draw_destroy_deletion_queue(DrawState* state);
+
 static bool _draw_create_depth_buffer(DrawState* state);
 static void _draw_destroy_depth_buffer(DrawState* state);
 
@@ -90,14 +219,35 @@ static void _draw_destroy_final_render_pass(DrawState* state);
 static bool _draw_create_framebuffers(DrawState* state);
 static void _draw_destroy_framebuffers(DrawState* state);
 
+static bool _draw_create_dust_pass(DrawState* state);
+static void _draw_destroy_dust_pass(DrawState* state);
+
+static bool _draw_create_dust_target(DrawState* state);
+static void _draw_destroy_dust_target(DrawState* state);
+
+static bool _draw_create_overdraw_pass(DrawState* state);
+static void _draw_destroy_overdraw_pass(DrawState* state);
+
+static bool _draw_create_overdraw_target(DrawState* state);
+static void _draw_destroy_overdraw_target(DrawState* state);
+
 static bool _draw_create_command_buffers(DrawState* state);
 static void _draw_destroy_command_buffers(DrawState* state);
 
 static bool _draw_create_sync_objects(DrawState* state);
 static void _draw_destroy_sync_objects(DrawState* state);
 
-static bool _draw_create_camera_buffer(DrawState* state);
-static void _draw_destroy_camera_buffer(DrawState* state);
+static bool _draw_create_uniform_ring(DrawState* state);
+static void _draw_destroy_uniform_ring(DrawState* state);
+
+static bool _draw_create_upload_context(DrawState* state);
+static void _draw_destroy_upload_context(DrawState* state);
+
+static bool _draw_create_timestamp_queries(DrawState* state);
+static void _draw_destroy_timestamp_queries(DrawState* state);
+
+static bool _draw_create_stats_queries(DrawState* state);
+static void _draw_destroy_stats_queries(DrawState* state);
 
 //----------------------------------------------------------------------------//
 
@@ -116,27 +266,91 @@ static void _draw_destroy_grid_descriptors(DrawState* state);
 
 static bool _draw_create_particle_pipeline(DrawState* state);
 static void _draw_destroy_particle_pipeline(DrawState* state);
+static bool _draw_create_particle_type_pipeline(DrawState* state, uint32 type, VkShaderModule drawModule, VkShaderModule fragModule);
+
+static bool _draw_create_particle_buffers(DrawState* state, DrawParticleSet* set);
+static void _draw_destroy_particle_buffers(DrawState* state, DrawParticleSet* set);
+
+static bool _draw_create_particle_descriptors(DrawState* state, DrawParticleSet* set);
+static void _draw_destroy_particle_descriptors(DrawState* state, DrawParticleSet* set);
+
+static bool _draw_create_particle_generator(DrawState* state);
+static void _draw_destroy_particle_generator(DrawState* state);
+
+static bool _draw_create_particle_transform_pipeline(DrawState* state);
+static void _draw_destroy_particle_transform_pipeline(DrawState* state);
+
+static bool _draw_create_particle_render_buffers(DrawState* state);
+static void _draw_destroy_particle_render_buffers(DrawState* state);
+
+static bool _draw_create_blackbody_buffer(DrawState* state, const Config* config);
+static void _draw_destroy_blackbody_buffer(DrawState* state);
+
+static bool _draw_create_star_splat(DrawState* state);
+static void _draw_destroy_star_splat(DrawState* state);
 
-static bool _draw_create_particle_buffer(DrawState* state);
-static void _draw_destroy_particle_buffer(DrawState* state);
+static bool _draw_create_dust_volume(DrawState* state);
+static void _draw_destroy_dust_volume(DrawState* state);
 
-static bool _draw_create_particle_descriptors(DrawState* state);
-static void _draw_destroy_particle_descriptors(DrawState* state);
+static bool _draw_create_particle_render_descriptors(DrawState* state);
+static void _draw_destroy_particle_render_descriptors(DrawState* state);
+
+static bool _draw_create_particle_lod(DrawState* state);
+static void _draw_destroy_particle_lod(DrawState* state);
+
+static bool _draw_create_particle_sort(DrawState* state);
+static void _draw_destroy_particle_sort(DrawState* state);
+
+static bool _draw_create_dust_compute(DrawState* state);
+static void _draw_destroy_dust_compute(DrawState* state);
+
+static bool _draw_create_dust_tiles(DrawState* state);
+static void _draw_destroy_dust_tiles(DrawState* state);
 
 //----------------------------------------------------------------------------//
 
 static bool _draw_initialize_particles(DrawState* state);
+static void _draw_layout_galaxies(DrawState* state, DrawGalaxyGPU* galaxies);
+
+static uint64 _draw_particle_snapshot_key(DrawState* state, const DrawGalaxyGPU* galaxies);
+static bool _draw_load_particle_snapshot(DrawState* state, DrawParticleSet* set);
+static void _draw_save_particle_snapshot(DrawState* state, DrawParticleSet* set);
 
 //----------------------------------------------------------------------------//
 
+static void _draw_record_galaxy_update_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer);
+static void _draw_record_particle_gen_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer, uint32 firstGenChunk, uint32 genChunkCount);
+static void _draw_record_particle_sort_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer, uint32 chunkIdx);
+static void _draw_record_progressive_gen_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 frameIndex);
+
+static void _draw_read_timestamps(DrawState* s, uint32 frameIndex);
+static void _draw_read_stats(DrawState* s, uint32 frameIndex);
+
+static void _draw_primitive_counts(DrawState* s, uint32* countField, uint32* countScale, uint32* meshGroupSize);
+static bool _draw_star_splat_active(DrawState* s);
+static void _draw_dust_volume_bounds(DrawState* s, const DrawGalaxyGPU* galaxies);
+static void _draw_frustum_planes(const qm::mat4& viewProj, qm::vec4* planes, qm::vec4* depthPlane);
+static void _draw_record_particle_transform_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer);
+
 static void _draw_record_render_pass_start_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx);
 
-static void _draw_record_particle_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx);
-static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx);
+static void _draw_record_particle_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset, bool dustPass);
+static void _draw_record_particle_draw(DrawState* s, VkCommandBuffer commandBuffer, uint32 type, VkDescriptorSet descriptorSet,
+                                       const ParticleDrawGPU* particleDraw, uint32 cameraOffset);
+static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 cameraOffset);
+static void _draw_record_star_splat_commands(DrawState* s, VkCommandBuffer commandBuffer);
+static void _draw_record_dust_pass_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset);
+static void _draw_record_dust_composite_commands(DrawState* s, VkCommandBuffer commandBuffer);
+static void _draw_record_dust_compute_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 cameraOffset);
+static void _draw_record_dust_volume_resolve_commands(DrawState* s, VkCommandBuffer commandBuffer);
+static void _draw_record_dust_volume_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer);
+static void _draw_record_overdraw_pass_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset, uint32 frameIndex);
+static void _draw_record_overdraw_heatmap_commands(DrawState* s, VkCommandBuffer commandBuffer);
 
 //----------------------------------------------------------------------------//
 
-static void _draw_window_resized(DrawState* state);
+static bool _draw_update_swapchain(DrawState* state);
+static bool _draw_window_resized(DrawState* state, uint32 width, uint32 height);
 
 //----------------------------------------------------------------------------//
 
@@ -148,21 +362,50 @@ static void _draw_error_log(const char *message, const char *file, int32 line);
 
 //----------------------------------------------------------------------------//
 
-bool draw_init(DrawState** state)
+bool draw_init(DrawState** state, const Config* config)
 {
 	*state = (DrawState* )malloc(sizeof(DrawState));
 	DrawState* s = *state;
 
+	s->numParticles = config->numParticles;
+	s->numStars = config->numStars;
+	s->seed = config->seed;
+	s->numGalaxies = config->numGalaxies;
+	s->progressiveGen = config->progressive;
+	s->particleCache = config->particleCache;
+	s->lod = config->lod;
+	s->mortonSort = config->mortonSort;
+	s->primitiveMode = config->primitiveMode;
+	s->starSplat = config->starSplat;
+	s->dustScale = config->dustScale;
+	s->dustCompute = config->dustCompute;
+	s->dustTarget = s->dustScale > 1 || s->dustCompute;
+	s->dustVolume = config->dustVolume;
+	s->overdraw = config->overdraw;
+	s->framesInFlight = config->framesInFlight;
+	s->frameIdx = 0;
+
 	//create render state:
 	//---------------
-	if(!vkh_init(&s->instance, 1920, 1080, "VkGalaxy"))
+	const VkPresentModeKHR presentModes[CONFIG_PRESENT_COUNT] = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+	                                                             VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+
+	if(!vkh_init(&s->instance, config->windowWidth, config->windowHeight, "VkGalaxy", presentModes[config->presentMode], config->swapchainImages))
 	{
 		ERROR_LOG("failed to initialize render instance");
 		return false;
 	}
 
+	//the mode in use, which differs from the requested one if that is unsupported:
+	for(uint32 i = 0; i < CONFIG_PRESENT_COUNT; i++)
+		if(presentModes[i] == s->instance->swapchainPresentMode)
+			s->presentMode = i;
+
 	//initialize objects for drawing:
 	//---------------
+	if(!_draw_create_deletion_queue(s))
+		return false;
+
 	if(!_draw_create_depth_buffer(s))
 		return false;
 
@@ -172,13 +415,34 @@ bool draw_init(DrawState** state)
 	if(!_draw_create_framebuffers(s))
 		return false;
 
+	if(!_draw_create_dust_pass(s))
+		return false;
+
+	if(!_draw_create_dust_target(s))
+		return false;
+
+	if(!_draw_create_overdraw_pass(s))
+		return false;
+
+	if(!_draw_create_overdraw_target(s))
+		return false;
+
 	if(!_draw_create_command_buffers(s))
 		return false;
 
 	if(!_draw_create_sync_objects(s))
 		return false;
 
-	if(!_draw_create_camera_buffer(s))
+	if(!_draw_create_uniform_ring(s))
+		return false;
+
+	if(!_draw_create_upload_context(s))
+		return false;
+
+	if(!_draw_create_timestamp_queries(s))
+		return false;
+
+	if(!_draw_create_stats_queries(s))
 		return false;
 
 	//initialize reusable vertex buffers:
@@ -199,10 +463,48 @@ bool draw_init(DrawState** state)
 	if(!_draw_create_particle_pipeline(s))
 		return false;
 
-	if(!_draw_create_particle_buffer(s))
+	if(!_draw_create_particle_generator(s))
+		return false;
+
+	if(!_draw_create_particle_transform_pipeline(s))
+		return false;
+
+	//only the front set is created up front, the back set is created by the first draw_regenerate:
+	for(uint32 i = 0; i < DRAW_PARTICLE_SET_COUNT; i++)
+		s->particleSets[i].created = false;
+	s->frontParticleSet = 0;
+
+	if(!_draw_create_particle_buffers(s, &s->particleSets[0]))
+		return false;
+
+	if(!_draw_create_particle_render_buffers(s))
+		return false;
+
+	if(!_draw_create_blackbody_buffer(s, config))
+		return false;
+
+	if(!_draw_create_star_splat(s))
+		return false;
+
+	if(!_draw_create_dust_volume(s))
 		return false;
 
-	if(!_draw_create_particle_descriptors(s))
+	if(!_draw_create_particle_lod(s))
+		return false;
+
+	if(!_draw_create_particle_sort(s))
+		return false;
+
+	if(!_draw_create_particle_descriptors(s, &s->particleSets[0]))
+		return false;
+
+	if(!_draw_create_particle_render_descriptors(s))
+		return false;
+
+	if(!_draw_create_dust_compute(s))
+		return false;
+
+	if(!_draw_create_dust_tiles(s))
 		return false;
 
 	if(!_draw_initialize_particles(s))
@@ -215,8 +517,25 @@ void draw_quit(DrawState* s)
 {
 	vkDeviceWaitIdle(s->instance->device);
 
-	_draw_destroy_particle_descriptors(s);
-	_draw_destroy_particle_buffer(s);
+	for(uint32 i = 0; i < DRAW_PARTICLE_SET_COUNT; i++)
+		if(s->particleSets[i].created)
+		{
+			_draw_destroy_particle_descriptors(s, &s->particleSets[i]);
+			_draw_destroy_particle_buffers(s, &s->particleSets[i]);
+		}
+
+	_draw_destroy_dust_tiles(s);
+	_draw_destroy_dust_compute(s);
+	_draw_destroy_particle_render_descriptors(s);
+	_draw_destroy_particle_sort(s);
+	_draw_destroy_particle_lod(s);
+	_draw_destroy_dust_volume(s);
+	_draw_destroy_star_splat(s);
+	_draw_destroy_blackbody_buffer(s);
+	_draw_destroy_particle_render_buffers(s);
+
+	_draw_destroy_particle_transform_pipeline(s);
+	_draw_destroy_particle_generator(s);
 	_draw_destroy_particle_pipeline(s);
 
 	_draw_destroy_grid_descriptors(s);
@@ -224,12 +543,20 @@ void draw_quit(DrawState* s)
 
 	_draw_destroy_quad_vertex_buffer(s);
 
-	_draw_destroy_camera_buffer(s);
+	_draw_destroy_stats_queries(s);
+	_draw_destroy_timestamp_queries(s);
+	_draw_destroy_upload_context(s);
+	_draw_destroy_uniform_ring(s);
 	_draw_destroy_sync_objects(s);
 	_draw_destroy_command_buffers(s);
+	_draw_destroy_overdraw_target(s);
+	_draw_destroy_overdraw_pass(s);
+	_draw_destroy_dust_target(s);
+	_draw_destroy_dust_pass(s);
 	_draw_destroy_framebuffers(s);
 	_draw_destroy_final_render_pass(s);
 	_draw_destroy_depth_buffer(s);
+	_draw_destroy_deletion_queue(s);
 
 	vkh_quit(s->instance);
 
@@ -238,22 +565,116 @@ void draw_quit(DrawState* s)
 
 //----------------------------------------------------------------------------//
 
+ParticleGenParamsGPU draw_default_gen_params(uint32 numStars, uint32 seed)
+{
+	ParticleGenParamsGPU params;
+	params.numStars = numStars;
+	params.maxRad = 3500.0f;
+	params.bulgeRad = 1250.0f;
+	params.angleOffset = 6.28f;
+	params.eccentricity = 0.85f;
+	params.baseHeight = 300.0f;
+	params.height = 250.0f;
+	params.minTemp = 3000.0f;
+	params.maxTemp = 9000.0f;
+	params.dustBaseTemp = 4000.0f;
+	params.minStarOpacity = 0.1f;
+	params.maxStarOpacity = 0.5f;
+	params.minDustOpacity = 0.01f;
+	params.maxDustOpacity = 0.05f;
+	params.speed = 10.0f;
+	params.seed = seed;
+
+	return params;
+}
+
+ParticleGenParamsGPU draw_get_gen_params(DrawState* s, uint32 galaxy)
+{
+	return s->regenGalaxies[galaxy].genParams;
+}
+
+bool draw_regenerate(DrawState* s, uint32 galaxy, const ParticleGenParamsGPU& params)
+{
+	if(galaxy >= s->numGalaxies)
+	{
+		ERROR_LOG("galaxy index out of range");
+		return false;
+	}
+
+	if(params.numStars > s->regenGalaxies[galaxy].numParticles)
+	{
+		ERROR_LOG("star count is larger than the galaxy's particle count");
+		return false;
+	}
+
+	//the back set is only created the first time, so galaxies that are never regenerated use half the memory:
+	DrawParticleSet* back = &s->particleSets[1 - s->frontParticleSet];
+	if(!back->created)
+	{
+		if(!_draw_create_particle_buffers(s, back))
+			return false;
+
+		if(!_draw_create_particle_descriptors(s, back))
+		{
+			_draw_destroy_particle_buffers(s, back);
+			return false;
+		}
+	}
+
+	//regenGalaxies always holds the latest requested galaxies, so edits to different galaxies accumulate:
+	s->regenGalaxies[galaxy].genParams = params;
+	s->regenPending = true;
+
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+
 void draw_render(DrawState* s, DrawParams* params, f32 dt)
 {
-	static uint32 frameIdx = 0;
+	uint32 frameIdx = s->frameIdx;
 
 	//wait for fences and get next swapchain image: (essentially just making sure last frame is done):
 	//---------------
 	vkWaitForFences(s->instance->device, 1, &s->inFlightFences[frameIdx], VK_TRUE, UINT64_MAX);
 
+	//nothing is drawn while the window is minimized:
+	if(!_draw_update_swapchain(s))
+		return;
+
+	//update camera buffer (the frame's ring region is no longer in use once its fence is signaled). this happens before
+	//acquiring, a frame that can't be recorded must not consume a swapchain image:
+	//---------------
+	vkh_uniform_ring_begin_frame(s->uniformRing, frameIdx);
+
+	int32 windowW, windowH;
+	glfwGetWindowSize(s->instance->window, &windowW, &windowH);
+
+	qm::mat4 view, projection;
+	view = qm::lookat(params->cam.pos, params->cam.target, params->cam.up);
+	projection = qm::perspective(params->cam.fov, (f32)windowW / (f32)windowH, 0.1f, INFINITY);
+
+	CameraGPU camBuffer;
+	camBuffer.view = view;
+	camBuffer.proj = projection;
+	camBuffer.viewProj = projection * view;
+	uint32 cameraOffset = vkh_uniform_ring_push(s->uniformRing, sizeof(CameraGPU), &camBuffer);
+	if(cameraOffset == VKH_UNIFORM_RING_FULL)
+	{
+		ERROR_LOG("no uniform ring space for the camera, skipping frame");
+		return;
+	}
+
 	uint32 imageIdx;
 	VkResult imageAquireResult = vkAcquireNextImageKHR(s->instance->device, s->instance->swapchain, UINT64_MAX,
 													   s->imageAvailableSemaphores[frameIdx], VK_NULL_HANDLE, &imageIdx);
-	if(imageAquireResult == VK_ERROR_OUT_OF_DATE_KHR || imageAquireResult == VK_SUBOPTIMAL_KHR)
+	if(imageAquireResult == VK_ERROR_OUT_OF_DATE_KHR)
 	{
-		_draw_window_resized(s);
+		s->swapchainOutdated = true;
 		return;
 	}
+	else if(imageAquireResult == VK_SUBOPTIMAL_KHR) //the image was acquired, so the frame is still drawn and presented
+		s->swapchainOutdated = true;
 	else if(imageAquireResult != VK_SUCCESS)
 	{
 		ERROR_LOG("failed to acquire swapchain image");
@@ -262,21 +683,11 @@ void draw_render(DrawState* s, DrawParams* params, f32 dt)
 
 	vkResetFences(s->instance->device, 1, &s->inFlightFences[frameIdx]);
 
-	//update camera buffer:
-	//---------------
-	int32 windowW, windowH;
-	glfwGetWindowSize(s->instance->window, &windowW, &windowH);
-
-	qm::mat4 view, projection;
-	view = qm::lookat(params->cam.pos, params->cam.target, params->cam.up);
-	projection = qm::perspective(params->cam.fov, (f32)windowW / (f32)windowH, 0.1f, INFINITY);
+	//this frame's fence was the last of the frames in flight before it, so objects retired that long ago are unused:
+	vkh_deletion_queue_next_frame(s->deletionQueue, s->instance);
 
-	CameraGPU camBuffer;
-	camBuffer.view = view;
-	camBuffer.proj = projection;
-	camBuffer.viewProj = projection * view;
-	vkh_copy_with_staging_buf(s->instance, s->cameraStagingBuffer, s->cameraStagingBufferMemory,
-									  s->cameraBuffers[frameIdx], sizeof(CameraGPU), 0, &camBuffer);
+	_draw_read_timestamps(s, frameIdx);
+	_draw_read_stats(s, frameIdx);
 
 	//start command buffer:
 	//---------------
@@ -288,22 +699,103 @@ void draw_render(DrawState* s, DrawParams* params, f32 dt)
 	vkResetCommandBuffer(s->commandBuffers[frameIdx], 0);
 	vkBeginCommandBuffer(s->commandBuffers[frameIdx], &beginInfo);
 
-	//record commands:
+	//record commands (generation first, its barrier makes the new particles visible to this frame's transform pass):
 	//---------------
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(s->commandBuffers[frameIdx], s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx, DRAW_TIMESTAMP_COUNT);
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 0);
+	}
+
+	if(s->statsQueryPool != VK_NULL_HANDLE) //outside of the render passes
+		vkCmdResetQueryPool(s->commandBuffers[frameIdx], s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIdx, DRAW_STATS_QUERY_COUNT);
+
+	_draw_record_progressive_gen_commands(s, s->commandBuffers[frameIdx], frameIdx);
+
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 1);
+
+	_draw_record_particle_transform_commands(s, &camBuffer, s->commandBuffers[frameIdx]);
+
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 2);
+
+	//the reduced resolution dust is drawn (or the dust volume resolved) before the final render pass, which adds it to the frame:
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 6);
+
+	if(s->dustCompute)
+		_draw_record_dust_compute_commands(s, s->commandBuffers[frameIdx], cameraOffset);
+	else if(s->dustVolumeBuild)
+		_draw_record_dust_volume_resolve_commands(s, s->commandBuffers[frameIdx]);
+	else if(s->dustTarget)
+		_draw_record_dust_pass_commands(s, &camBuffer, s->commandBuffers[frameIdx], cameraOffset);
+
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 7);
+
+	//in the overdraw view, the particles are counted before the final render pass, which shows the counts:
+	if(s->overdraw)
+		_draw_record_overdraw_pass_commands(s, &camBuffer, s->commandBuffers[frameIdx], cameraOffset, frameIdx);
+
 	_draw_record_render_pass_start_commands(s, s->commandBuffers[frameIdx], frameIdx, imageIdx);
 
-	_draw_record_grid_commands(s, params, s->commandBuffers[frameIdx], frameIdx, imageIdx);
-	_draw_record_particle_commands(s, params, s->commandBuffers[frameIdx], frameIdx, imageIdx);
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		vkCmdBeginQuery(s->commandBuffers[frameIdx], s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIdx + DRAW_STATS_GRID, 0);
+
+	_draw_record_grid_commands(s, params, s->commandBuffers[frameIdx], cameraOffset);
+
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		vkCmdEndQuery(s->commandBuffers[frameIdx], s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIdx + DRAW_STATS_GRID);
+
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 3);
+
+	if(s->overdraw)
+		_draw_record_overdraw_heatmap_commands(s, s->commandBuffers[frameIdx]);
+	else
+	{
+		if(s->statsQueryPool != VK_NULL_HANDLE)
+			vkCmdBeginQuery(s->commandBuffers[frameIdx], s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIdx + DRAW_STATS_PARTICLES, 0);
+
+		_draw_record_particle_commands(s, &camBuffer, s->commandBuffers[frameIdx], cameraOffset, false);
+
+		if(s->statsQueryPool != VK_NULL_HANDLE)
+			vkCmdEndQuery(s->commandBuffers[frameIdx], s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIdx + DRAW_STATS_PARTICLES);
+
+		if(_draw_star_splat_active(s))
+			_draw_record_star_splat_commands(s, s->commandBuffers[frameIdx]);
+
+		if(s->dustTarget)
+			_draw_record_dust_composite_commands(s, s->commandBuffers[frameIdx]);
+
+		if(s->dustVolume != 0)
+			_draw_record_dust_volume_commands(s, &camBuffer, s->commandBuffers[frameIdx]);
+	}
+
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		s->statsWritten[frameIdx] = true;
+
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 4);
 
 	//end command buffer:
 	//---------------
 	vkCmdEndRenderPass(s->commandBuffers[frameIdx]);
 
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(s->commandBuffers[frameIdx], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIdx + 5);
+		s->timestampsWritten[frameIdx] = true;
+	}
+
 	if(vkEndCommandBuffer(s->commandBuffers[frameIdx]) != VK_SUCCESS)
 		ERROR_LOG("failed to end command buffer");
 
-	//submit command buffer:
+	//submit command buffer (any uploads queued this frame are submitted first so they are visible to it):
 	//---------------
+	vkh_upload_flush(s->uploadContext, s->instance);
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -331,15 +823,37 @@ void draw_render(DrawState* s, DrawParams* params, f32 dt)
 
 	VkResult presentResult = vkQueuePresentKHR(s->instance->presentQueue, &presentInfo);
 	if(presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR)
-		_draw_window_resized(s);
+		s->swapchainOutdated = true;
 	else if(presentResult != VK_SUCCESS)
 		ERROR_LOG("failed to present swapchain image");
 
-	frameIdx = (frameIdx + 1) % FRAMES_IN_FLIGHT;
+	s->frameIdx = (frameIdx + 1) % s->framesInFlight;
 }
 
 //----------------------------------------------------------------------------//
 
+static bool _draw_create_deletion_queue(DrawState* s)
+{
+	s->windowExtent = s->instance->swapchainExtent;
+	s->swapchainOutdated = false;
+
+	//a frame's objects are unused once the frames in flight after it have waited on their fences. 1 more frame gives
+	//the presentation engine time to let go of the old swapchain, which no fence covers:
+	s->deletionQueue = vkh_deletion_queue_create(s->framesInFlight + 1);
+	if(!s->deletionQueue)
+	{
+		ERROR_LOG("failed to create deletion queue");
+		return false;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_deletion_queue(DrawState* s)
+{
+	vkh_deletion_queue_destroy(s->deletionQueue, s->instance);
+}
+
 static bool _draw_create_depth_buffer(DrawState* s)
 {
 	const uint32 possibleDepthFormatCount = 3;
@@ -369,14 +883,24 @@ static bool _draw_create_depth_buffer(DrawState* s)
 											 VK_SAMPLE_COUNT_1_BIT, s->depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 											 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->finalDepthMemory);
 	s->finalDepthView = vkh_create_image_view(s->instance, s->finalDepthImage, s->depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+	if(s->finalDepthMemory.memory == VK_NULL_HANDLE || s->finalDepthView == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create depth buffer");
+		return false;
+	}
 
 	return true;
 }
 
 static void _draw_destroy_depth_buffer(DrawState* s)
 {
-	vkh_destroy_image_view(s->instance, s->finalDepthView);
-	vkh_destroy_image(s->instance, s->finalDepthImage, s->finalDepthMemory);
+	vkh_retire_image_view(s->deletionQueue, s->finalDepthView);
+	vkh_retire_image(s->deletionQueue, s->finalDepthImage, &s->finalDepthMemory);
+
+	//cleared so a failed recreation leaves nothing to retire twice:
+	s->finalDepthView = VK_NULL_HANDLE;
+	s->finalDepthImage = VK_NULL_HANDLE;
+	s->finalDepthMemory = {};
 }
 
 static bool _draw_create_final_render_pass(DrawState* s)
@@ -464,7 +988,12 @@ static void _draw_destroy_final_render_pass(DrawState* s)
 static bool _draw_create_framebuffers(DrawState* s)
 {
 	s->framebufferCount = s->instance->swapchainImageCount;
-	s->framebuffers = (VkFramebuffer*)malloc(s->framebufferCount * sizeof(VkFramebuffer));
+	s->framebuffers = (VkFramebuffer*)calloc(s->framebufferCount, sizeof(VkFramebuffer));
+	if(!s->framebuffers)
+	{
+		s->framebufferCount = 0;
+		return false;
+	}
 
 	for(uint32 i = 0; i < s->framebufferCount; i++)
 	{
@@ -492,534 +1021,3181 @@ static bool _draw_create_framebuffers(DrawState* s)
 static void _draw_destroy_framebuffers(DrawState* s)
 {
 	for(uint32 i = 0; i < s->framebufferCount; i++)
-		vkDestroyFramebuffer(s->instance->device, s->framebuffers[i], NULL);
+		vkh_retire_framebuffer(s->deletionQueue, s->framebuffers[i]);
 
 	free(s->framebuffers);
+	s->framebuffers = NULL;
+	s->framebufferCount = 0;
 }
 
-static bool _draw_create_command_buffers(DrawState* s)
+static bool _draw_create_dust_pass(DrawState* s)
 {
-	VkCommandPoolCreateInfo poolInfo = {};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	poolInfo.queueFamilyIndex = s->instance->graphicsComputeFamilyIdx;
-
-	if(vkCreateCommandPool(s->instance->device, &poolInfo, nullptr, &s->commandPool) != VK_SUCCESS)
-	{
-		ERROR_LOG("failed to create command pool");
-		return false;
-	}
+	if(!s->dustTarget)
+		return true;
 
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = s->commandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = FRAMES_IN_FLIGHT;
+	//create render pass, the dust target is cleared, drawn into and then read by the composite in the final render pass:
+	//---------------
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = DRAW_DUST_FORMAT;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	if(vkAllocateCommandBuffers(s->instance->device, &allocInfo, s->commandBuffers) != VK_SUCCESS)
+	VkAttachmentReference colorAttachmentReference = {};
+	colorAttachmentReference.attachment = 0;
+	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentReference;
+
+	//the previous frame's composite has to be done reading before the target is cleared, and this frame's composite
+	//has to wait for the dust:
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = 1;
+	renderPassCreateInfo.pAttachments = &colorAttachment;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = 2;
+	renderPassCreateInfo.pDependencies = dependencies;
+
+	if(vkCreateRenderPass(s->instance->device, &renderPassCreateInfo, nullptr, &s->dustRenderPass) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust render pass");
+		return false;
+	}
+
+	//create sampler, bilinear so the composite's 4 taps cover 2x2 dust pixels each:
+	//---------------
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	if(vkCreateSampler(s->instance->device, &samplerCreateInfo, nullptr, &s->dustSampler) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust sampler");
+		return false;
+	}
+
+	//create composite pipeline:
+	//---------------
+	s->dustCompositePipeline = vkh_pipeline_create();
+	if(!s->dustCompositePipeline)
+		return false;
+
+	uint64 vertCodeSize, fragCodeSize;
+	uint32 *vertCode = vkh_load_spirv("assets/spirv/fullscreen.vert.spv", &vertCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/dust_composite.frag.spv", &fragCodeSize);
+
+	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	vkh_pipeline_set_vert_shader(s->dustCompositePipeline, vertModule);
+	vkh_pipeline_set_frag_shader(s->dustCompositePipeline, fragModule);
+
+	VkDescriptorSetLayoutBinding dustLayoutBinding = {};
+	dustLayoutBinding.binding = 0;
+	dustLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	dustLayoutBinding.descriptorCount = 1;
+	dustLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	dustLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(s->dustCompositePipeline, dustLayoutBinding);
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = 2 * sizeof(qm::vec2);
+
+	vkh_pipeline_add_push_constant(s->dustCompositePipeline, pushConstant);
+
+	vkh_pipeline_add_dynamic_state(s->dustCompositePipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(s->dustCompositePipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//the dust target already holds the blended dust, which is added like the dust itself would be, the alpha is kept:
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+	vkh_pipeline_add_color_blend_attachment(s->dustCompositePipeline, colorBlendAttachment);
+
+	vkh_pipeline_set_input_assembly_state(s->dustCompositePipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(s->dustCompositePipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(s->dustCompositePipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(s->dustCompositePipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(s->dustCompositePipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	bool pipelineGenerated = vkh_pipeline_generate(s->dustCompositePipeline, s->instance, s->finalRenderPass, 0);
+
+	vkh_free_spirv(vertCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, vertModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	return pipelineGenerated;
+}
+
+static void _draw_destroy_dust_pass(DrawState* s)
+{
+	if(!s->dustTarget)
+		return;
+
+	vkh_pipeline_cleanup(s->dustCompositePipeline, s->instance);
+	vkh_pipeline_destroy(s->dustCompositePipeline);
+
+	vkDestroySampler(s->instance->device, s->dustSampler, NULL);
+	vkDestroyRenderPass(s->instance->device, s->dustRenderPass, NULL);
+}
+
+static bool _draw_create_dust_target(DrawState* s)
+{
+	if(!s->dustTarget)
+		return true;
+
+	//create image, rounded up so no pixel of the frame is left without dust:
+	//---------------
+	s->dustExtent.width = (s->instance->swapchainExtent.width + s->dustScale - 1) / s->dustScale;
+	s->dustExtent.height = (s->instance->swapchainExtent.height + s->dustScale - 1) / s->dustScale;
+
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	if(s->dustCompute)
+		usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+
+	s->dustImage = vkh_create_image(s->instance, s->dustExtent.width, s->dustExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, DRAW_DUST_FORMAT,
+	                                VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->dustMemory);
+	s->dustView = vkh_create_image_view(s->instance, s->dustImage, DRAW_DUST_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	if(s->dustMemory.memory == VK_NULL_HANDLE || s->dustView == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create dust image");
+		return false;
+	}
+
+	//create framebuffer:
+	//---------------
+	VkFramebufferCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	createInfo.renderPass = s->dustRenderPass;
+	createInfo.attachmentCount = 1;
+	createInfo.pAttachments = &s->dustView;
+	createInfo.width = s->dustExtent.width;
+	createInfo.height = s->dustExtent.height;
+	createInfo.layers = 1;
+
+	if(vkCreateFramebuffer(s->instance->device, &createInfo, nullptr, &s->dustFramebuffer) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust framebuffer");
+		return false;
+	}
+
+	//create composite descriptor set:
+	//---------------
+	s->dustCompositeDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->dustCompositeDescriptorSets)
+		return false;
+
+	VkDescriptorImageInfo dustImageInfo = {};
+	dustImageInfo.sampler = s->dustSampler;
+	dustImageInfo.imageView = s->dustView;
+	dustImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkh_descriptor_sets_add_images(s->dustCompositeDescriptorSets, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		0, 0, 1, &dustImageInfo);
+
+	return vkh_desctiptor_sets_generate(s->dustCompositeDescriptorSets, s->instance, s->dustCompositePipeline->descriptorLayout);
+}
+
+static void _draw_destroy_dust_target(DrawState* s)
+{
+	if(!s->dustTarget)
+		return;
+
+	vkh_retire_descriptor_sets(s->deletionQueue, s->dustCompositeDescriptorSets);
+	vkh_retire_framebuffer(s->deletionQueue, s->dustFramebuffer);
+
+	vkh_retire_image_view(s->deletionQueue, s->dustView);
+	vkh_retire_image(s->deletionQueue, s->dustImage, &s->dustMemory);
+
+	s->dustCompositeDescriptorSets = NULL;
+	s->dustFramebuffer = VK_NULL_HANDLE;
+	s->dustView = VK_NULL_HANDLE;
+	s->dustImage = VK_NULL_HANDLE;
+	s->dustMemory = {};
+}
+
+static bool _draw_create_overdraw_pass(DrawState* s)
+{
+	if(!s->overdraw)
+		return true;
+
+	//create render pass, like the dust pass the target is cleared, drawn into and then read in the final render pass:
+	//---------------
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = DRAW_OVERDRAW_FORMAT;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkAttachmentReference colorAttachmentReference = {};
+	colorAttachmentReference.attachment = 0;
+	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentReference;
+
+	VkSubpassDependency dependencies[2] = {};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[0].srcAccessMask = 0;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = 1;
+	renderPassCreateInfo.pAttachments = &colorAttachment;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = 2;
+	renderPassCreateInfo.pDependencies = dependencies;
+
+	if(vkCreateRenderPass(s->instance->device, &renderPassCreateInfo, nullptr, &s->overdrawRenderPass) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create overdraw render pass");
+		return false;
+	}
+
+	//create sampler, the heatmap reads single pixels:
+	//---------------
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	if(vkCreateSampler(s->instance->device, &samplerCreateInfo, nullptr, &s->overdrawSampler) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create overdraw sampler");
+		return false;
+	}
+
+	//create heatmap pipeline:
+	//---------------
+	s->overdrawPipeline = vkh_pipeline_create();
+	if(!s->overdrawPipeline)
+		return false;
+
+	uint64 vertCodeSize, fragCodeSize;
+	uint32 *vertCode = vkh_load_spirv("assets/spirv/fullscreen.vert.spv", &vertCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/overdraw.frag.spv", &fragCodeSize);
+
+	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	vkh_pipeline_set_vert_shader(s->overdrawPipeline, vertModule);
+	vkh_pipeline_set_frag_shader(s->overdrawPipeline, fragModule);
+
+	VkDescriptorSetLayoutBinding overdrawLayoutBinding = {};
+	overdrawLayoutBinding.binding = 0;
+	overdrawLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	overdrawLayoutBinding.descriptorCount = 1;
+	overdrawLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	overdrawLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(s->overdrawPipeline, overdrawLayoutBinding);
+
+	vkh_pipeline_add_dynamic_state(s->overdrawPipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(s->overdrawPipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//the heatmap replaces the particles, pixels without any are discarded so the grid stays visible:
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+
+	vkh_pipeline_add_color_blend_attachment(s->overdrawPipeline, colorBlendAttachment);
+
+	vkh_pipeline_set_input_assembly_state(s->overdrawPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(s->overdrawPipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(s->overdrawPipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(s->overdrawPipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(s->overdrawPipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	bool pipelineGenerated = vkh_pipeline_generate(s->overdrawPipeline, s->instance, s->finalRenderPass, 0);
+
+	vkh_free_spirv(vertCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, vertModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	return pipelineGenerated;
+}
+
+static void _draw_destroy_overdraw_pass(DrawState* s)
+{
+	if(!s->overdraw)
+		return;
+
+	vkh_pipeline_cleanup(s->overdrawPipeline, s->instance);
+	vkh_pipeline_destroy(s->overdrawPipeline);
+
+	vkDestroySampler(s->instance->device, s->overdrawSampler, NULL);
+	vkDestroyRenderPass(s->instance->device, s->overdrawRenderPass, NULL);
+}
+
+static bool _draw_create_overdraw_target(DrawState* s)
+{
+	if(!s->overdraw)
+		return true;
+
+	//create image, at the full resolution so every pixel has its own count:
+	//---------------
+	VkExtent2D extent = s->instance->swapchainExtent;
+
+	s->overdrawImage = vkh_create_image(s->instance, extent.width, extent.height, 1, VK_SAMPLE_COUNT_1_BIT, DRAW_OVERDRAW_FORMAT,
+	                                    VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+	                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->overdrawMemory);
+	s->overdrawView = vkh_create_image_view(s->instance, s->overdrawImage, DRAW_OVERDRAW_FORMAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	if(s->overdrawMemory.memory == VK_NULL_HANDLE || s->overdrawView == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create overdraw image");
+		return false;
+	}
+
+	//create framebuffer:
+	//---------------
+	VkFramebufferCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	createInfo.renderPass = s->overdrawRenderPass;
+	createInfo.attachmentCount = 1;
+	createInfo.pAttachments = &s->overdrawView;
+	createInfo.width = extent.width;
+	createInfo.height = extent.height;
+	createInfo.layers = 1;
+
+	if(vkCreateFramebuffer(s->instance->device, &createInfo, nullptr, &s->overdrawFramebuffer) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create overdraw framebuffer");
+		return false;
+	}
+
+	//create heatmap descriptor set:
+	//---------------
+	s->overdrawDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->overdrawDescriptorSets)
+		return false;
+
+	VkDescriptorImageInfo overdrawImageInfo = {};
+	overdrawImageInfo.sampler = s->overdrawSampler;
+	overdrawImageInfo.imageView = s->overdrawView;
+	overdrawImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkh_descriptor_sets_add_images(s->overdrawDescriptorSets, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		0, 0, 1, &overdrawImageInfo);
+
+	return vkh_desctiptor_sets_generate(s->overdrawDescriptorSets, s->instance, s->overdrawPipeline->descriptorLayout);
+}
+
+static void _draw_destroy_overdraw_target(DrawState* s)
+{
+	if(!s->overdraw)
+		return;
+
+	vkh_retire_descriptor_sets(s->deletionQueue, s->overdrawDescriptorSets);
+	vkh_retire_framebuffer(s->deletionQueue, s->overdrawFramebuffer);
+
+	vkh_retire_image_view(s->deletionQueue, s->overdrawView);
+	vkh_retire_image(s->deletionQueue, s->overdrawImage, &s->overdrawMemory);
+
+	s->overdrawDescriptorSets = NULL;
+	s->overdrawFramebuffer = VK_NULL_HANDLE;
+	s->overdrawView = VK_NULL_HANDLE;
+	s->overdrawImage = VK_NULL_HANDLE;
+	s->overdrawMemory = {};
+}
+
+static bool _draw_create_command_buffers(DrawState* s)
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = s->instance->graphicsComputeFamilyIdx;
+
+	if(vkCreateCommandPool(s->instance->device, &poolInfo, nullptr, &s->commandPool) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create command pool");
+		return false;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = s->commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = s->framesInFlight;
+
+	s->commandBuffers = (VkCommandBuffer*)malloc(s->framesInFlight * sizeof(VkCommandBuffer));
+	if(!s->commandBuffers)
+	{
+		ERROR_LOG("failed to allocate command buffer handles");
+		return false;
+	}
+
+	if(vkAllocateCommandBuffers(s->instance->device, &allocInfo, s->commandBuffers) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to allocate command buffers");
+		return false;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_command_buffers(DrawState* s)
+{
+	vkFreeCommandBuffers(s->instance->device, s->commandPool, s->framesInFlight, s->commandBuffers);
+	vkDestroyCommandPool(s->instance->device, s->commandPool, NULL);
+
+	free(s->commandBuffers);
+}
+
+static bool _draw_create_sync_objects(DrawState* s)
+{
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	s->imageAvailableSemaphores = (VkSemaphore*)malloc(s->framesInFlight * sizeof(VkSemaphore));
+	s->renderFinishedSemaphores = (VkSemaphore*)malloc(s->framesInFlight * sizeof(VkSemaphore));
+	s->inFlightFences = (VkFence*)malloc(s->framesInFlight * sizeof(VkFence));
+	if(!s->imageAvailableSemaphores || !s->renderFinishedSemaphores || !s->inFlightFences)
+	{
+		ERROR_LOG("failed to allocate sync object handles");
+		return false;
+	}
+
+	for(uint32 i = 0; i < s->framesInFlight; i++)
+		if(vkCreateSemaphore(s->instance->device, &semaphoreInfo, NULL, &s->imageAvailableSemaphores[i]) != VK_SUCCESS ||
+			vkCreateSemaphore(s->instance->device, &semaphoreInfo, NULL, &s->renderFinishedSemaphores[i]) != VK_SUCCESS ||
+			vkCreateFence(s->instance->device, &fenceInfo, NULL, &s->inFlightFences[i]) != VK_SUCCESS)
+		{
+			ERROR_LOG("failed to create sync objects");
+			return false;
+		}
+
+	return true;
+}
+
+static void _draw_destroy_sync_objects(DrawState* s)
+{
+	for(uint32 i = 0; i < s->framesInFlight; i++)
+	{
+		vkDestroySemaphore(s->instance->device, s->imageAvailableSemaphores[i], NULL);
+		vkDestroySemaphore(s->instance->device, s->renderFinishedSemaphores[i], NULL);
+		vkDestroyFence(s->instance->device, s->inFlightFences[i], NULL);
+	}
+
+	free(s->imageAvailableSemaphores);
+	free(s->renderFinishedSemaphores);
+	free(s->inFlightFences);
+}
+
+static bool _draw_create_uniform_ring(DrawState* s)
+{
+	s->uniformRing = vkh_uniform_ring_create(s->instance, DRAW_UNIFORM_RING_FRAME_SIZE, s->framesInFlight);
+	if(!s->uniformRing)
+	{
+		ERROR_LOG("failed to create uniform ring");
+		return false;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_uniform_ring(DrawState* s)
+{
+	vkh_uniform_ring_destroy(s->uniformRing, s->instance);
+}
+
+static bool _draw_create_upload_context(DrawState* s)
+{
+	s->uploadContext = vkh_upload_context_create(s->instance, DRAW_UPLOAD_STAGING_SIZE);
+	if(!s->uploadContext)
+	{
+		ERROR_LOG("failed to create upload context");
+		return false;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_upload_context(DrawState* s)
+{
+	vkh_upload_context_destroy(s->uploadContext, s->instance);
+}
+
+static bool _draw_create_timestamp_queries(DrawState* s)
+{
+	s->timestampQueryPool = VK_NULL_HANDLE;
+	memset(&s->timings, 0, sizeof(DrawTimings));
+
+	s->timestampsWritten = (bool*)calloc(s->framesInFlight, sizeof(bool));
+	if(!s->timestampsWritten)
+	{
+		ERROR_LOG("failed to allocate timestamp flags");
+		return false;
+	}
+
+	//the timings are only informational, so a missing feature is not an error:
+	if(!s->instance->properties.limits.timestampComputeAndGraphics)
+		return true;
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = DRAW_TIMESTAMP_COUNT * s->framesInFlight;
+
+	if(vkCreateQueryPool(s->instance->device, &queryPoolInfo, NULL, &s->timestampQueryPool) != VK_SUCCESS)
+	{
+		MSG_LOG("failed to create timestamp query pool, frame timings will be unavailable");
+		s->timestampQueryPool = VK_NULL_HANDLE;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_timestamp_queries(DrawState* s)
+{
+	if(s->timestampQueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(s->instance->device, s->timestampQueryPool, NULL);
+
+	free(s->timestampsWritten);
+}
+
+static bool _draw_create_stats_queries(DrawState* s)
+{
+	s->statsQueryPool = VK_NULL_HANDLE;
+	memset(&s->stats, 0, sizeof(DrawStats));
+
+	s->statsWritten = (bool*)calloc(s->framesInFlight, sizeof(bool));
+	if(!s->statsWritten)
+	{
+		ERROR_LOG("failed to allocate statistics flags");
+		return false;
+	}
+
+	//like the timings, only informational:
+	if(!s->instance->features.pipelineStatisticsQuery)
+		return true;
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	queryPoolInfo.queryCount = DRAW_STATS_QUERY_COUNT * s->framesInFlight;
+	queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	                                   VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+	                                   VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	if(vkCreateQueryPool(s->instance->device, &queryPoolInfo, NULL, &s->statsQueryPool) != VK_SUCCESS)
+	{
+		MSG_LOG("failed to create pipeline statistics query pool, draw statistics will be unavailable");
+		s->statsQueryPool = VK_NULL_HANDLE;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_stats_queries(DrawState* s)
+{
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(s->instance->device, s->statsQueryPool, NULL);
+
+	free(s->statsWritten);
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _draw_create_quad_vertex_buffer(DrawState* s)
+{
+	Vertex verts[4] = {{{-0.5f, 0.0f, -0.5f}, {0.0f, 0.0f}}, {{0.5f, 0.0f, -0.5f}, {1.0f, 0.0f}}, {{-0.5f, 0.0f, 0.5f}, {0.0f, 1.0f}}, {{0.5f, 0.0f, 0.5f}, {1.0f, 1.0f}}};
+	uint32 indices[6] = {0, 1, 2, 1, 2, 3};
+
+	s->quadVertexBuffer = vkh_create_buffer(s->instance, sizeof(verts),
+												  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+												  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->quadVertexBufferMemory);
+	vkh_upload_buffer(s->uploadContext, s->instance, s->quadVertexBuffer, 0, sizeof(verts), verts);
+
+	s->quadIndexBuffer = vkh_create_buffer(s->instance, sizeof(indices),
+												 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+												 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->quadIndexBufferMemory);
+	vkh_upload_buffer(s->uploadContext, s->instance, s->quadIndexBuffer, 0, sizeof(indices), indices);
+
+	return true;
+}
+
+static void _draw_destroy_quad_vertex_buffer(DrawState* s)
+{
+	vkh_destroy_buffer(s->instance, s->quadVertexBuffer, &s->quadVertexBufferMemory);
+	vkh_destroy_buffer(s->instance, s->quadIndexBuffer, &s->quadIndexBufferMemory);
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _draw_create_grid_pipeline(DrawState* s)
+{
+	//create pipeline object:
+	//---------------
+	s->gridPipeline = vkh_pipeline_create();
+	if(!s->gridPipeline)
+		return false;
+
+	//set shaders:
+	//---------------
+	uint64 vertCodeSize, fragCodeSize;
+	uint32 *vertCode = vkh_load_spirv("assets/spirv/grid.vert.spv", &vertCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/grid.frag.spv", &fragCodeSize);
+
+	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	vkh_pipeline_set_vert_shader(s->gridPipeline, vertModule);
+	vkh_pipeline_set_frag_shader(s->gridPipeline, fragModule);
+
+	//add descriptor set layout bindings:
+	//---------------
+	VkDescriptorSetLayoutBinding cameraLayoutBinding = {};
+	cameraLayoutBinding.binding = 0;
+	cameraLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	cameraLayoutBinding.descriptorCount = 1;
+	cameraLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	cameraLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding paramsLayoutBinding = {};
+	paramsLayoutBinding.binding = 1;
+	paramsLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	paramsLayoutBinding.descriptorCount = 1;
+	paramsLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	paramsLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(s->gridPipeline, cameraLayoutBinding);
+	vkh_pipeline_add_desc_set_binding(s->gridPipeline, paramsLayoutBinding);
+
+	//add dynamic states:
+	//---------------
+	vkh_pipeline_add_dynamic_state(s->gridPipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(s->gridPipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//add vertex input info:
+	//---------------
+	VkVertexInputBindingDescription vertBindingDescription = {};
+	vertBindingDescription.binding = 0;
+	vertBindingDescription.stride = sizeof(Vertex);
+	vertBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	vkh_pipeline_add_vertex_input_binding(s->gridPipeline, vertBindingDescription);
+
+	VkVertexInputAttributeDescription vertPositionAttrib = {};
+	vertPositionAttrib.binding = 0;
+	vertPositionAttrib.location = 0;
+	vertPositionAttrib.format = VK_FORMAT_R32G32B32_SFLOAT;
+	vertPositionAttrib.offset = offsetof(Vertex, pos);
+
+	VkVertexInputAttributeDescription vertTexCoordAttrib = {};
+	vertTexCoordAttrib.binding = 0;
+	vertTexCoordAttrib.location = 1;
+	vertTexCoordAttrib.format = VK_FORMAT_R32G32_SFLOAT;
+	vertTexCoordAttrib.offset = offsetof(Vertex, texCoord);
+
+	vkh_pipeline_add_vertex_input_attrib(s->gridPipeline, vertPositionAttrib);
+	vkh_pipeline_add_vertex_input_attrib(s->gridPipeline, vertTexCoordAttrib);
+
+	//add color blend attachments:
+	//---------------
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	vkh_pipeline_add_color_blend_attachment(s->gridPipeline, colorBlendAttachment);
+
+	//set states:
+	//---------------
+	vkh_pipeline_set_input_assembly_state(s->gridPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(s->gridPipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(s->gridPipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(s->gridPipeline, VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(s->gridPipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	//generate pipeline:
+	//---------------
+	if(!vkh_pipeline_generate(s->gridPipeline, s->instance, s->finalRenderPass, 0))
+		return false;
+
+	//cleanup:
+	//---------------
+	vkh_free_spirv(vertCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, vertModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	return true;
+}
+
+static void _draw_destroy_grid_pipeline(DrawState* s)
+{
+	vkh_pipeline_cleanup(s->gridPipeline, s->instance);
+	vkh_pipeline_destroy(s->gridPipeline);
+}
+
+static bool _draw_create_grid_descriptors(DrawState* s)
+{
+	//every frame reads from the same uniform ring through dynamic offsets, so only 1 set is needed:
+	s->gridDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->gridDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo cameraBufferInfo = {};
+	cameraBufferInfo.buffer = s->uniformRing->buffer;
+	cameraBufferInfo.offset = 0;
+	cameraBufferInfo.range = sizeof(CameraGPU);
+
+	VkDescriptorBufferInfo paramsBufferInfo = {};
+	paramsBufferInfo.buffer = s->uniformRing->buffer;
+	paramsBufferInfo.offset = 0;
+	paramsBufferInfo.range = sizeof(GridParamsGPU);
+
+	vkh_descriptor_sets_add_buffers(s->gridDescriptorSets, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 
+		0, 0, 1, &cameraBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->gridDescriptorSets, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 
+		1, 0, 1, &paramsBufferInfo);
+
+	return vkh_desctiptor_sets_generate(s->gridDescriptorSets, s->instance, s->gridPipeline->descriptorLayout);
+}
+
+static void _draw_destroy_grid_descriptors(DrawState* s)
+{
+	vkh_descriptor_sets_cleanup(s->gridDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->gridDescriptorSets);
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _draw_create_particle_pipeline(DrawState* s)
+{
+	//fall back to quads if the primitive mode is unsupported:
+	//---------------
+	if(s->primitiveMode == CONFIG_PRIMITIVE_MESH && !s->instance->meshShaderSupported)
+	{
+		MSG_LOG("mesh shaders are unsupported, drawing particles as quads");
+		s->primitiveMode = CONFIG_PRIMITIVE_QUADS;
+	}
+
+	if(s->primitiveMode == CONFIG_PRIMITIVE_POINTS && !s->instance->features.largePoints)
+	{
+		MSG_LOG("points larger than 1 pixel are unsupported, drawing particles as quads");
+		s->primitiveMode = CONFIG_PRIMITIVE_QUADS;
+	}
+
+	bool mesh = s->primitiveMode == CONFIG_PRIMITIVE_MESH;
+	s->particleDrawStage = mesh ? VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+	//load shaders, shared by the pipelines of every type:
+	//---------------
+	const char* drawShaderPaths[CONFIG_PRIMITIVE_COUNT] = {"assets/spirv/particle.vert.spv", "assets/spirv/particle_instanced.vert.spv",
+	                                                       "assets/spirv/particle_point.vert.spv", "assets/spirv/particle.mesh.spv"};
+
+	uint64 drawCodeSize, fragCodeSize;
+	uint32 *drawCode = vkh_load_spirv(drawShaderPaths[s->primitiveMode], &drawCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/particle.frag.spv", &fragCodeSize);
+
+	VkShaderModule drawModule = vkh_create_shader_module(s->instance, drawCodeSize, drawCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	//create pipelines:
+	//---------------
+	bool result = true;
+	for(uint32 i = 0; i < DRAW_PARTICLE_TYPE_COUNT && result; i++)
+		result = _draw_create_particle_type_pipeline(s, i, drawModule, fragModule);
+
+	//cleanup:
+	//---------------
+	vkh_free_spirv(drawCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, drawModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	return result;
+}
+
+static bool _draw_create_particle_type_pipeline(DrawState* s, uint32 type, VkShaderModule drawModule, VkShaderModule fragModule)
+{
+	bool mesh = s->primitiveMode == CONFIG_PRIMITIVE_MESH;
+	VkShaderStageFlags drawStage = mesh ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT;
+
+	//create pipeline object:
+	//---------------
+	VKHgraphicsPipeline* pipeline = vkh_pipeline_create();
+	s->particlePipelines[type] = pipeline;
+	if(!pipeline)
+		return false;
+
+	//set shaders, specialized for the type so neither stage branches on it:
+	//---------------
+	if(mesh)
+		vkh_pipeline_set_mesh_shader(pipeline, drawModule);
+	else
+		vkh_pipeline_set_vert_shader(pipeline, drawModule);
+	vkh_pipeline_set_frag_shader(pipeline, fragModule);
+
+	//point sprites get their texture coordinates from the rasterizer:
+	VkBool32 pointSprites = s->primitiveMode == CONFIG_PRIMITIVE_POINTS;
+
+	struct
+	{
+		VkBool32 pointSprites;
+		uint32 type;
+		VkBool32 overdraw;
+	} specializationData = {pointSprites, type, s->overdraw};
+
+	VkSpecializationMapEntry specializationEntries[3] = {};
+	specializationEntries[0].constantID = 0;
+	specializationEntries[0].offset = 0;
+	specializationEntries[0].size = sizeof(VkBool32);
+	specializationEntries[1].constantID = 1;
+	specializationEntries[1].offset = sizeof(VkBool32);
+	specializationEntries[1].size = sizeof(uint32);
+	specializationEntries[2].constantID = 2;
+	specializationEntries[2].offset = sizeof(VkBool32) + sizeof(uint32);
+	specializationEntries[2].size = sizeof(VkBool32);
+
+	//the draw stage only has the type, unused entries are ignored:
+	VkSpecializationInfo specialization = {};
+	specialization.mapEntryCount = 3;
+	specialization.pMapEntries = specializationEntries;
+	specialization.dataSize = sizeof(specializationData);
+	specialization.pData = &specializationData;
+
+	vkh_pipeline_set_specialization(pipeline, mesh ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT, &specialization);
+	vkh_pipeline_set_specialization(pipeline, VK_SHADER_STAGE_FRAGMENT_BIT, &specialization);
+
+	//add descriptor set layout bindings (the same for every type, so the descriptor sets work with any of them):
+	//---------------
+	VkDescriptorSetLayoutBinding cameraLayoutBinding = {};
+	cameraLayoutBinding.binding = 0;
+	cameraLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	cameraLayoutBinding.descriptorCount = 1;
+	cameraLayoutBinding.stageFlags = drawStage;
+	cameraLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding particleLayoutBinding = {};
+	particleLayoutBinding.binding = 1;
+	particleLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	particleLayoutBinding.descriptorCount = 1;
+	particleLayoutBinding.stageFlags = drawStage;
+	particleLayoutBinding.pImmutableSamplers = nullptr;
+
+	//the mesh shader reads the particle counts from the draw commands:
+	VkDescriptorSetLayoutBinding drawCommandLayoutBinding = {};
+	drawCommandLayoutBinding.binding = 2;
+	drawCommandLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	drawCommandLayoutBinding.descriptorCount = 1;
+	drawCommandLayoutBinding.stageFlags = drawStage;
+	drawCommandLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(pipeline, cameraLayoutBinding);
+	vkh_pipeline_add_desc_set_binding(pipeline, particleLayoutBinding);
+	vkh_pipeline_add_desc_set_binding(pipeline, drawCommandLayoutBinding);
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = drawStage;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(ParticleDrawGPU);
+
+	vkh_pipeline_add_push_constant(pipeline, pushConstant);
+
+	//add vertex input (the instanced quads read the quad vertex buffer):
+	//---------------
+	if(s->primitiveMode == CONFIG_PRIMITIVE_INSTANCED)
+	{
+		VkVertexInputBindingDescription vertBindingDescription = {};
+		vertBindingDescription.binding = 0;
+		vertBindingDescription.stride = sizeof(Vertex);
+		vertBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		vkh_pipeline_add_vertex_input_binding(pipeline, vertBindingDescription);
+
+		VkVertexInputAttributeDescription vertPositionAttrib = {};
+		vertPositionAttrib.binding = 0;
+		vertPositionAttrib.location = 0;
+		vertPositionAttrib.format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertPositionAttrib.offset = offsetof(Vertex, pos);
+
+		VkVertexInputAttributeDescription vertTexCoordAttrib = {};
+		vertTexCoordAttrib.binding = 0;
+		vertTexCoordAttrib.location = 1;
+		vertTexCoordAttrib.format = VK_FORMAT_R32G32_SFLOAT;
+		vertTexCoordAttrib.offset = offsetof(Vertex, texCoord);
+
+		vkh_pipeline_add_vertex_input_attrib(pipeline, vertPositionAttrib);
+		vkh_pipeline_add_vertex_input_attrib(pipeline, vertTexCoordAttrib);
+	}
+
+	//add dynamic states:
+	//---------------
+	vkh_pipeline_add_dynamic_state(pipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(pipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//add color blend attachments, per type (stars, dust, H2 regions). all additive so far, which keeps the look of
+	//drawing them together. in the overdraw view every fragment adds 1 to its pixel's count instead:
+	//---------------
+	const VkBlendFactor srcColorFactors[DRAW_PARTICLE_TYPE_COUNT] = {VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_SRC_ALPHA};
+	const VkBlendFactor dstColorFactors[DRAW_PARTICLE_TYPE_COUNT] = {VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcColorBlendFactor = s->overdraw ? VK_BLEND_FACTOR_ONE : srcColorFactors[type];
+	colorBlendAttachment.dstColorBlendFactor = s->overdraw ? VK_BLEND_FACTOR_ONE : dstColorFactors[type];
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = s->overdraw ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+	vkh_pipeline_add_color_blend_attachment(pipeline, colorBlendAttachment);
+
+	//set states:
+	//---------------
+	VkPrimitiveTopology topology = pointSprites ? VK_PRIMITIVE_TOPOLOGY_POINT_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	vkh_pipeline_set_input_assembly_state(pipeline, topology, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(pipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(pipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(pipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(pipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	//generate pipeline (with a dust pass, the dust is drawn there, in the overdraw view every type is):
+	//---------------
+	VkRenderPass renderPass = type == DRAW_PARTICLE_DUST && s->dustTarget ? s->dustRenderPass : s->finalRenderPass;
+	if(s->overdraw)
+		renderPass = s->overdrawRenderPass;
+	return vkh_pipeline_generate(pipeline, s->instance, renderPass, 0);
+}
+
+static void _draw_destroy_particle_pipeline(DrawState* s)
+{
+	for(uint32 i = 0; i < DRAW_PARTICLE_TYPE_COUNT; i++)
+	{
+		vkh_pipeline_cleanup(s->particlePipelines[i], s->instance);
+		vkh_pipeline_destroy(s->particlePipelines[i]);
+	}
+}
+
+static bool _draw_create_particle_buffers(DrawState* s, DrawParticleSet* set)
+{
+	//find how many particles fit in 1 buffer:
+	//---------------
+	VkDeviceSize maxBufferSize = s->instance->properties.limits.maxStorageBufferRange;
+	if(maxBufferSize > DRAW_PARTICLE_MAX_BUFFER_SIZE)
+		maxBufferSize = DRAW_PARTICLE_MAX_BUFFER_SIZE;
+
+	//rounded down to whole generation chunks so that generation never straddles 2 buffers:
+	uint32 particlesPerBuffer = (uint32)(maxBufferSize / (DRAW_PARTICLE_GEN_CHUNK_SIZE * sizeof(GalaxyParticle))) * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+
+	//make sure every set fits in device local memory, leaving room for everything else:
+	//---------------
+	VkDeviceSize heapSize = 0;
+	for(uint32 i = 0; i < s->instance->memProperties.memoryHeapCount; i++)
+	{
+		VkMemoryHeap heap = s->instance->memProperties.memoryHeaps[i];
+		if((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > heapSize)
+			heapSize = heap.size;
+	}
+
+	uint32 numSets = 2; //this set and the render buffers, which are the same size
+	for(uint32 i = 0; i < DRAW_PARTICLE_SET_COUNT; i++)
+		if(s->particleSets[i].created)
+			numSets++;
+
+	if((VkDeviceSize)s->numParticles * (sizeof(GalaxyParticle) * numSets + sizeof(f32)) > heapSize / 4 * 3) //+ the phases
+	{
+		ERROR_LOG("particle count does not fit in device local memory");
+		return false;
+	}
+
+	//create chunks:
+	//---------------
+	set->chunkCount = (s->numParticles + particlesPerBuffer - 1) / particlesPerBuffer;
+	set->chunks = (DrawParticleChunk*)malloc(set->chunkCount * sizeof(DrawParticleChunk));
+	if(!set->chunks)
+	{
+		ERROR_LOG("failed to allocate particle chunks");
+		return false;
+	}
+
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		DrawParticleChunk* chunk = &set->chunks[i];
+		chunk->first = i * particlesPerBuffer;
+		chunk->count = s->numParticles - chunk->first < particlesPerBuffer ? s->numParticles - chunk->first : particlesPerBuffer;
+
+		//rounded up to whole generation chunks so every dispatch can be bound with the same range:
+		uint32 numGenChunks = (chunk->count + DRAW_PARTICLE_GEN_CHUNK_SIZE - 1) / DRAW_PARTICLE_GEN_CHUNK_SIZE;
+		VkDeviceSize size = (VkDeviceSize)numGenChunks * DRAW_PARTICLE_GEN_CHUNK_SIZE * sizeof(GalaxyParticle);
+
+		chunk->buffer = vkh_create_buffer(s->instance, size,
+		                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &chunk->allocation);
+	}
+
+	//create galaxy buffer:
+	//---------------
+	set->galaxies = (DrawGalaxyGPU*)malloc(s->numGalaxies * sizeof(DrawGalaxyGPU));
+	if(!set->galaxies)
+	{
+		ERROR_LOG("failed to allocate galaxies");
+		return false;
+	}
+
+	set->galaxyBuffer = vkh_create_buffer(s->instance, s->numGalaxies * sizeof(DrawGalaxyGPU),
+	                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &set->galaxyMemory);
+
+	set->genChunksDone = 0;
+	set->created = true;
+
+	return true;
+}
+
+static void _draw_destroy_particle_buffers(DrawState* s, DrawParticleSet* set)
+{
+	for(uint32 i = 0; i < set->chunkCount; i++)
+		vkh_destroy_buffer(s->instance, set->chunks[i].buffer, &set->chunks[i].allocation);
+
+	free(set->chunks);
+
+	vkh_destroy_buffer(s->instance, set->galaxyBuffer, &set->galaxyMemory);
+	free(set->galaxies);
+
+	set->created = false;
+}
+
+static bool _draw_create_particle_descriptors(DrawState* s, DrawParticleSet* set)
+{
+	//create transform sets (1 per chunk, writing to the render buffer with the same range):
+	//---------------
+	set->transformDescriptorSets = vkh_descriptor_sets_create(set->chunkCount);
+	if(!set->transformDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo galaxyBufferInfo = {};
+	galaxyBufferInfo.buffer = set->galaxyBuffer;
+	galaxyBufferInfo.offset = 0;
+	galaxyBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo paramsBufferInfo = {};
+	paramsBufferInfo.buffer = s->uniformRing->buffer;
+	paramsBufferInfo.offset = 0;
+	paramsBufferInfo.range = sizeof(ParticleParamsGPU);
+
+	VkDescriptorBufferInfo drawBufferInfo = {};
+	drawBufferInfo.buffer = s->particleDrawBuffer;
+	drawBufferInfo.offset = 0;
+	drawBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo lodNodeBufferInfo = {};
+	lodNodeBufferInfo.buffer = s->lodNodeBuffer;
+	lodNodeBufferInfo.offset = 0;
+	lodNodeBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo h2BufferInfo = {};
+	h2BufferInfo.buffer = s->particleH2Buffer;
+	h2BufferInfo.offset = 0;
+	h2BufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo blackbodyBufferInfo = {};
+	blackbodyBufferInfo.buffer = s->blackbodyBuffer;
+	blackbodyBufferInfo.offset = 0;
+	blackbodyBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo splatBufferInfo = {};
+	splatBufferInfo.buffer = s->splatBuffer;
+	splatBufferInfo.offset = 0;
+	splatBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo volumeBufferInfo = {};
+	volumeBufferInfo.buffer = s->dustVolumeBuffer;
+	volumeBufferInfo.offset = 0;
+	volumeBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo* particleBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	VkDescriptorBufferInfo* renderBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	VkDescriptorBufferInfo* phaseBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		particleBufferInfos[i].buffer = set->chunks[i].buffer;
+		particleBufferInfos[i].offset = 0;
+		particleBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		renderBufferInfos[i].buffer = s->particleRenderBuffers[i];
+		renderBufferInfos[i].offset = 0;
+		renderBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		phaseBufferInfos[i].buffer = s->particlePhaseBuffers[i];
+		phaseBufferInfos[i].offset = 0;
+		phaseBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			0, 0, 1, &particleBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1, 0, 1, &galaxyBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			2, 0, 1, &renderBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			3, 0, 1, &paramsBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			4, 0, 1, &drawBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			5, 0, 1, &phaseBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			6, 0, 1, &lodNodeBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			7, 0, 1, &h2BufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			8, 0, 1, &blackbodyBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			9, 0, 1, &splatBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->transformDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			10, 0, 1, &volumeBufferInfo);
+	}
+
+	bool result = vkh_desctiptor_sets_generate(set->transformDescriptorSets, s->instance, s->particleTransformPipeline->descriptorLayout);
+	free(particleBufferInfos);
+	free(renderBufferInfos);
+	free(phaseBufferInfos);
+
+	if(!result)
+		return false;
+
+	//create generation sets (1 per chunk):
+	//---------------
+	set->genDescriptorSets = vkh_descriptor_sets_create(set->chunkCount);
+	if(!set->genDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo* genBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		genBufferInfos[i].buffer = set->chunks[i].buffer;
+		genBufferInfos[i].offset = 0;
+		genBufferInfos[i].range = DRAW_PARTICLE_GEN_CHUNK_SIZE * sizeof(GalaxyParticle); //moved to each dispatch with the dynamic offset
+
+		vkh_descriptor_sets_add_buffers(set->genDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+			0, 0, 1, &genBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(set->genDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1, 0, 1, &galaxyBufferInfo);
+	}
+	
+	result = vkh_desctiptor_sets_generate(set->genDescriptorSets, s->instance, s->particleGenPipeline->descriptorLayout);
+	free(genBufferInfos);
+
+	if(!result)
+		return false;
+
+	//create sort sets (1 per chunk, with the render buffer of the same range as scratch space):
+	//---------------
+	set->sortDescriptorSets = NULL;
+	if(!s->mortonSort)
+		return true;
+
+	set->sortDescriptorSets = vkh_descriptor_sets_create(set->chunkCount);
+	if(!set->sortDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo keyBufferInfo = {};
+	keyBufferInfo.buffer = s->particleSort->keys;
+	keyBufferInfo.offset = 0;
+	keyBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo valueBufferInfo = {};
+	valueBufferInfo.buffer = s->particleSort->values;
+	valueBufferInfo.offset = 0;
+	valueBufferInfo.range = VK_WHOLE_SIZE;
+
+	particleBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	renderBufferInfos = (VkDescriptorBufferInfo*)malloc(set->chunkCount * sizeof(VkDescriptorBufferInfo));
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		particleBufferInfos[i].buffer = set->chunks[i].buffer;
+		particleBufferInfos[i].offset = 0;
+		particleBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		renderBufferInfos[i].buffer = s->particleRenderBuffers[i];
+		renderBufferInfos[i].offset = 0;
+		renderBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		vkh_descriptor_sets_add_buffers(set->sortDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			0, 0, 1, &particleBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(set->sortDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1, 0, 1, &galaxyBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->sortDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			2, 0, 1, &keyBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->sortDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			3, 0, 1, &valueBufferInfo);
+		vkh_descriptor_sets_add_buffers(set->sortDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			4, 0, 1, &renderBufferInfos[i]);
+	}
+
+	result = vkh_desctiptor_sets_generate(set->sortDescriptorSets, s->instance, s->particleSortPipeline->descriptorLayout);
+	free(particleBufferInfos);
+	free(renderBufferInfos);
+
+	return result;
+}
+
+static void _draw_destroy_particle_descriptors(DrawState* s, DrawParticleSet* set)
+{
+	if(set->sortDescriptorSets)
+	{
+		vkh_descriptor_sets_cleanup(set->sortDescriptorSets, s->instance);
+		vkh_descriptor_sets_destroy(set->sortDescriptorSets);
+	}
+
+	vkh_descriptor_sets_cleanup(set->genDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(set->genDescriptorSets);
+
+	vkh_descriptor_sets_cleanup(set->transformDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(set->transformDescriptorSets);
+}
+
+static bool _draw_create_particle_render_buffers(DrawState* s)
+{
+	//1 per chunk with the same ranges, so every set can be transformed into them (RenderParticleGPU is the same size
+	//as GalaxyParticle, so the chunks fit the same storage buffer range):
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
+
+	s->particleRenderChunkCount = set->chunkCount;
+	s->particleRenderBuffers = (VkBuffer*)malloc(s->particleRenderChunkCount * sizeof(VkBuffer));
+	s->particleRenderMemory = (VKHallocation*)malloc(s->particleRenderChunkCount * sizeof(VKHallocation));
+	s->particlePhaseBuffers = (VkBuffer*)malloc(s->particleRenderChunkCount * sizeof(VkBuffer));
+	s->particlePhaseMemory = (VKHallocation*)malloc(s->particleRenderChunkCount * sizeof(VKHallocation));
+	if(!s->particleRenderBuffers || !s->particleRenderMemory || !s->particlePhaseBuffers || !s->particlePhaseMemory)
+	{
+		ERROR_LOG("failed to allocate particle render buffers");
+		return false;
+	}
+
+	for(uint32 i = 0; i < s->particleRenderChunkCount; i++)
+	{
+		//also the scratch space of the Morton sort, which copies the sorted particles back from them:
+		s->particleRenderBuffers[i] = vkh_create_buffer(s->instance, (VkDeviceSize)set->chunks[i].count * sizeof(RenderParticleGPU),
+		                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->particleRenderMemory[i]);
+
+		s->particlePhaseBuffers[i] = vkh_create_buffer(s->instance, (VkDeviceSize)set->chunks[i].count * sizeof(f32),
+		                                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		                                               &s->particlePhaseMemory[i]);
+	}
+
+	//the phases are initialized by the first transform pass that sees each particle:
+	s->particlePhaseChunks = 0;
+	s->particleTime = 0.0;
+
+	//create H2 buffer, every galaxy has at most 1 H2 region per DRAW_PARTICLE_H2_INTERVAL particles, rounded up:
+	//---------------
+	uint32 maxH2 = s->numParticles / DRAW_PARTICLE_H2_INTERVAL + DRAW_MAX_GALAXIES;
+	if((VkDeviceSize)maxH2 * sizeof(RenderParticleGPU) > s->instance->properties.limits.maxStorageBufferRange)
+	{
+		ERROR_LOG("too many particles for the H2 buffer");
+		return false;
+	}
+
+	s->particleH2Buffer = vkh_create_buffer(s->instance, (VkDeviceSize)maxH2 * sizeof(RenderParticleGPU), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->particleH2Memory);
+
+	//create indirect draw buffer (only the counts change after this):
+	//---------------
+	uint32 drawCommandCount = DRAW_COMMAND_CHUNKS + s->particleRenderChunkCount * 2;
+	s->particleDrawBuffer = vkh_create_buffer(s->instance, drawCommandCount * DRAW_COMMAND_SIZE,
+	                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+	                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->particleDrawMemory);
+
+	uint32 commandFields = DRAW_COMMAND_SIZE / sizeof(uint32);
+	uint32* drawCommands = (uint32*)calloc(drawCommandCount, DRAW_COMMAND_SIZE);
+	if(!drawCommands)
+	{
+		ERROR_LOG("failed to allocate particle draw commands");
+		return false;
+	}
+
+	//the fields the counts are not written to:
+	for(uint32 i = 0; i < drawCommandCount; i++)
+	{
+		uint32* command = &drawCommands[i * commandFields];
+		switch(s->primitiveMode)
+		{
+		case CONFIG_PRIMITIVE_INSTANCED: //VkDrawIndexedIndirectCommand
+			command[0] = 6; //indexCount
+			break;
+		case CONFIG_PRIMITIVE_MESH: //VkDrawMeshTasksIndirectCommandEXT, followed by the particle count
+			command[1] = 1; //groupCountY
+			command[2] = 1; //groupCountZ
+			break;
+		default: //VkDrawIndirectCommand
+			command[1] = 1; //instanceCount
+			break;
+		}
+	}
+
+	vkh_upload_buffer(s->uploadContext, s->instance, s->particleDrawBuffer, 0, drawCommandCount * DRAW_COMMAND_SIZE, drawCommands);
+	free(drawCommands);
+
+	return true;
+}
+
+static void _draw_destroy_particle_render_buffers(DrawState* s)
+{
+	vkh_destroy_buffer(s->instance, s->particleDrawBuffer, &s->particleDrawMemory);
+	vkh_destroy_buffer(s->instance, s->particleH2Buffer, &s->particleH2Memory);
+
+	for(uint32 i = 0; i < s->particleRenderChunkCount; i++)
+	{
+		vkh_destroy_buffer(s->instance, s->particlePhaseBuffers[i], &s->particlePhaseMemory[i]);
+		vkh_destroy_buffer(s->instance, s->particleRenderBuffers[i], &s->particleRenderMemory[i]);
+	}
+
+	free(s->particlePhaseBuffers);
+	free(s->particlePhaseMemory);
+	free(s->particleRenderBuffers);
+	free(s->particleRenderMemory);
+}
+
+static bool _draw_create_blackbody_buffer(DrawState* s, const Config* config)
+{
+	s->blackbodyTable = (BlackbodyTable*)malloc(sizeof(BlackbodyTable));
+	if(!s->blackbodyTable)
+	{
+		ERROR_LOG("failed to allocate blackbody table");
+		return false;
+	}
+
+	blackbody_table_build(s->blackbodyTable, config->blackbodyMinTemp, config->blackbodyMaxTemp, config->blackbodyResolution);
+
+	//the whole table is uploaded, the shader's block has room for the largest resolution:
+	s->blackbodyBuffer = vkh_create_buffer(s->instance, sizeof(BlackbodyTable), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+	                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->blackbodyMemory);
+	vkh_upload_buffer(s->uploadContext, s->instance, s->blackbodyBuffer, 0, sizeof(BlackbodyTable), s->blackbodyTable);
+
+	return true;
+}
+
+static void _draw_destroy_blackbody_buffer(DrawState* s)
+{
+	vkh_destroy_buffer(s->instance, s->blackbodyBuffer, &s->blackbodyMemory);
+	free(s->blackbodyTable);
+}
+
+static bool _draw_create_star_splat(DrawState* s)
+{
+	//create accumulation buffer, large enough for a fullscreen window on the primary monitor (a single pixel if
+	//splatting is disabled, the transform pass still binds it):
+	//---------------
+	s->splatCapacity = 1;
+	if(s->starSplat)
+	{
+		s->splatCapacity = s->instance->swapchainExtent.width * s->instance->swapchainExtent.height;
+
+		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : NULL;
+		if(mode && (uint32)(mode->width * mode->height) > s->splatCapacity)
+			s->splatCapacity = mode->width * mode->height;
+	}
+
+	s->splatBuffer = vkh_create_buffer(s->instance, (VkDeviceSize)s->splatCapacity * 3 * sizeof(uint32),
+	                                   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->splatMemory);
+
+	//create composite pipeline:
+	//---------------
+	s->splatPipeline = vkh_pipeline_create();
+	if(!s->splatPipeline)
+		return false;
+
+	uint64 vertCodeSize, fragCodeSize;
+	uint32 *vertCode = vkh_load_spirv("assets/spirv/fullscreen.vert.spv", &vertCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/star_splat.frag.spv", &fragCodeSize);
+
+	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	vkh_pipeline_set_vert_shader(s->splatPipeline, vertModule);
+	vkh_pipeline_set_frag_shader(s->splatPipeline, fragModule);
+
+	VkDescriptorSetLayoutBinding splatLayoutBinding = {};
+	splatLayoutBinding.binding = 0;
+	splatLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	splatLayoutBinding.descriptorCount = 1;
+	splatLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	splatLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(s->splatPipeline, splatLayoutBinding);
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(uint32);
+
+	vkh_pipeline_add_push_constant(s->splatPipeline, pushConstant);
+
+	vkh_pipeline_add_dynamic_state(s->splatPipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(s->splatPipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//the light is added like the particles' (which are blended additively), the alpha is kept:
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+	vkh_pipeline_add_color_blend_attachment(s->splatPipeline, colorBlendAttachment);
+
+	vkh_pipeline_set_input_assembly_state(s->splatPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(s->splatPipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(s->splatPipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(s->splatPipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(s->splatPipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	bool pipelineGenerated = vkh_pipeline_generate(s->splatPipeline, s->instance, s->finalRenderPass, 0);
+
+	vkh_free_spirv(vertCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, vertModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create descriptor set:
+	//---------------
+	s->splatDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->splatDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo splatBufferInfo = {};
+	splatBufferInfo.buffer = s->splatBuffer;
+	splatBufferInfo.offset = 0;
+	splatBufferInfo.range = VK_WHOLE_SIZE;
+
+	vkh_descriptor_sets_add_buffers(s->splatDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		0, 0, 1, &splatBufferInfo);
+
+	return vkh_desctiptor_sets_generate(s->splatDescriptorSets, s->instance, s->splatPipeline->descriptorLayout);
+}
+
+static void _draw_destroy_star_splat(DrawState* s)
+{
+	vkh_descriptor_sets_cleanup(s->splatDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->splatDescriptorSets);
+
+	vkh_pipeline_cleanup(s->splatPipeline, s->instance);
+	vkh_pipeline_destroy(s->splatPipeline);
+
+	vkh_destroy_buffer(s->instance, s->splatBuffer, &s->splatMemory);
+}
+
+static bool _draw_create_dust_volume(DrawState* s)
+{
+	s->dustVolumeOrigin = qm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+	for(uint32 i = 0; i < 3; i++)
+		s->dustVolumeSize[i] = 1;
+	s->dustVolumeBuilt = false;
+	s->dustVolumeBuild = false;
+	s->dustVolumeTime = 0.0;
+	s->dustVolumeInterval = 0.0;
+
+	//create splat buffer (a single voxel if the volume is disabled, the transform pass still binds it):
+	//---------------
+	uint64 numVoxels = s->dustVolume == 0 ? 1 : (uint64)s->dustVolume * s->dustVolume * s->dustVolume;
+	s->dustVolumeBuffer = vkh_create_buffer(s->instance, (VkDeviceSize)numVoxels * 3 * sizeof(uint32),
+	                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->dustVolumeMemory);
+
+	if(s->dustVolume == 0)
+		return true;
+
+	//create texture, 3D so the raymarch gets trilinear filtering (vkh only creates 2D images):
+	//---------------
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_3D;
+	imageCreateInfo.extent.width = s->dustVolume;
+	imageCreateInfo.extent.height = s->dustVolume;
+	imageCreateInfo.extent.depth = s->dustVolume;
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.format = DRAW_DUST_VOLUME_FORMAT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if(vkCreateImage(s->instance->device, &imageCreateInfo, nullptr, &s->dustVolumeImage) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust volume image");
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(s->instance->device, s->dustVolumeImage, &memRequirements);
+	if(!vkh_allocate_memory(s->instance, memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_TRUE, &s->dustVolumeImageMemory))
+	{
+		ERROR_LOG("failed to allocate dust volume image memory");
+		return false;
+	}
+
+	vkBindImageMemory(s->instance->device, s->dustVolumeImage, s->dustVolumeImageMemory.memory, s->dustVolumeImageMemory.offset);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = s->dustVolumeImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_3D;
+	viewCreateInfo.format = DRAW_DUST_VOLUME_FORMAT;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewCreateInfo.subresourceRange.baseMipLevel = 0;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	if(vkCreateImageView(s->instance->device, &viewCreateInfo, nullptr, &s->dustVolumeView) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust volume image view");
+		return false;
+	}
+
+	//create sampler, trilinear with a black border so the dust fades out at the edges of the grid:
+	//---------------
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	if(vkCreateSampler(s->instance->device, &samplerCreateInfo, nullptr, &s->dustVolumeSampler) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create dust volume sampler");
+		return false;
+	}
+
+	//create resolve pipeline, turns the fixed point sums into the texture:
+	//---------------
+	s->dustVolumeResolvePipeline = vkh_compute_pipeline_create();
+	if(!s->dustVolumeResolvePipeline)
+		return false;
+
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/dust_volume.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->dustVolumeResolvePipeline, computeModule);
+
+	//splatted light, texture:
+	VkDescriptorType descriptorTypes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+	for(uint32 i = 0; i < 2; i++)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = i;
+		layoutBinding.descriptorType = descriptorTypes[i];
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		vkh_compute_pipeline_add_desc_set_binding(s->dustVolumeResolvePipeline, layoutBinding);
+	}
+
+	VkPushConstantRange resolvePushConstant = {};
+	resolvePushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	resolvePushConstant.offset = 0;
+	resolvePushConstant.size = 4 * sizeof(uint32);
+
+	vkh_compute_pipeline_add_push_constant(s->dustVolumeResolvePipeline, resolvePushConstant);
+
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->dustVolumeResolvePipeline, s->instance);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create raymarch pipeline:
+	//---------------
+	s->dustVolumePipeline = vkh_pipeline_create();
+	if(!s->dustVolumePipeline)
+		return false;
+
+	uint64 vertCodeSize, fragCodeSize;
+	uint32 *vertCode = vkh_load_spirv("assets/spirv/fullscreen.vert.spv", &vertCodeSize);
+	uint32 *fragCode = vkh_load_spirv("assets/spirv/dust_volume.frag.spv", &fragCodeSize);
+
+	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
+	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+
+	vkh_pipeline_set_vert_shader(s->dustVolumePipeline, vertModule);
+	vkh_pipeline_set_frag_shader(s->dustVolumePipeline, fragModule);
+
+	VkDescriptorSetLayoutBinding volumeLayoutBinding = {};
+	volumeLayoutBinding.binding = 0;
+	volumeLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	volumeLayoutBinding.descriptorCount = 1;
+	volumeLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	volumeLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_pipeline_add_desc_set_binding(s->dustVolumePipeline, volumeLayoutBinding);
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(DustVolumeParamsGPU);
+
+	vkh_pipeline_add_push_constant(s->dustVolumePipeline, pushConstant);
+
+	vkh_pipeline_add_dynamic_state(s->dustVolumePipeline, VK_DYNAMIC_STATE_VIEWPORT);
+	vkh_pipeline_add_dynamic_state(s->dustVolumePipeline, VK_DYNAMIC_STATE_SCISSOR);
+
+	//the light along each ray is added like the dust billboards would be, the alpha is kept:
+	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachment.blendEnable = VK_TRUE;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+	vkh_pipeline_add_color_blend_attachment(s->dustVolumePipeline, colorBlendAttachment);
+
+	vkh_pipeline_set_input_assembly_state(s->dustVolumePipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+	vkh_pipeline_set_raster_state(s->dustVolumePipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
+		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+
+	vkh_pipeline_set_multisample_state(s->dustVolumePipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+	vkh_pipeline_set_depth_stencil_state(s->dustVolumePipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+
+	vkh_pipeline_set_color_blend_state(s->dustVolumePipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+
+	pipelineGenerated = vkh_pipeline_generate(s->dustVolumePipeline, s->instance, s->finalRenderPass, 0);
+
+	vkh_free_spirv(vertCode);
+	vkh_free_spirv(fragCode);
+
+	vkh_destroy_shader_module(s->instance, vertModule);
+	vkh_destroy_shader_module(s->instance, fragModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create descriptor sets:
+	//---------------
+	VkDescriptorBufferInfo volumeBufferInfo = {};
+	volumeBufferInfo.buffer = s->dustVolumeBuffer;
+	volumeBufferInfo.offset = 0;
+	volumeBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorImageInfo storageImageInfo = {};
+	storageImageInfo.sampler = VK_NULL_HANDLE;
+	storageImageInfo.imageView = s->dustVolumeView;
+	storageImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorImageInfo sampledImageInfo = {};
+	sampledImageInfo.sampler = s->dustVolumeSampler;
+	sampledImageInfo.imageView = s->dustVolumeView;
+	sampledImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	s->dustVolumeResolveDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->dustVolumeResolveDescriptorSets)
+		return false;
+
+	vkh_descriptor_sets_add_buffers(s->dustVolumeResolveDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		0, 0, 1, &volumeBufferInfo);
+	vkh_descriptor_sets_add_images(s->dustVolumeResolveDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+		1, 0, 1, &storageImageInfo);
+
+	if(!vkh_desctiptor_sets_generate(s->dustVolumeResolveDescriptorSets, s->instance, s->dustVolumeResolvePipeline->descriptorLayout))
+		return false;
+
+	s->dustVolumeDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->dustVolumeDescriptorSets)
+		return false;
+
+	vkh_descriptor_sets_add_images(s->dustVolumeDescriptorSets, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		0, 0, 1, &sampledImageInfo);
+
+	return vkh_desctiptor_sets_generate(s->dustVolumeDescriptorSets, s->instance, s->dustVolumePipeline->descriptorLayout);
+}
+
+static void _draw_destroy_dust_volume(DrawState* s)
+{
+	if(s->dustVolume != 0)
+	{
+		vkh_descriptor_sets_cleanup(s->dustVolumeDescriptorSets, s->instance);
+		vkh_descriptor_sets_destroy(s->dustVolumeDescriptorSets);
+		vkh_descriptor_sets_cleanup(s->dustVolumeResolveDescriptorSets, s->instance);
+		vkh_descriptor_sets_destroy(s->dustVolumeResolveDescriptorSets);
+
+		vkh_pipeline_cleanup(s->dustVolumePipeline, s->instance);
+		vkh_pipeline_destroy(s->dustVolumePipeline);
+		vkh_compute_pipeline_cleanup(s->dustVolumeResolvePipeline, s->instance);
+		vkh_compute_pipeline_destroy(s->dustVolumeResolvePipeline);
+
+		vkDestroySampler(s->instance->device, s->dustVolumeSampler, NULL);
+		vkh_destroy_image_view(s->instance, s->dustVolumeView);
+		vkh_destroy_image(s->instance, s->dustVolumeImage, &s->dustVolumeImageMemory);
+	}
+
+	vkh_destroy_buffer(s->instance, s->dustVolumeBuffer, &s->dustVolumeMemory);
+}
+
+static bool _draw_create_particle_render_descriptors(DrawState* s)
+{
+	//1 per chunk, all sharing the uniform ring:
+	s->particleDescriptorSets = vkh_descriptor_sets_create(s->particleRenderChunkCount);
+	if(!s->particleDescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo cameraBufferInfo = {};
+	cameraBufferInfo.buffer = s->uniformRing->buffer;
+	cameraBufferInfo.offset = 0;
+	cameraBufferInfo.range = sizeof(CameraGPU);
+
+	VkDescriptorBufferInfo drawBufferInfo = {};
+	drawBufferInfo.buffer = s->particleDrawBuffer;
+	drawBufferInfo.offset = 0;
+	drawBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo* renderBufferInfos = (VkDescriptorBufferInfo*)malloc(s->particleRenderChunkCount * sizeof(VkDescriptorBufferInfo));
+	for(uint32 i = 0; i < s->particleRenderChunkCount; i++)
+	{
+		renderBufferInfos[i].buffer = s->particleRenderBuffers[i];
+		renderBufferInfos[i].offset = 0;
+		renderBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		vkh_descriptor_sets_add_buffers(s->particleDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 
+			0, 0, 1, &cameraBufferInfo);
+		vkh_descriptor_sets_add_buffers(s->particleDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 
+			1, 0, 1, &renderBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(s->particleDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 
+			2, 0, 1, &drawBufferInfo);
+	}
+
+	//the pipelines of every type have the same layout:
+	bool result = vkh_desctiptor_sets_generate(s->particleDescriptorSets, s->instance, s->particlePipelines[DRAW_PARTICLE_STAR]->descriptorLayout);
+	free(renderBufferInfos);
+
+	if(!result)
+		return false;
+
+	//1 for the H2 buffer:
+	s->particleH2DescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->particleH2DescriptorSets)
+		return false;
+
+	VkDescriptorBufferInfo h2BufferInfo = {};
+	h2BufferInfo.buffer = s->particleH2Buffer;
+	h2BufferInfo.offset = 0;
+	h2BufferInfo.range = VK_WHOLE_SIZE;
+
+	vkh_descriptor_sets_add_buffers(s->particleH2DescriptorSets, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 
+		0, 0, 1, &cameraBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->particleH2DescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 
+		1, 0, 1, &h2BufferInfo);
+	vkh_descriptor_sets_add_buffers(s->particleH2DescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 
+		2, 0, 1, &drawBufferInfo);
+
+	return vkh_desctiptor_sets_generate(s->particleH2DescriptorSets, s->instance, s->particlePipelines[DRAW_PARTICLE_H2]->descriptorLayout);
+}
+
+static void _draw_destroy_particle_render_descriptors(DrawState* s)
+{
+	vkh_descriptor_sets_cleanup(s->particleH2DescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->particleH2DescriptorSets);
+
+	vkh_descriptor_sets_cleanup(s->particleDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->particleDescriptorSets);
+}
+
+static bool _draw_create_particle_lod(DrawState* s)
+{
+	//create pipeline:
+	//---------------
+	s->lodPipeline = vkh_compute_pipeline_create();
+	if(!s->lodPipeline)
+		return false;
+
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/particle_lod.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->lodPipeline, computeModule);
+
+	//nodes, impostors, draw commands, params:
+	VkDescriptorType descriptorTypes[4] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC};
+	for(uint32 i = 0; i < 4; i++)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = i;
+		layoutBinding.descriptorType = descriptorTypes[i];
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		vkh_compute_pipeline_add_desc_set_binding(s->lodPipeline, layoutBinding);
+	}
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(uint32);
+
+	vkh_compute_pipeline_add_push_constant(s->lodPipeline, pushConstant);
+
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->lodPipeline, s->instance);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create buffers (every node can become an impostor):
+	//---------------
+	s->lodNodeBuffer = vkh_create_buffer(s->instance, DRAW_LOD_TABLE_SIZE * sizeof(ParticleLodNodeGPU),
+	                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->lodNodeMemory);
+	s->lodImpostorBuffer = vkh_create_buffer(s->instance, DRAW_LOD_TABLE_SIZE * sizeof(RenderParticleGPU),
+	                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	                                         &s->lodImpostorMemory);
+
+	//the table is cleared before every transform pass, this covers the first one:
+	VkCommandBuffer commandBuf = vkh_upload_command_buffer(s->uploadContext, s->instance);
+	vkCmdFillBuffer(commandBuf, s->lodNodeBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	//create descriptor sets:
+	//---------------
+	VkDescriptorBufferInfo nodeBufferInfo = {};
+	nodeBufferInfo.buffer = s->lodNodeBuffer;
+	nodeBufferInfo.offset = 0;
+	nodeBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo impostorBufferInfo = {};
+	impostorBufferInfo.buffer = s->lodImpostorBuffer;
+	impostorBufferInfo.offset = 0;
+	impostorBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo drawBufferInfo = {};
+	drawBufferInfo.buffer = s->particleDrawBuffer;
+	drawBufferInfo.offset = 0;
+	drawBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo paramsBufferInfo = {};
+	paramsBufferInfo.buffer = s->uniformRing->buffer;
+	paramsBufferInfo.offset = 0;
+	paramsBufferInfo.range = sizeof(ParticleParamsGPU);
+
+	VkDescriptorBufferInfo cameraBufferInfo = {};
+	cameraBufferInfo.buffer = s->uniformRing->buffer;
+	cameraBufferInfo.offset = 0;
+	cameraBufferInfo.range = sizeof(CameraGPU);
+
+	s->lodDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->lodDescriptorSets)
+		return false;
+
+	vkh_descriptor_sets_add_buffers(s->lodDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		0, 0, 1, &nodeBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->lodDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		1, 0, 1, &impostorBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->lodDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		2, 0, 1, &drawBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->lodDescriptorSets, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		3, 0, 1, &paramsBufferInfo);
+
+	if(!vkh_desctiptor_sets_generate(s->lodDescriptorSets, s->instance, s->lodPipeline->descriptorLayout))
+		return false;
+
+	//impostors are drawn with the star pipeline:
+	s->lodImpostorDescriptorSets = vkh_descriptor_sets_create(1);
+	if(!s->lodImpostorDescriptorSets)
+		return false;
+
+	vkh_descriptor_sets_add_buffers(s->lodImpostorDescriptorSets, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 
+		0, 0, 1, &cameraBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->lodImpostorDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 
+		1, 0, 1, &impostorBufferInfo);
+	vkh_descriptor_sets_add_buffers(s->lodImpostorDescriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 
+		2, 0, 1, &drawBufferInfo);
+
+	return vkh_desctiptor_sets_generate(s->lodImpostorDescriptorSets, s->instance, s->particlePipelines[DRAW_PARTICLE_STAR]->descriptorLayout);
+}
+
+static void _draw_destroy_particle_lod(DrawState* s)
+{
+	vkh_descriptor_sets_cleanup(s->lodImpostorDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->lodImpostorDescriptorSets);
+
+	vkh_descriptor_sets_cleanup(s->lodDescriptorSets, s->instance);
+	vkh_descriptor_sets_destroy(s->lodDescriptorSets);
+
+	vkh_destroy_buffer(s->instance, s->lodImpostorBuffer, &s->lodImpostorMemory);
+	vkh_destroy_buffer(s->instance, s->lodNodeBuffer, &s->lodNodeMemory);
+
+	vkh_compute_pipeline_cleanup(s->lodPipeline, s->instance);
+	vkh_compute_pipeline_destroy(s->lodPipeline);
+}
+
+static bool _draw_create_dust_compute(DrawState* s)
+{
+	if(!s->dustCompute)
+		return true;
+
+	//create pipeline:
+	//---------------
+	s->dustSplatPipeline = vkh_compute_pipeline_create();
+	if(!s->dustSplatPipeline)
+		return false;
+
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/dust_splat.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->dustSplatPipeline, computeModule);
+
+	//camera, render particles, draw commands, splats, tiles, tile splats, dust target:
+	VkDescriptorType descriptorTypes[7] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                       VK_DESCRIPTOR_TYPE_STORAGE_IMAGE};
+	for(uint32 i = 0; i < 7; i++)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = i;
+		layoutBinding.descriptorType = descriptorTypes[i];
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		vkh_compute_pipeline_add_desc_set_binding(s->dustSplatPipeline, layoutBinding);
+	}
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(DustSplatParamsGPU);
+
+	vkh_compute_pipeline_add_push_constant(s->dustSplatPipeline, pushConstant);
+
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->dustSplatPipeline, s->instance);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create buffers, there is never more dust than the galaxies have:
+	//---------------
+	s->dustMaxSplats = s->numParticles - s->numStars;
+	if(s->dustMaxSplats > DRAW_DUST_MAX_SPLATS)
+		s->dustMaxSplats = DRAW_DUST_MAX_SPLATS;
+	if(s->dustMaxSplats == 0)
+		s->dustMaxSplats = 1;
+
+	s->dustSplatBuffer = vkh_create_buffer(s->instance, 4 * sizeof(uint32) + (VkDeviceSize)s->dustMaxSplats * DRAW_DUST_SPLAT_SIZE,
+	                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+	                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->dustSplatMemory);
+	s->dustTileSplatBuffer = vkh_create_buffer(s->instance, (VkDeviceSize)DRAW_DUST_MAX_TILE_SPLATS * sizeof(uint32),
+	                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+	                                           &s->dustTileSplatMemory);
+
+	return true;
+}
+
+static void _draw_destroy_dust_compute(DrawState* s)
+{
+	if(!s->dustCompute)
+		return;
+
+	vkh_destroy_buffer(s->instance, s->dustTileSplatBuffer, &s->dustTileSplatMemory);
+	vkh_destroy_buffer(s->instance, s->dustSplatBuffer, &s->dustSplatMemory);
+
+	vkh_compute_pipeline_cleanup(s->dustSplatPipeline, s->instance);
+	vkh_compute_pipeline_destroy(s->dustSplatPipeline);
+}
+
+static bool _draw_create_dust_tiles(DrawState* s)
+{
+	if(!s->dustCompute)
+		return true;
+
+	//create tile buffer and its scan:
+	//---------------
+	s->dustTilesX = (s->dustExtent.width + DRAW_DUST_TILE_SIZE - 1) / DRAW_DUST_TILE_SIZE;
+	s->dustTilesY = (s->dustExtent.height + DRAW_DUST_TILE_SIZE - 1) / DRAW_DUST_TILE_SIZE;
+
+	uint32 numTiles = s->dustTilesX * s->dustTilesY;
+	if(numTiles > VKH_SCAN_MAX_COUNT)
+	{
+		ERROR_LOG("too many dust tiles for the window size");
+		return false;
+	}
+
+	s->dustTileBuffer = vkh_create_buffer(s->instance, numTiles * sizeof(uint32),
+	                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->dustTileMemory);
+	if(s->dustTileMemory.memory == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create dust tile buffer");
+		return false;
+	}
+
+	s->dustTileScan = vkh_scan_create(s->instance, s->dustTileBuffer, numTiles, "assets/spirv/vkh");
+	if(!s->dustTileScan)
+		return false;
+
+	//create descriptor sets, 1 per render chunk:
+	//---------------
+	VkDescriptorBufferInfo cameraBufferInfo = {};
+	cameraBufferInfo.buffer = s->uniformRing->buffer;
+	cameraBufferInfo.offset = 0;
+	cameraBufferInfo.range = sizeof(CameraGPU);
+
+	VkDescriptorBufferInfo drawBufferInfo = {};
+	drawBufferInfo.buffer = s->particleDrawBuffer;
+	drawBufferInfo.offset = 0;
+	drawBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo splatBufferInfo = {};
+	splatBufferInfo.buffer = s->dustSplatBuffer;
+	splatBufferInfo.offset = 0;
+	splatBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo tileBufferInfo = {};
+	tileBufferInfo.buffer = s->dustTileBuffer;
+	tileBufferInfo.offset = 0;
+	tileBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo tileSplatBufferInfo = {};
+	tileSplatBufferInfo.buffer = s->dustTileSplatBuffer;
+	tileSplatBufferInfo.offset = 0;
+	tileSplatBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorImageInfo dustImageInfo = {};
+	dustImageInfo.sampler = VK_NULL_HANDLE;
+	dustImageInfo.imageView = s->dustView;
+	dustImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkDescriptorBufferInfo* renderBufferInfos = (VkDescriptorBufferInfo*)malloc(s->particleRenderChunkCount * sizeof(VkDescriptorBufferInfo));
+
+	s->dustSplatDescriptorSets = vkh_descriptor_sets_create(s->particleRenderChunkCount);
+	if(!s->dustSplatDescriptorSets)
+	{
+		free(renderBufferInfos);
+		return false;
+	}
+
+	for(uint32 i = 0; i < s->particleRenderChunkCount; i++)
+	{
+		renderBufferInfos[i].buffer = s->particleRenderBuffers[i];
+		renderBufferInfos[i].offset = 0;
+		renderBufferInfos[i].range = VK_WHOLE_SIZE;
+
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			0, 0, 1, &cameraBufferInfo);
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1, 0, 1, &renderBufferInfos[i]);
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			2, 0, 1, &drawBufferInfo);
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			3, 0, 1, &splatBufferInfo);
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			4, 0, 1, &tileBufferInfo);
+		vkh_descriptor_sets_add_buffers(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			5, 0, 1, &tileSplatBufferInfo);
+		vkh_descriptor_sets_add_images(s->dustSplatDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			6, 0, 1, &dustImageInfo);
+	}
+
+	bool result = vkh_desctiptor_sets_generate(s->dustSplatDescriptorSets, s->instance, s->dustSplatPipeline->descriptorLayout);
+	free(renderBufferInfos);
+
+	return result;
+}
+
+static void _draw_destroy_dust_tiles(DrawState* s)
+{
+	if(!s->dustCompute)
+		return;
+
+	vkh_retire_descriptor_sets(s->deletionQueue, s->dustSplatDescriptorSets);
+	vkh_retire_scan(s->deletionQueue, s->dustTileScan);
+	vkh_retire_buffer(s->deletionQueue, s->dustTileBuffer, &s->dustTileMemory);
+
+	s->dustSplatDescriptorSets = NULL;
+	s->dustTileScan = NULL;
+	s->dustTileBuffer = VK_NULL_HANDLE;
+	s->dustTileMemory = {};
+}
+
+static bool _draw_create_particle_sort(DrawState* s)
+{
+	s->particleSortPipeline = NULL;
+	s->particleSort = NULL;
+	if(!s->mortonSort)
+		return true;
+
+	//create pipeline:
+	//---------------
+	s->particleSortPipeline = vkh_compute_pipeline_create();
+	if(!s->particleSortPipeline)
+		return false;
+
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/particle_sort.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->particleSortPipeline, computeModule);
+
+	//particles, galaxies, keys, values, sorted particles:
+	for(uint32 i = 0; i < 5; i++)
+	{
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = i;
+		layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		vkh_compute_pipeline_add_desc_set_binding(s->particleSortPipeline, layoutBinding);
+	}
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(ParticleSortChunkGPU);
+
+	vkh_compute_pipeline_add_push_constant(s->particleSortPipeline, pushConstant);
+
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->particleSortPipeline, s->instance);
+
+	//sorted particles are cached separately, and editing the sort invalidates them like editing generation does:
+	s->particleGenShaderHash = snapshot_hash(s->particleGenShaderHash, computeCode, computeCodeSize);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create the sort, chunks are sorted 1 at a time:
+	//---------------
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
+
+	uint32 maxCount = 0;
+	for(uint32 i = 0; i < set->chunkCount; i++)
+		if(set->chunks[i].count > maxCount)
+			maxCount = set->chunks[i].count;
+
+	s->particleSort = vkh_radix_sort_create(s->instance, maxCount, "assets/spirv/vkh");
+	if(!s->particleSort)
+	{
+		ERROR_LOG("failed to create particle sort");
+		return false;
+	}
+
+	return true;
+}
+
+static void _draw_destroy_particle_sort(DrawState* s)
+{
+	if(!s->mortonSort)
+		return;
+
+	vkh_radix_sort_destroy(s->particleSort, s->instance);
+
+	vkh_compute_pipeline_cleanup(s->particleSortPipeline, s->instance);
+	vkh_compute_pipeline_destroy(s->particleSortPipeline);
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _draw_create_particle_generator(DrawState* s)
+{
+	//create pipeline:
+	//---------------
+	s->particleGenPipeline = vkh_compute_pipeline_create();
+	if(!s->particleGenPipeline)
+		return false;
+
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/particle_generate.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->particleGenPipeline, computeModule);
+
+	VkDescriptorSetLayoutBinding particleLayoutBinding = {};
+	particleLayoutBinding.binding = 0;
+	particleLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	particleLayoutBinding.descriptorCount = 1;
+	particleLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	particleLayoutBinding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutBinding galaxyLayoutBinding = {};
+	galaxyLayoutBinding.binding = 1;
+	galaxyLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	galaxyLayoutBinding.descriptorCount = 1;
+	galaxyLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	galaxyLayoutBinding.pImmutableSamplers = nullptr;
+
+	vkh_compute_pipeline_add_desc_set_binding(s->particleGenPipeline, particleLayoutBinding);
+	vkh_compute_pipeline_add_desc_set_binding(s->particleGenPipeline, galaxyLayoutBinding);
+
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(ParticleGenChunkGPU);
+
+	vkh_compute_pipeline_add_push_constant(s->particleGenPipeline, pushConstant);
+
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->particleGenPipeline, s->instance);
+
+	//part of the particle cache key, so editing the shader invalidates old snapshots:
+	s->particleGenShaderHash = snapshot_hash(SNAPSHOT_HASH_INIT, computeCode, computeCodeSize);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	if(!pipelineGenerated)
+		return false;
+
+	//create timestamp queries (used to fit progressive generation and regeneration into the frame budget):
+	//---------------
+	s->particleGenQueryPool = VK_NULL_HANDLE;
+	s->particleGenQueryChunks = (uint32*)calloc(s->framesInFlight, sizeof(uint32));
+	if(!s->particleGenQueryChunks)
+	{
+		ERROR_LOG("failed to allocate generation query counts");
+		return false;
+	}
+
+	if(s->instance->properties.limits.timestampComputeAndGraphics)
 	{
-		ERROR_LOG("failed to allocate command buffers");
+		VkQueryPoolCreateInfo queryPoolInfo = {};
+		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolInfo.queryCount = 2 * s->framesInFlight;
+
+		if(vkCreateQueryPool(s->instance->device, &queryPoolInfo, NULL, &s->particleGenQueryPool) != VK_SUCCESS)
+		{
+			MSG_LOG("failed to create timestamp query pool, generating a fixed number of chunks per frame");
+			s->particleGenQueryPool = VK_NULL_HANDLE;
+		}
+	}
+
+	//every buffer but the last holds a whole number of dispatches, so they can be numbered globally:
+	s->particleGenChunkCount = (s->numParticles + DRAW_PARTICLE_GEN_CHUNK_SIZE - 1) / DRAW_PARTICLE_GEN_CHUNK_SIZE;
+	s->particleGenChunkCost = 0.0;
+
+	s->regenPending = false;
+	s->regenGalaxies = (DrawGalaxyGPU*)malloc(s->numGalaxies * sizeof(DrawGalaxyGPU));
+	if(!s->regenGalaxies)
+	{
+		ERROR_LOG("failed to allocate galaxies");
 		return false;
 	}
 
 	return true;
 }
 
-static void _draw_destroy_command_buffers(DrawState* s)
-{
-	vkFreeCommandBuffers(s->instance->device, s->commandPool, FRAMES_IN_FLIGHT, s->commandBuffers);
-	vkDestroyCommandPool(s->instance->device, s->commandPool, NULL);
-}
-
-static bool _draw_create_sync_objects(DrawState* s)
+static void _draw_destroy_particle_generator(DrawState* s)
 {
-	VkSemaphoreCreateInfo semaphoreInfo = {};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	free(s->regenGalaxies);
 
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
-		if(vkCreateSemaphore(s->instance->device, &semaphoreInfo, NULL, &s->imageAvailableSemaphores[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(s->instance->device, &semaphoreInfo, NULL, &s->renderFinishedSemaphores[i]) != VK_SUCCESS ||
-			vkCreateFence(s->instance->device, &fenceInfo, NULL, &s->inFlightFences[i]) != VK_SUCCESS)
-		{
-			ERROR_LOG("failed to create sync objects");
-			return false;
-		}
+	if(s->particleGenQueryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(s->instance->device, s->particleGenQueryPool, NULL);
+	free(s->particleGenQueryChunks);
 
-	return true;
+	vkh_compute_pipeline_cleanup(s->particleGenPipeline, s->instance);
+	vkh_compute_pipeline_destroy(s->particleGenPipeline);
 }
 
-static void _draw_destroy_sync_objects(DrawState* s)
+static bool _draw_create_particle_transform_pipeline(DrawState* s)
 {
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
+	//visible particles are compacted with subgroup ballots:
+	VkPhysicalDeviceSubgroupProperties subgroupProperties = s->instance->subgroupProperties;
+	if(!(subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) ||
+	   !(subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_BALLOT_BIT))
 	{
-		vkDestroySemaphore(s->instance->device, s->imageAvailableSemaphores[i], NULL);
-		vkDestroySemaphore(s->instance->device, s->renderFinishedSemaphores[i], NULL);
-		vkDestroyFence(s->instance->device, s->inFlightFences[i], NULL);
+		ERROR_LOG("subgroup ballots are not supported in compute shaders");
+		return false;
 	}
-}
 
-static bool _draw_create_camera_buffer(DrawState* s)
-{
-	VkDeviceSize bufferSize = sizeof(CameraGPU);
+	s->particleTransformPipeline = vkh_compute_pipeline_create();
+	if(!s->particleTransformPipeline)
+		return false;
 
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
+	uint64 computeCodeSize;
+	uint32 *computeCode = vkh_load_spirv("assets/spirv/particle_transform.comp.spv", &computeCodeSize);
+	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
+	vkh_compute_pipeline_set_shader(s->particleTransformPipeline, computeModule);
+
+	//particles, galaxies, render particles, params, draw commands, phases, LOD nodes, H2 regions, blackbody colors,
+	//splatted stars, dust volume:
+	VkDescriptorType descriptorTypes[11] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+	                                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	                                        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+	for(uint32 i = 0; i < 11; i++)
 	{
-		s->cameraBuffers[i] = vkh_create_buffer(s->instance, bufferSize,
-												   VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-												   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->cameraBuffersMemory[i]);
+		VkDescriptorSetLayoutBinding layoutBinding = {};
+		layoutBinding.binding = i;
+		layoutBinding.descriptorType = descriptorTypes[i];
+		layoutBinding.descriptorCount = 1;
+		layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		layoutBinding.pImmutableSamplers = nullptr;
+
+		vkh_compute_pipeline_add_desc_set_binding(s->particleTransformPipeline, layoutBinding);
 	}
 
-	s->cameraStagingBuffer = vkh_create_buffer(s->instance, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-												  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &s->cameraStagingBufferMemory);
+	VkPushConstantRange pushConstant = {};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(ParticleTransformChunkGPU);
+
+	vkh_compute_pipeline_add_push_constant(s->particleTransformPipeline, pushConstant);
 
-	return true;
+	bool pipelineGenerated = vkh_compute_pipeline_generate(s->particleTransformPipeline, s->instance);
+
+	vkh_free_spirv(computeCode);
+	vkh_destroy_shader_module(s->instance, computeModule);
+
+	return pipelineGenerated;
 }
 
-static void _draw_destroy_camera_buffer(DrawState* s)
+static void _draw_destroy_particle_transform_pipeline(DrawState* s)
 {
-	vkh_destroy_buffer(s->instance, s->cameraStagingBuffer, s->cameraStagingBufferMemory);
-
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
-		vkh_destroy_buffer(s->instance, s->cameraBuffers[i], s->cameraBuffersMemory[i]);
+	vkh_compute_pipeline_cleanup(s->particleTransformPipeline, s->instance);
+	vkh_compute_pipeline_destroy(s->particleTransformPipeline);
 }
 
 //----------------------------------------------------------------------------//
 
-static bool _draw_create_quad_vertex_buffer(DrawState* s)
+static bool _draw_initialize_particles(DrawState* s)
 {
-	Vertex verts[4] = {{{-0.5f, 0.0f, -0.5f}, {0.0f, 0.0f}}, {{0.5f, 0.0f, -0.5f}, {1.0f, 0.0f}}, {{-0.5f, 0.0f, 0.5f}, {0.0f, 1.0f}}, {{0.5f, 0.0f, 0.5f}, {1.0f, 1.0f}}};
-	uint32 indices[6] = {0, 1, 2, 1, 2, 3};
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
+	_draw_layout_galaxies(s, set->galaxies);
+	memcpy(s->regenGalaxies, set->galaxies, s->numGalaxies * sizeof(DrawGalaxyGPU));
+
+	//the galaxies are needed for drawing even if the particles come from the cache. generation may be recorded into the
+	//same batch, so the update is made visible to compute shaders right away (the batch's own barrier is only at its end):
+	VkCommandBuffer commandBuf = vkh_upload_command_buffer(s->uploadContext, s->instance);
+	_draw_record_galaxy_update_commands(s, set, commandBuf);
+
+	VkBufferMemoryBarrier galaxyBarrier = {};
+	galaxyBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	galaxyBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	galaxyBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	galaxyBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	galaxyBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	galaxyBarrier.buffer = set->galaxyBuffer;
+	galaxyBarrier.offset = 0;
+	galaxyBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     0, NULL, 1, &galaxyBarrier, 0, NULL);
+
+	//load the same galaxies from a previous run if possible:
+	if(s->particleCache && _draw_load_particle_snapshot(s, set))
+		return true;
+
+	//in progressive mode the first frame renders right away and draw_render generates the particles over time:
+	if(s->progressiveGen)
+		return true;
+
+	//otherwise everything is generated in the same batch as the other startup uploads, which is submitted before the first frame:
+	f64 startTime = glfwGetTime();
+
+	commandBuf = vkh_upload_command_buffer(s->uploadContext, s->instance);
+	_draw_record_particle_gen_commands(s, set, commandBuf, 0, s->particleGenChunkCount);
+	set->genChunksDone = s->particleGenChunkCount;
+
+	if(s->mortonSort)
+		for(uint32 i = 0; i < set->chunkCount; i++)
+			_draw_record_particle_sort_commands(s, set, commandBuf, i);
+
+	vkh_upload_flush(s->uploadContext, s->instance);
+
+	//only a cache miss waits for generation to finish, the particles have to be read back to be saved:
+	if(s->particleCache)
+	{
+		vkh_upload_wait(s->uploadContext, s->instance);
 
-	s->quadVertexBuffer = vkh_create_buffer(s->instance, sizeof(verts),
-												  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-												  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->quadVertexBufferMemory);
-	vkh_copy_with_staging_buf_implicit(s->instance, s->quadVertexBuffer, sizeof(verts), 0, verts);
+		char message[256];
+		snprintf(message, sizeof(message), "particle cache miss: generated %u particles in %.1fms", s->numParticles, (glfwGetTime() - startTime) * 1000.0);
+		MSG_LOG(message);
 
-	s->quadIndexBuffer = vkh_create_buffer(s->instance, sizeof(indices),
-												 VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-												 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->quadIndexBufferMemory);
-	vkh_copy_with_staging_buf_implicit(s->instance, s->quadIndexBuffer, sizeof(indices), 0, indices);
+		_draw_save_particle_snapshot(s, set);
+	}
 
 	return true;
 }
 
-static void _draw_destroy_quad_vertex_buffer(DrawState* s)
+static void _draw_layout_galaxies(DrawState* s, DrawGalaxyGPU* galaxies)
 {
-	vkh_destroy_buffer(s->instance, s->quadVertexBuffer, s->quadVertexBufferMemory);
-	vkh_destroy_buffer(s->instance, s->quadIndexBuffer, s->quadIndexBufferMemory);
+	//a single galaxy is centered, a cluster is spread over a disc with the golden angle (like seeds in a sunflower)
+	//and shrunk so the whole cluster covers about the same area as 1 galaxy:
+	f32 scale = 1.0f / sqrtf((f32)s->numGalaxies);
+	uint32 numParticles = s->numParticles / s->numGalaxies;
+
+	for(uint32 i = 0; i < s->numGalaxies; i++)
+	{
+		DrawGalaxyGPU* galaxy = &galaxies[i];
+
+		//split particles evenly, the last galaxy takes the remainder:
+		galaxy->firstParticle = i * numParticles;
+		galaxy->numParticles = i == s->numGalaxies - 1 ? s->numParticles - galaxy->firstParticle : numParticles;
+
+		uint32 numStars = (uint32)((uint64)s->numStars * galaxy->numParticles / s->numParticles);
+		galaxy->genParams = draw_default_gen_params(numStars, s->seed + i);
+
+		f32 angle = 2.39996323f * i;
+		f32 dist = DRAW_GALAXY_SPACING * galaxy->genParams.maxRad * scale * sqrtf((f32)i);
+		qm::vec3 pos = qm::vec3(dist * cosf(angle), 0.0f, dist * sinf(angle));
+		qm::vec3 tiltAxis = qm::vec3(-sinf(angle), 0.0f, cosf(angle));
+		f32 tilt = i == 0 ? 0.0f : DRAW_GALAXY_MAX_TILT * sinf(1.7f * i);
+
+		galaxy->model = qm::translate(pos) * qm::rotate(tiltAxis, tilt) * qm::scale(qm::vec3(scale, scale, scale));
+		galaxy->timeOffset = 100.0f * i;
+		galaxy->pad = 0;
+	}
 }
 
 //----------------------------------------------------------------------------//
 
-static bool _draw_create_grid_pipeline(DrawState* s)
+static uint64 _draw_particle_snapshot_key(DrawState* s, const DrawGalaxyGPU* galaxies)
 {
-	//create pipeline object:
-	//---------------
-	s->gridPipeline = vkh_pipeline_create();
-	if(!s->gridPipeline)
-		return false;
+	//everything that changes the generated particles: each galaxy's particle range and parameters (including star count
+	//and seed, but not its transform), the total count, the particle layout and the generation shader itself
+	uint32 particleSize = sizeof(GalaxyParticle);
 
-	//set shaders:
-	//---------------
-	uint64 vertCodeSize, fragCodeSize;
-	uint32 *vertCode = vkh_load_spirv("assets/spirv/grid.vert.spv", &vertCodeSize);
-	uint32 *fragCode = vkh_load_spirv("assets/spirv/grid.frag.spv", &fragCodeSize);
+	uint64 key = SNAPSHOT_HASH_INIT;
+	for(uint32 i = 0; i < s->numGalaxies; i++)
+	{
+		key = snapshot_hash(key, &galaxies[i].firstParticle, sizeof(uint32));
+		key = snapshot_hash(key, &galaxies[i].numParticles, sizeof(uint32));
+		key = snapshot_hash(key, &galaxies[i].genParams, sizeof(ParticleGenParamsGPU));
+	}
+	key = snapshot_hash(key, &s->numParticles, sizeof(uint32));
+	key = snapshot_hash(key, &particleSize, sizeof(uint32));
+	key = snapshot_hash(key, &s->particleGenShaderHash, sizeof(uint64));
 
-	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
-	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+	return key;
+}
 
-	vkh_pipeline_set_vert_shader(s->gridPipeline, vertModule);
-	vkh_pipeline_set_frag_shader(s->gridPipeline, fragModule);
+static bool _draw_load_particle_snapshot(DrawState* s, DrawParticleSet* set)
+{
+	f64 startTime = glfwGetTime();
 
-	//add descriptor set layout bindings:
+	//map file:
 	//---------------
-	VkDescriptorSetLayoutBinding storageLayoutBinding = {};
-	storageLayoutBinding.binding = 0;
-	storageLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	storageLayoutBinding.descriptorCount = 1; //camera
-	storageLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	storageLayoutBinding.pImmutableSamplers = nullptr;
+	uint64 key = _draw_particle_snapshot_key(s, set->galaxies);
 
-	vkh_pipeline_add_desc_set_binding(s->gridPipeline, storageLayoutBinding);
+	char path[256];
+	snapshot_path(key, path, sizeof(path));
 
-	//add dynamic states:
-	//---------------
-	vkh_pipeline_add_dynamic_state(s->gridPipeline, VK_DYNAMIC_STATE_VIEWPORT);
-	vkh_pipeline_add_dynamic_state(s->gridPipeline, VK_DYNAMIC_STATE_SCISSOR);
+	SnapshotFile file;
+	if(!snapshot_open(path, key, s->numParticles, sizeof(GalaxyParticle), &file))
+		return false;
 
-	//add vertex input info:
+	f64 mapTime = glfwGetTime();
+
+	//copy into the particle buffers, directly if they are host visible (UMA), otherwise through the staging ring:
 	//---------------
-	VkVertexInputBindingDescription vertBindingDescription = {};
-	vertBindingDescription.binding = 0;
-	vertBindingDescription.stride = sizeof(Vertex);
-	vertBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	const uint8* src = (const uint8*)file.data;
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		DrawParticleChunk* chunk = &set->chunks[i];
+		VkDeviceSize size = (VkDeviceSize)chunk->count * sizeof(GalaxyParticle);
+		const uint8* chunkSrc = src + (uint64)chunk->first * sizeof(GalaxyParticle);
+
+		VkMemoryPropertyFlags flags = s->instance->memProperties.memoryTypes[chunk->allocation.memoryType].propertyFlags;
+		if(chunk->allocation.mapped && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+			memcpy(chunk->allocation.mapped, chunkSrc, size);
+		else
+			vkh_upload_buffer(s->uploadContext, s->instance, chunk->buffer, 0, size, chunkSrc);
+	}
 
-	vkh_pipeline_add_vertex_input_binding(s->gridPipeline, vertBindingDescription);
+	//the mapping is only read by the host copies above, so it can be closed without waiting for the GPU:
+	vkh_upload_flush(s->uploadContext, s->instance);
+	snapshot_close(&file);
 
-	VkVertexInputAttributeDescription vertPositionAttrib = {};
-	vertPositionAttrib.binding = 0;
-	vertPositionAttrib.location = 0;
-	vertPositionAttrib.format = VK_FORMAT_R32G32B32_SFLOAT;
-	vertPositionAttrib.offset = offsetof(Vertex, pos);
+	set->genChunksDone = s->particleGenChunkCount;
 
-	VkVertexInputAttributeDescription vertTexCoordAttrib = {};
-	vertTexCoordAttrib.binding = 0;
-	vertTexCoordAttrib.location = 1;
-	vertTexCoordAttrib.format = VK_FORMAT_R32G32_SFLOAT;
-	vertTexCoordAttrib.offset = offsetof(Vertex, texCoord);
+	char message[256];
+	snprintf(message, sizeof(message), "particle cache hit (%s): loaded %u particles in %.1fms (%.1fms mapping)",
+	         path, s->numParticles, (glfwGetTime() - startTime) * 1000.0, (mapTime - startTime) * 1000.0);
+	MSG_LOG(message);
 
-	vkh_pipeline_add_vertex_input_attrib(s->gridPipeline, vertPositionAttrib);
-	vkh_pipeline_add_vertex_input_attrib(s->gridPipeline, vertTexCoordAttrib);
+	return true;
+}
 
-	//add color blend attachments:
-	//---------------
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+static void _draw_save_particle_snapshot(DrawState* s, DrawParticleSet* set)
+{
+	f64 startTime = glfwGetTime();
 
-	vkh_pipeline_add_color_blend_attachment(s->gridPipeline, colorBlendAttachment);
+	uint64 key = _draw_particle_snapshot_key(s, set->galaxies);
 
-	//add push constsants:
-	//---------------
-	VkPushConstantRange vertPushConstant = {};
-	vertPushConstant.offset = 0;
-	vertPushConstant.size = sizeof(GridParamsVertGPU);
-	vertPushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	char path[256];
+	snapshot_path(key, path, sizeof(path));
 
-	VkPushConstantRange fragPushConstant = {};
-	fragPushConstant.offset = sizeof(GridParamsVertGPU);
-	fragPushConstant.size = sizeof(GridParamsFragGPU);
-	fragPushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	SnapshotWriter writer;
+	if(!snapshot_write_begin(&writer, path, key, s->numParticles, sizeof(GalaxyParticle)))
+		return;
 
-	vkh_pipeline_add_push_constant(s->gridPipeline, vertPushConstant);
-	vkh_pipeline_add_push_constant(s->gridPipeline, fragPushConstant);
+	//create readback buffer, large enough for 1 chunk at a time:
+	//---------------
+	VkDeviceSize maxSize = 0;
+	for(uint32 i = 0; i < set->chunkCount; i++)
+		if((VkDeviceSize)set->chunks[i].count * sizeof(GalaxyParticle) > maxSize)
+			maxSize = (VkDeviceSize)set->chunks[i].count * sizeof(GalaxyParticle);
+
+	VKHallocation readbackMemory;
+	VkBuffer readbackBuffer = vkh_create_buffer(s->instance, maxSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+	                                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+	                                            &readbackMemory);
+	if(!readbackMemory.mapped)
+	{
+		vkh_destroy_buffer(s->instance, readbackBuffer, &readbackMemory);
+		readbackBuffer = vkh_create_buffer(s->instance, maxSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackMemory);
+	}
 
-	//set states:
+	if(!readbackMemory.mapped)
+	{
+		ERROR_LOG("failed to create particle readback buffer");
+		writer.failed = true;
+		snapshot_write_end(&writer);
+		vkh_destroy_buffer(s->instance, readbackBuffer, &readbackMemory);
+		return;
+	}
+
+	//copy each chunk back and append it to the file (generation was flushed before, that batch's barrier orders it):
 	//---------------
-	vkh_pipeline_set_input_assembly_state(s->gridPipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+	for(uint32 i = 0; i < set->chunkCount; i++)
+	{
+		DrawParticleChunk* chunk = &set->chunks[i];
+		VkDeviceSize size = (VkDeviceSize)chunk->count * sizeof(GalaxyParticle);
 
-	vkh_pipeline_set_raster_state(s->gridPipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
-		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+		VkCommandBuffer commandBuf = vkh_upload_command_buffer(s->uploadContext, s->instance);
 
-	vkh_pipeline_set_multisample_state(s->gridPipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+		VkBufferCopy copyRegion = {};
+		copyRegion.srcOffset = 0;
+		copyRegion.dstOffset = 0;
+		copyRegion.size = size;
+		vkCmdCopyBuffer(commandBuf, chunk->buffer, readbackBuffer, 1, &copyRegion);
 
-	vkh_pipeline_set_depth_stencil_state(s->gridPipeline, VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
 
-	vkh_pipeline_set_color_blend_state(s->gridPipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+		vkCmdPipelineBarrier(commandBuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		                     1, &barrier, 0, NULL, 0, NULL);
 
-	//generate pipeline:
-	//---------------
-	if(!vkh_pipeline_generate(s->gridPipeline, s->instance, s->finalRenderPass, 0))
-		return false;
+		vkh_upload_flush(s->uploadContext, s->instance);
+		vkh_upload_wait(s->uploadContext, s->instance);
 
-	//cleanup:
-	//---------------
-	vkh_free_spirv(vertCode);
-	vkh_free_spirv(fragCode);
+		snapshot_write(&writer, readbackMemory.mapped, size);
+	}
 
-	vkh_destroy_shader_module(s->instance, vertModule);
-	vkh_destroy_shader_module(s->instance, fragModule);
+	vkh_destroy_buffer(s->instance, readbackBuffer, &readbackMemory);
 
-	return true;
+	if(!snapshot_write_end(&writer))
+		return;
+
+	char message[256];
+	snprintf(message, sizeof(message), "wrote particle cache (%s) in %.1fms", path, (glfwGetTime() - startTime) * 1000.0);
+	MSG_LOG(message);
 }
 
-static void _draw_destroy_grid_pipeline(DrawState* s)
+//----------------------------------------------------------------------------//
+
+static void _draw_record_galaxy_update_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer)
 {
-	vkh_pipeline_cleanup(s->gridPipeline, s->instance);
-	vkh_pipeline_destroy(s->gridPipeline);
+	//small enough to go through the command buffer itself, ordered before generation and drawing by the caller's barrier:
+	vkCmdUpdateBuffer(commandBuffer, set->galaxyBuffer, 0, s->numGalaxies * sizeof(DrawGalaxyGPU), set->galaxies);
 }
 
-static bool _draw_create_grid_descriptors(DrawState* s)
+static void _draw_record_particle_gen_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer, uint32 firstGenChunk, uint32 genChunkCount)
 {
-	s->gridDescriptorSets = vkh_descriptor_sets_create(FRAMES_IN_FLIGHT);
-	if(!s->gridDescriptorSets)
-		return false;
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleGenPipeline->pipeline);
 
-	VkDescriptorBufferInfo cameraBufferInfos[FRAMES_IN_FLIGHT];
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
+	//dispatches are independent since the RNG is counter-based, the last one in each buffer may be partially filled.
+	//a dispatch can span several galaxies, each invocation looks its galaxy up in the galaxy buffer:
+	uint32 bufferIdx = 0;
+	for(uint32 i = firstGenChunk; i < firstGenChunk + genChunkCount; i++)
 	{
-		cameraBufferInfos[i].buffer = s->cameraBuffers[i];
-		cameraBufferInfos[i].offset = 0;
-		cameraBufferInfos[i].range = sizeof(CameraGPU);
-
-		vkh_descriptor_sets_add_buffers(s->gridDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 
-			0, 0, 1, &cameraBufferInfos[i]);
+		uint32 baseIdx = i * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+		while(baseIdx >= set->chunks[bufferIdx].first + set->chunks[bufferIdx].count)
+			bufferIdx++;
+
+		DrawParticleChunk* particleChunk = &set->chunks[bufferIdx];
+		uint32 localIdx = baseIdx - particleChunk->first;
+
+		ParticleGenChunkGPU chunk;
+		chunk.baseIdx = baseIdx;
+		chunk.count = particleChunk->count - localIdx < DRAW_PARTICLE_GEN_CHUNK_SIZE ? particleChunk->count - localIdx : DRAW_PARTICLE_GEN_CHUNK_SIZE;
+		chunk.numGalaxies = s->numGalaxies;
+
+		uint32 dynamicOffset = localIdx * sizeof(GalaxyParticle);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleGenPipeline->layout, 0, 1, &set->genDescriptorSets->sets[bufferIdx], 1, &dynamicOffset);
+		vkCmdPushConstants(commandBuffer, s->particleGenPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleGenChunkGPU), &chunk);
+		vkCmdDispatch(commandBuffer, (chunk.count + DRAW_PARTICLE_WORK_GROUP_SIZE - 1) / DRAW_PARTICLE_WORK_GROUP_SIZE, 1, 1);
 	}
-
-	return vkh_desctiptor_sets_generate(s->gridDescriptorSets, s->instance, s->gridPipeline->descriptorLayout);
 }
 
-static void _draw_destroy_grid_descriptors(DrawState* s)
+static void _draw_record_particle_sort_commands(DrawState* s, DrawParticleSet* set, VkCommandBuffer commandBuffer, uint32 chunkIdx)
 {
-	vkh_descriptor_sets_cleanup(s->gridDescriptorSets, s->instance);
-	vkh_descriptor_sets_destroy(s->gridDescriptorSets);
-}
+	DrawParticleChunk* particleChunk = &set->chunks[chunkIdx];
+	uint32 groupCount = (particleChunk->count + DRAW_PARTICLE_WORK_GROUP_SIZE - 1) / DRAW_PARTICLE_WORK_GROUP_SIZE;
 
-//----------------------------------------------------------------------------//
+	//generation has to finish, and so do earlier frames still reading the render buffer this uses as scratch space:
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-static bool _draw_create_particle_pipeline(DrawState* s)
-{
-	//create pipeline object:
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | s->particleDrawStage | VK_PIPELINE_STAGE_TRANSFER_BIT,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+	//compute the keys:
 	//---------------
-	s->particlePipeline = vkh_pipeline_create();
-	if(!s->particlePipeline)
-		return false;
+	ParticleSortChunkGPU chunk;
+	chunk.firstParticle = particleChunk->first;
+	chunk.count = particleChunk->count;
+	chunk.numGalaxies = s->numGalaxies;
+	chunk.pass = 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleSortPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleSortPipeline->layout, 0, 1, &set->sortDescriptorSets->sets[chunkIdx], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->particleSortPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleSortChunkGPU), &chunk);
+	vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	//sort them, the galaxy index and a 24 bit Morton code:
+	//---------------
+	vkh_radix_sort_record(s->particleSort, commandBuffer, particleChunk->count, 32);
 
-	//set shaders:
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	//gather the particles into the render buffer in sorted order, then copy them back:
 	//---------------
-	uint64 vertCodeSize, fragCodeSize;
-	uint32 *vertCode = vkh_load_spirv("assets/spirv/particle.vert.spv", &vertCodeSize);
-	uint32 *fragCode = vkh_load_spirv("assets/spirv/particle.frag.spv", &fragCodeSize);
+	chunk.pass = 1;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleSortPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleSortPipeline->layout, 0, 1, &set->sortDescriptorSets->sets[chunkIdx], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->particleSortPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleSortChunkGPU), &chunk);
+	vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = 0;
+	copyRegion.dstOffset = 0;
+	copyRegion.size = (VkDeviceSize)particleChunk->count * sizeof(GalaxyParticle);
+	vkCmdCopyBuffer(commandBuffer, s->particleRenderBuffers[chunkIdx], particleChunk->buffer, 1, &copyRegion);
+
+	//the sorted particles are read by the transform pass and copied by snapshots, the render buffer is written again:
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+}
 
-	VkShaderModule vertModule = vkh_create_shader_module(s->instance, vertCodeSize, vertCode);
-	VkShaderModule fragModule = vkh_create_shader_module(s->instance, fragCodeSize, fragCode);
+static void _draw_record_progressive_gen_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 frameIndex)
+{
+	//update the cost estimate with the timestamps this frame wrote last time (its fence has been waited on, so they are available):
+	//---------------
+	if(s->particleGenQueryChunks[frameIndex] > 0)
+	{
+		uint64 timestamps[2];
+		if(vkGetQueryPoolResults(s->instance->device, s->particleGenQueryPool, 2 * frameIndex, 2, sizeof(timestamps), timestamps,
+		                         sizeof(uint64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			f64 time = (f64)(timestamps[1] - timestamps[0]) * s->instance->properties.limits.timestampPeriod * 1e-6;
+			f64 cost = time / s->particleGenQueryChunks[frameIndex];
+
+			//smoothed, since a single frame can be disturbed by whatever else the GPU is doing:
+			if(s->particleGenChunkCost <= 0.0)
+				s->particleGenChunkCost = cost;
+			else
+				s->particleGenChunkCost = 0.75 * s->particleGenChunkCost + 0.25 * cost;
+		}
 
-	vkh_pipeline_set_vert_shader(s->particlePipeline, vertModule);
-	vkh_pipeline_set_frag_shader(s->particlePipeline, fragModule);
+		s->particleGenQueryChunks[frameIndex] = 0;
+	}
 
-	//add descriptor set layout bindings:
+	//pick the set to generate into, the front set first (progressive startup), then the back set (regeneration):
 	//---------------
-	VkDescriptorSetLayoutBinding cameraLayoutBinding = {};
-	cameraLayoutBinding.binding = 0;
-	cameraLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	cameraLayoutBinding.descriptorCount = 1;
-	cameraLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	cameraLayoutBinding.pImmutableSamplers = nullptr;
+	DrawParticleSet* front = &s->particleSets[s->frontParticleSet];
+	DrawParticleSet* back = &s->particleSets[1 - s->frontParticleSet];
 
-	VkDescriptorSetLayoutBinding particleLayoutBinding = {};
-	particleLayoutBinding.binding = 1;
-	particleLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-	particleLayoutBinding.descriptorCount = 1;
-	particleLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	particleLayoutBinding.pImmutableSamplers = nullptr;
+	DrawParticleSet* set;
+	if(front->genChunksDone < s->particleGenChunkCount)
+		set = front;
+	else if(s->regenPending)
+	{
+		//a newer request restarts the back set, whatever it had generated so far is stale:
+		memcpy(back->galaxies, s->regenGalaxies, s->numGalaxies * sizeof(DrawGalaxyGPU));
+		back->genChunksDone = 0;
+		s->regenPending = false;
 
-	vkh_pipeline_add_desc_set_binding(s->particlePipeline, cameraLayoutBinding);
-	vkh_pipeline_add_desc_set_binding(s->particlePipeline, particleLayoutBinding);
+		set = back;
+	}
+	else if(back->created && back->genChunksDone < s->particleGenChunkCount)
+		set = back;
+	else
+		return;
 
-	//add dynamic states:
-	//---------------
-	vkh_pipeline_add_dynamic_state(s->particlePipeline, VK_DYNAMIC_STATE_VIEWPORT);
-	vkh_pipeline_add_dynamic_state(s->particlePipeline, VK_DYNAMIC_STATE_SCISSOR);
+	//the back set may still be read by frames in flight (it was the front set before the last swap), or be mid-generation
+	//with older parameters, so its previous reads and writes must finish first. this only orders work on the GPU, the CPU never waits:
+	if(set == back)
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
 
-	//add color blend attachments:
-	//---------------
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_TRUE;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		                     1, &barrier, 0, NULL, 0, NULL);
+	}
 
-	vkh_pipeline_add_color_blend_attachment(s->particlePipeline, colorBlendAttachment);
+	//a restarted set gets its galaxies first (the front set's were part of the startup uploads):
+	if(set == back && set->genChunksDone == 0)
+	{
+		_draw_record_galaxy_update_commands(s, set, commandBuffer);
 
-	//add push constsants:
-	//---------------
-	VkPushConstantRange vertPushConstant = {};
-	vertPushConstant.offset = 0;
-	vertPushConstant.size = sizeof(ParticleParamsVertGPU);
-	vertPushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-	vkh_pipeline_add_push_constant(s->particlePipeline, vertPushConstant);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		                     1, &barrier, 0, NULL, 0, NULL);
+	}
 
-	//set states:
+	//decide how many dispatches fit in the budget:
 	//---------------
-	vkh_pipeline_set_input_assembly_state(s->particlePipeline, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+	uint32 genChunkCount;
+	if(s->particleGenQueryPool == VK_NULL_HANDLE)
+		genChunkCount = DRAW_PARTICLE_GEN_FALLBACK_CHUNKS;
+	else if(s->particleGenChunkCost <= 0.0)
+		genChunkCount = 1; //nothing measured yet
+	else
+		genChunkCount = (uint32)(DRAW_PARTICLE_GEN_BUDGET_MS / s->particleGenChunkCost);
+
+	if(genChunkCount < 1)
+		genChunkCount = 1;
+	if(genChunkCount > s->particleGenChunkCount - set->genChunksDone)
+		genChunkCount = s->particleGenChunkCount - set->genChunksDone;
+
+	//record dispatches:
+	//---------------
+	if(s->particleGenQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, s->particleGenQueryPool, 2 * frameIndex, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, s->particleGenQueryPool, 2 * frameIndex);
+	}
 
-	vkh_pipeline_set_raster_state(s->particlePipeline, VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE,
-		VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f);
+	_draw_record_particle_gen_commands(s, set, commandBuffer, set->genChunksDone, genChunkCount);
 
-	vkh_pipeline_set_multisample_state(s->particlePipeline, VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+	if(s->particleGenQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, s->particleGenQueryPool, 2 * frameIndex + 1);
+		s->particleGenQueryChunks[frameIndex] = genChunkCount;
+	}
 
-	vkh_pipeline_set_depth_stencil_state(s->particlePipeline, VK_FALSE, VK_FALSE, VK_COMPARE_OP_LESS, VK_FALSE, VK_FALSE, {}, {}, 0.0f, 1.0f);
+	//sort the chunks whose last dispatch was just recorded (outside the timed range, so the estimate stays per dispatch):
+	//---------------
+	if(s->mortonSort)
+		for(uint32 i = 0; i < set->chunkCount; i++)
+		{
+			uint32 firstGenChunk = set->chunks[i].first / DRAW_PARTICLE_GEN_CHUNK_SIZE;
+			uint32 lastGenChunk = (set->chunks[i].first + set->chunks[i].count - 1) / DRAW_PARTICLE_GEN_CHUNK_SIZE;
+			if(lastGenChunk < set->genChunksDone || lastGenChunk >= set->genChunksDone + genChunkCount)
+				continue;
 
-	vkh_pipeline_set_color_blend_state(s->particlePipeline, VK_FALSE, VK_LOGIC_OP_COPY, 0.0f, 0.0f, 0.0f, 0.0f);
+			_draw_record_particle_sort_commands(s, set, commandBuffer, i);
 
-	//generate pipeline:
-	//---------------
-	if(!vkh_pipeline_generate(s->particlePipeline, s->instance, s->finalRenderPass, 0))
-		return false;
+			//the front set's particles moved, so their phases no longer match and are initialized again:
+			if(set == front && s->particlePhaseChunks > firstGenChunk)
+				s->particlePhaseChunks = firstGenChunk;
+		}
 
-	//cleanup:
+	//the new particles are transformed later in this same command buffer:
 	//---------------
-	vkh_free_spirv(vertCode);
-	vkh_free_spirv(fragCode);
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
-	vkh_destroy_shader_module(s->instance, vertModule);
-	vkh_destroy_shader_module(s->instance, fragModule);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
 
-	return true;
+	set->genChunksDone += genChunkCount;
+	if(set->genChunksDone < s->particleGenChunkCount)
+		return;
+
+	//a finished back set is swapped in at this frame boundary, the barrier above makes it visible to this frame's transform pass:
+	if(set == back)
+	{
+		s->frontParticleSet = 1 - s->frontParticleSet;
+		s->particlePhaseChunks = 0;
+	}
+	else
+		MSG_LOG("finished generating particles");
 }
 
-static void _draw_destroy_particle_pipeline(DrawState* s)
+static void _draw_read_timestamps(DrawState* s, uint32 frameIndex)
 {
-	vkh_pipeline_cleanup(s->particlePipeline, s->instance);
-	vkh_pipeline_destroy(s->particlePipeline);
+	//the frame's fence has been waited on, so the timestamps it wrote last time are available:
+	if(!s->timestampsWritten[frameIndex])
+		return;
+
+	uint64 timestamps[DRAW_TIMESTAMP_COUNT];
+	if(vkGetQueryPoolResults(s->instance->device, s->timestampQueryPool, DRAW_TIMESTAMP_COUNT * frameIndex, DRAW_TIMESTAMP_COUNT, sizeof(timestamps), timestamps,
+	                         sizeof(uint64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+	{
+		//0: frame start, 1-2: transform pass, 3-4: particle draw, 5: frame end, 6-7: dust pass
+		f64 period = s->instance->properties.limits.timestampPeriod * 1e-6;
+		s->timings.frame     = (f64)(timestamps[5] - timestamps[0]) * period;
+		s->timings.transform = (f64)(timestamps[2] - timestamps[1]) * period;
+		s->timings.particles = (f64)(timestamps[4] - timestamps[3]) * period;
+		s->timings.dust      = (f64)(timestamps[7] - timestamps[6]) * period;
+	}
+
+	s->timestampsWritten[frameIndex] = false;
 }
 
-static bool _draw_create_particle_buffer(DrawState* s)
+static void _draw_read_stats(DrawState* s, uint32 frameIndex)
 {
-	s->particleBufferSize = DRAW_NUM_PARTICLES * sizeof(GalaxyParticle);
+	if(!s->statsWritten[frameIndex])
+		return;
 
-	s->particleBuffer = vkh_create_buffer(s->instance, s->particleBufferSize,
-												VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-												VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &s->particleBufferMemory);
+	//the queries were written framesInFlight frames ago and their fence has been waited on, so this never stalls.
+	//per query, in the order of the bits: vertex shader invocations, clipping invocations, fragment shader invocations
+	uint64 results[DRAW_STATS_QUERY_COUNT][3];
+	if(vkGetQueryPoolResults(s->instance->device, s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIndex, DRAW_STATS_QUERY_COUNT,
+	                         sizeof(results), results, sizeof(results[0]), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+	{
+		s->stats.gridVertices = results[DRAW_STATS_GRID][0];
+		s->stats.gridFragments = results[DRAW_STATS_GRID][2];
 
-	return true;
-}
+		s->stats.particleVertices = results[DRAW_STATS_PARTICLES][0];
+		s->stats.particlePrimitives = results[DRAW_STATS_PARTICLES][1];
+		s->stats.particleFragments = results[DRAW_STATS_PARTICLES][2];
+	}
 
-static void _draw_destroy_particle_buffer(DrawState* s)
-{
-	vkh_destroy_buffer(s->instance, s->particleBuffer, s->particleBufferMemory);
+	s->statsWritten[frameIndex] = false;
 }
 
-static bool _draw_create_particle_descriptors(DrawState* s)
+static void _draw_frustum_planes(const qm::mat4& viewProj, qm::vec4* planes, qm::vec4* depthPlane)
 {
-	s->particleDescriptorSets = vkh_descriptor_sets_create(FRAMES_IN_FLIGHT);
-	if(!s->particleDescriptorSets)
-		return false;
-
-	VkDescriptorBufferInfo cameraBufferInfos[FRAMES_IN_FLIGHT];
-	VkDescriptorBufferInfo particleBufferInfos[FRAMES_IN_FLIGHT];
-	for(int32 i = 0; i < FRAMES_IN_FLIGHT; i++)
+	//rows of the matrix, the planes are combinations of them (Gribb & Hartmann):
+	qm::vec4 rows[4];
+	for(uint32 i = 0; i < 4; i++)
+		rows[i] = qm::vec4(viewProj.m[0][i], viewProj.m[1][i], viewProj.m[2][i], viewProj.m[3][i]);
+
+	planes[0] = rows[3] + rows[0]; //left
+	planes[1] = rows[3] - rows[0]; //right
+	planes[2] = rows[3] + rows[1]; //bottom
+	planes[3] = rows[3] - rows[1]; //top
+	planes[4] = rows[3] + rows[2]; //near, the projection has no far plane
+
+	//normalized so that the shader gets distances:
+	for(uint32 i = 0; i < 5; i++)
 	{
-		cameraBufferInfos[i].buffer = s->cameraBuffers[i];
-		cameraBufferInfos[i].offset = 0;
-		cameraBufferInfos[i].range = sizeof(CameraGPU);
+		f32 len = qm::length(qm::vec3(planes[i].x, planes[i].y, planes[i].z));
+		planes[i] = planes[i] / len;
+	}
 
-		particleBufferInfos[i].buffer = s->particleBuffer;
-		particleBufferInfos[i].offset = 0;
-		particleBufferInfos[i].range = VK_WHOLE_SIZE;
+	//clip space w, which is the depth along the view direction:
+	*depthPlane = rows[3];
+}
 
-		vkh_descriptor_sets_add_buffers(s->particleDescriptorSets, i, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 
-			0, 0, 1, &cameraBufferInfos[i]);
+static void _draw_record_particle_transform_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer)
+{
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
 
-		vkh_descriptor_sets_add_buffers(s->particleDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 
-			1, 0, 1, &particleBufferInfos[i]);
+	//write params:
+	//---------------
+	ParticleParamsGPU particleParams;
+	_draw_frustum_planes(camera->viewProj, particleParams.frustumPlanes, &particleParams.depthPlane);
+	particleParams.projScale = camera->proj.m[1][1] * 0.5f * (f32)s->instance->swapchainExtent.height;
+	particleParams.minPixelSize = DRAW_PARTICLE_MIN_PIXEL_SIZE;
+	particleParams.view = camera->view;
+	particleParams.lodPixelSize = s->lod ? DRAW_LOD_PIXEL_SIZE : 0.0f;
+	particleParams.lodCellSize = DRAW_LOD_CELL_SIZE;
+	_draw_primitive_counts(s, &particleParams.countField, &particleParams.countScale, &particleParams.meshGroupSize);
+	bool splat = _draw_star_splat_active(s);
+	particleParams.splatWidth = s->instance->swapchainExtent.width;
+	particleParams.splatHeight = s->instance->swapchainExtent.height;
+	particleParams.splatPixelSize = splat ? DRAW_STAR_SPLAT_PIXEL_SIZE : 0.0f;
+	//the step is taken in double precision, only phases that are initialized this frame use the absolute time:
+	f64 time = glfwGetTime();
+	particleParams.time = (f32)time;
+	particleParams.timeStep = (f32)(time - s->particleTime);
+	s->particleTime = time;
+
+	//the dust volume is rebuilt once the particles have changed (their phases are initialized again below), or have
+	//moved far enough since the last build:
+	s->dustVolumeBuild = s->dustVolume != 0 && (!s->dustVolumeBuilt || s->particlePhaseChunks < set->genChunksDone ||
+	                                             time - s->dustVolumeTime >= s->dustVolumeInterval);
+
+	qm::vec4 lastVolumeOrigin = s->dustVolumeOrigin;
+	uint32 lastVolumeSize[3] = {s->dustVolumeSize[0], s->dustVolumeSize[1], s->dustVolumeSize[2]};
+	f64 lastVolumeTime = s->dustVolumeTime;
+	if(s->dustVolumeBuild)
+	{
+		_draw_dust_volume_bounds(s, set->galaxies);
+		s->dustVolumeTime = time;
 	}
 
-	return vkh_desctiptor_sets_generate(s->particleDescriptorSets, s->instance, s->particlePipeline->descriptorLayout);
-}
+	for(uint32 i = 0; i < 3; i++)
+	{
+		particleParams.pad[i] = 0;
+		particleParams.volumeSize[i] = s->dustVolumeSize[i];
+	}
+	particleParams.volumeOrigin = s->dustVolumeOrigin;
+	particleParams.volumeBuild = s->dustVolumeBuild ? 1 : 0;
 
-static void _draw_destroy_particle_descriptors(DrawState* s)
-{
-	vkh_descriptor_sets_cleanup(s->particleDescriptorSets, s->instance);
-	vkh_descriptor_sets_destroy(s->particleDescriptorSets);
-}
+	particleParams.numGalaxies = s->numGalaxies;
+	particleParams.starSize = 10.0f;
+	particleParams.dustSize = 500.0f;
+	particleParams.h2Size = 150.0f;
+	particleParams.h2Dist = 300.0f;
 
-//----------------------------------------------------------------------------//
+	uint32 paramsOffset = vkh_uniform_ring_push(s->uniformRing, sizeof(ParticleParamsGPU), &particleParams);
 
-static bool _draw_initialize_particles(DrawState* s)
-{
-	VKHcomputePipeline* pipeline;
-	VKHdescriptorSets* descriptorSets;
+	//without params nothing is splatted into the volume, so the build is put off and the last grid stays in use:
+	if(paramsOffset == VKH_UNIFORM_RING_FULL && s->dustVolumeBuild)
+	{
+		s->dustVolumeBuild = false;
+		s->dustVolumeOrigin = lastVolumeOrigin;
+		for(uint32 i = 0; i < 3; i++)
+			s->dustVolumeSize[i] = lastVolumeSize[i];
+		s->dustVolumeTime = lastVolumeTime;
+	}
 
-	//create pipeline:
+	//the previous frame may still be drawing from the render and draw buffers, and its phases are read here:
 	//---------------
-	pipeline = vkh_compute_pipeline_create();
-	if(!pipeline)
-		return false;
+	VkMemoryBarrier phaseBarrier = {};
+	phaseBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	phaseBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	phaseBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-	uint64 computeCodeSize;
-	uint32 *computeCode = vkh_load_spirv("assets/spirv/particle_generate.comp.spv", &computeCodeSize);
-	VkShaderModule computeModule = vkh_create_shader_module(s->instance, computeCodeSize, computeCode);
-	vkh_compute_pipeline_set_shader(pipeline, computeModule);
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | s->particleDrawStage | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &phaseBarrier, 0, NULL, 0, NULL);
 
-	VkDescriptorSetLayoutBinding particleLayoutBinding = {};
-	particleLayoutBinding.binding = 0;
-	particleLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
-	particleLayoutBinding.descriptorCount = 1;
-	particleLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	particleLayoutBinding.pImmutableSamplers = nullptr;
+	//reset the counts and the LOD nodes, the transform pass appends to them:
+	//---------------
+	for(uint32 i = 0; i < DRAW_COMMAND_CHUNKS + s->particleRenderChunkCount * 2; i++)
+	{
+		vkCmdFillBuffer(commandBuffer, s->particleDrawBuffer, i * DRAW_COMMAND_SIZE + particleParams.countField * sizeof(uint32), sizeof(uint32), 0);
+		if(particleParams.meshGroupSize != 0)
+			vkCmdFillBuffer(commandBuffer, s->particleDrawBuffer, i * DRAW_COMMAND_SIZE, sizeof(uint32), 0);
+	}
 
-	vkh_compute_pipeline_add_desc_set_binding(pipeline, particleLayoutBinding);
+	if(s->lod)
+		vkCmdFillBuffer(commandBuffer, s->lodNodeBuffer, 0, VK_WHOLE_SIZE, 0);
 
-	VkPushConstantRange pushConstant = {};
-	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-	pushConstant.offset = 0;
-	pushConstant.size = sizeof(ParticleGenParamsGPU);
+	if(splat)
+		vkCmdFillBuffer(commandBuffer, s->splatBuffer, 0, (VkDeviceSize)particleParams.splatWidth * particleParams.splatHeight * 3 * sizeof(uint32), 0);
 
-	vkh_compute_pipeline_add_push_constant(pipeline, pushConstant);
+	if(s->dustVolumeBuild)
+		vkCmdFillBuffer(commandBuffer, s->dustVolumeBuffer, 0, (VkDeviceSize)s->dustVolumeSize[0] * s->dustVolumeSize[1] * s->dustVolumeSize[2] * 3 * sizeof(uint32), 0);
 
-	if(!vkh_compute_pipeline_generate(pipeline, s->instance))
-		return false;
+	VkMemoryBarrier resetBarrier = {};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-	//create descriptor sets:
-	//---------------
-	descriptorSets = vkh_descriptor_sets_create(1);
-	if(!descriptorSets)
-		return false;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &resetBarrier, 0, NULL, 0, NULL);
 
-	VkDescriptorBufferInfo particleBufferInfo = {};
-	particleBufferInfo.buffer = s->particleBuffer;
-	particleBufferInfo.offset = 0;
-	particleBufferInfo.range = VK_WHOLE_SIZE;
+	//without params nothing is transformed, the counts reset above draw nothing this frame:
+	if(paramsOffset == VKH_UNIFORM_RING_FULL)
+		ERROR_LOG("no uniform ring space for the particle params, skipping transform");
+	else
+	{
+		//transform and cull each chunk (only the particles generated so far):
+		//---------------
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleTransformPipeline->pipeline);
 
-	vkh_descriptor_sets_add_buffers(descriptorSets, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
-		0, 0, 1, &particleBufferInfo);
-	
-	if(!vkh_desctiptor_sets_generate(descriptorSets, s->instance, pipeline->descriptorLayout))
-		return false;
+		uint64 numGenerated = (uint64)set->genChunksDone * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+		uint64 numPhases = (uint64)s->particlePhaseChunks * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+		for(uint32 i = 0; i < set->chunkCount && set->chunks[i].first < numGenerated; i++)
+		{
+			DrawParticleChunk* chunk = &set->chunks[i];
+
+			ParticleTransformChunkGPU transformChunk;
+			transformChunk.firstParticle = chunk->first;
+			transformChunk.count = numGenerated - chunk->first < chunk->count ? (uint32)(numGenerated - chunk->first) : chunk->count;
+			transformChunk.chunkIdx = i;
+			transformChunk.renderSize = chunk->count;
+			if(numPhases <= chunk->first)
+				transformChunk.numPhases = 0;
+			else
+				transformChunk.numPhases = numPhases - chunk->first < transformChunk.count ? (uint32)(numPhases - chunk->first) : transformChunk.count;
+
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->particleTransformPipeline->layout, 0, 1, &set->transformDescriptorSets->sets[i], 1, &paramsOffset);
+			vkCmdPushConstants(commandBuffer, s->particleTransformPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleTransformChunkGPU), &transformChunk);
+			vkCmdDispatch(commandBuffer, (transformChunk.count + DRAW_PARTICLE_WORK_GROUP_SIZE - 1) / DRAW_PARTICLE_WORK_GROUP_SIZE, 1, 1);
+		}
 
-	//run pipeline:
-	//---------------
-	VkCommandBuffer commandBuf = vkh_start_single_time_command(s->instance);
+		s->particlePhaseChunks = set->genChunksDone;
 
-	ParticleGenParamsGPU params;
-	params.numStars = DRAW_NUM_STARS;
-	params.maxRad = 3500.0f;
-	params.bulgeRad = 1250.0f;
-	params.angleOffset = 6.28f;
-	params.eccentricity = 0.85f;
-	params.baseHeight = 300.0f;
-	params.height = 250.0f;
-	params.minTemp = 3000.0f;
-	params.maxTemp = 9000.0f;
-	params.dustBaseTemp = 4000.0f;
-	params.minStarOpacity = 0.1f;
-	params.maxStarOpacity = 0.5f;
-	params.minDustOpacity = 0.01f;
-	params.maxDustOpacity = 0.05f;
-	params.speed = 10.0f;
+		//turn the nodes the stars were aggregated into into impostors:
+		//---------------
+		if(s->lod)
+		{
+			VkMemoryBarrier nodeBarrier = {};
+			nodeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			nodeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			nodeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-	uint32 dynamicOffset = 0;
-	vkCmdBindPipeline(commandBuf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
-	vkCmdBindDescriptorSets(commandBuf, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->layout, 0, 1, &descriptorSets->sets[0], 1, &dynamicOffset);
-	vkCmdPushConstants(commandBuf, pipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleGenParamsGPU), &params);
-	vkCmdDispatch(commandBuf, DRAW_NUM_PARTICLES / DRAW_PARTICLE_WORK_GROUP_SIZE, 1, 1);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			                     1, &nodeBarrier, 0, NULL, 0, NULL);
 
-	vkh_end_single_time_command(s->instance, commandBuf);
+			uint32 commandIdx = DRAW_COMMAND_LOD;
 
-	vkDeviceWaitIdle(s->instance->device);
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->lodPipeline->pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->lodPipeline->layout, 0, 1, &s->lodDescriptorSets->sets[0], 1, &paramsOffset);
+			vkCmdPushConstants(commandBuffer, s->lodPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32), &commandIdx);
+			vkCmdDispatch(commandBuffer, DRAW_LOD_TABLE_SIZE / DRAW_PARTICLE_WORK_GROUP_SIZE, 1, 1);
+		}
+	}
 
-	//cleanup:
+	//the render particles and their counts are drawn later in this same command buffer:
 	//---------------
-	vkh_descriptor_sets_cleanup(descriptorSets, s->instance);
-	vkh_descriptor_sets_destroy(descriptorSets);
-	
-	vkh_compute_pipeline_cleanup(pipeline, s->instance);
-	vkh_compute_pipeline_destroy(pipeline);
-
-	vkh_free_spirv(computeCode);
-	vkh_destroy_shader_module(s->instance, computeModule);
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
 
-	return true;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | s->particleDrawStage |
+	                     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
 }
 
-//----------------------------------------------------------------------------//
-
 static void _draw_record_render_pass_start_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx)
 {
 	//render pass begin:
@@ -1058,7 +4234,7 @@ static void _draw_record_render_pass_start_commands(DrawState* s, VkCommandBuffe
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx)
+static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 cameraOffset)
 {
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->gridPipeline->pipeline);
 
@@ -1069,11 +4245,9 @@ static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkComma
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 	vkCmdBindIndexBuffer(commandBuffer, s->quadIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->gridPipeline->layout, 0, 1, &s->gridDescriptorSets->sets[frameIndex], 0, nullptr);
-
 	int32 numCells = 16;
 
-	//send vertex stage params:
+	//compute vertex stage params:
 	//---------------
 	int32 windowW, windowH;
 	glfwGetWindowSize(s->instance->window, &windowW, &windowH);	//TODO: FIGURE OUT WHY IT GETS CUT OFF WITH VERY TALL WINDOWS
@@ -1089,66 +4263,555 @@ static void _draw_record_grid_commands(DrawState* s, DrawParams* params, VkComma
 
 	qm::mat4 model = qm::translate(pos) * qm::scale(qm::vec3(size, size, size));
 
-	GridParamsVertGPU vertParams = {model};
-	vkCmdPushConstants(commandBuffer, s->gridPipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(GridParamsVertGPU), &vertParams);
-
-	//send fragment stage params:
+	//compute fragment stage params:
 	//---------------
 	f32 thickness = 0.0125f;
 	f32 scroll = (params->cam.dist - powf(2.0f, roundf(log2f(params->cam.dist) - 0.5f))) / (4.0f * powf(2.0f, roundf(log2f(params->cam.dist) - 1.5f))) + 0.5f;
 	qm::vec3 offset3 = (params->cam.target - pos) / size;
 	qm::vec2 offset = qm::vec2(offset3.x, offset3.z);
 
-	GridParamsFragGPU fragParams = {offset, numCells, thickness, scroll};
-	vkCmdPushConstants(commandBuffer, s->gridPipeline->layout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(GridParamsVertGPU), sizeof(GridParamsFragGPU), &fragParams);
+	//write params and bind descriptor sets:
+	//---------------
+	GridParamsGPU gridParams;
+	gridParams.model = model;
+	gridParams.offset = offset;
+	gridParams.numCells = numCells;
+	gridParams.thickness = thickness;
+	gridParams.scroll = scroll;
+
+	uint32 dynamicOffsets[2];
+	dynamicOffsets[0] = cameraOffset;
+	dynamicOffsets[1] = vkh_uniform_ring_push(s->uniformRing, sizeof(GridParamsGPU), &gridParams);
+	if(dynamicOffsets[1] == VKH_UNIFORM_RING_FULL)
+	{
+		ERROR_LOG("no uniform ring space for the grid params, skipping grid");
+		return;
+	}
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->gridPipeline->layout, 0, 1, &s->gridDescriptorSets->sets[0], 2, dynamicOffsets);
 
 	//draw:
 	//---------------
 	vkCmdDrawIndexed(commandBuffer, 6, 1, 0, 0, 0);
 }
 
-static void _draw_record_particle_commands(DrawState* s, DrawParams* params, VkCommandBuffer commandBuffer, uint32 frameIndex, uint32 imageIdx)
+static void _draw_record_particle_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset, bool dustPass)
+{
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
+
+	if(s->primitiveMode == CONFIG_PRIMITIVE_INSTANCED)
+	{
+		VkBuffer vertexBuffers[] = {s->quadVertexBuffer};
+		VkDeviceSize offsets[] = {0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, s->quadIndexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	uint32 height = dustPass ? s->dustExtent.height : s->instance->swapchainExtent.height;
+
+	ParticleDrawGPU particleDraw;
+	particleDraw.pointScale = camera->proj.m[1][1] * 0.5f * (f32)height; //like projScale of the transform pass
+	particleDraw.maxPointSize = s->instance->properties.limits.pointSizeRange[1];
+	particleDraw.lastParticle = 0;
+
+	//draw each type with its own pipeline, only the particles that survived this frame's culling (the GPU writes their
+	//counts). every galaxy is drawn together. with a dust pass, the dust is only drawn there and nothing else is. with
+	//the dust volume, the dust is never drawn:
+	//---------------
+	uint64 numGenerated = (uint64)set->genChunksDone * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+	for(uint32 type = 0; type < DRAW_PARTICLE_TYPE_COUNT; type++)
+	{
+		if(s->dustTarget && (type == DRAW_PARTICLE_DUST) != dustPass)
+			continue;
+
+		if(s->dustVolume != 0 && type == DRAW_PARTICLE_DUST)
+			continue;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->particlePipelines[type]->pipeline);
+
+		//the H2 regions of every chunk are in 1 range:
+		if(type == DRAW_PARTICLE_H2)
+		{
+			particleDraw.commandIdx = DRAW_COMMAND_H2;
+			_draw_record_particle_draw(s, commandBuffer, type, s->particleH2DescriptorSets->sets[0], &particleDraw, cameraOffset);
+			continue;
+		}
+
+		//the stars and dust of each chunk:
+		for(uint32 i = 0; i < s->particleRenderChunkCount && set->chunks[i].first < numGenerated; i++)
+		{
+			particleDraw.commandIdx = DRAW_COMMAND_CHUNKS + i * 2 + type;
+			particleDraw.lastParticle = set->chunks[i].count - 1;
+			_draw_record_particle_draw(s, commandBuffer, type, s->particleDescriptorSets->sets[i], &particleDraw, cameraOffset);
+		}
+
+		//the LOD impostors are drawn like stars:
+		if(type == DRAW_PARTICLE_STAR && s->lod)
+		{
+			particleDraw.commandIdx = DRAW_COMMAND_LOD;
+			_draw_record_particle_draw(s, commandBuffer, type, s->lodImpostorDescriptorSets->sets[0], &particleDraw, cameraOffset);
+		}
+	}
+}
+
+static void _draw_record_particle_draw(DrawState* s, VkCommandBuffer commandBuffer, uint32 type, VkDescriptorSet descriptorSet,
+                                       const ParticleDrawGPU* particleDraw, uint32 cameraOffset)
+{
+	VKHgraphicsPipeline* pipeline = s->particlePipelines[type];
+
+	uint32 dynamicOffsets[2];
+	dynamicOffsets[0] = cameraOffset;
+	dynamicOffsets[1] = 0;
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->layout, 0, 1, &descriptorSet, 2, dynamicOffsets);
+	vkCmdPushConstants(commandBuffer, pipeline->layout, s->primitiveMode == CONFIG_PRIMITIVE_MESH ? VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_VERTEX_BIT,
+	                   0, sizeof(ParticleDrawGPU), particleDraw);
+
+	VkDeviceSize commandOffset = particleDraw->commandIdx * DRAW_COMMAND_SIZE;
+	if(s->primitiveMode == CONFIG_PRIMITIVE_INSTANCED)
+		vkCmdDrawIndexedIndirect(commandBuffer, s->particleDrawBuffer, commandOffset, 1, DRAW_COMMAND_SIZE);
+	else if(s->primitiveMode == CONFIG_PRIMITIVE_MESH)
+		vkh_cmd_draw_mesh_tasks_indirect(s->instance, commandBuffer, s->particleDrawBuffer, commandOffset, 1, DRAW_COMMAND_SIZE);
+	else
+		vkCmdDrawIndirect(commandBuffer, s->particleDrawBuffer, commandOffset, 1, DRAW_COMMAND_SIZE);
+}
+
+static void _draw_record_star_splat_commands(DrawState* s, VkCommandBuffer commandBuffer)
 {
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->particlePipeline->pipeline);
+	//add the splatted stars to the frame, with 1 triangle covering the screen:
+	uint32 width = s->instance->swapchainExtent.width;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->splatPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->splatPipeline->layout, 0, 1, &s->splatDescriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->splatPipeline->layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(uint32), &width);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
 
-	//bind descriptor sets:
+static void _draw_record_dust_pass_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset)
+{
+	//render pass begin:
 	//---------------
-	uint32 dynamicOffset = 0;
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->particlePipeline->layout, 0, 1, &s->particleDescriptorSets->sets[frameIndex], 1, &dynamicOffset);
+	VkRenderPassBeginInfo renderBeginInfo = {};
+	renderBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderBeginInfo.renderPass = s->dustRenderPass;
+	renderBeginInfo.framebuffer = s->dustFramebuffer;
+	renderBeginInfo.renderArea.offset = {0, 0};
+	renderBeginInfo.renderArea.extent = s->dustExtent;
+
+	VkClearValue clearValue;
+	clearValue.color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+
+	renderBeginInfo.clearValueCount = 1;
+	renderBeginInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-	//send vertex stage params:
+	//set viewport and scissor, flipped like the final render pass so the composite maps pixels directly:
 	//---------------
-	ParticleParamsVertGPU vertParams;
-	vertParams.time = (float)glfwGetTime();
-	vertParams.numStars = DRAW_NUM_STARS;
-	vertParams.starSize = 10.0f;
-	vertParams.dustSize = 500.0f;
-	vertParams.h2Size = 150.0f;
-	vertParams.h2Dist = 300.0f;
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = (f32)s->dustExtent.height;
+	viewport.width = (f32)s->dustExtent.width;
+	viewport.height = -(f32)s->dustExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-	vkCmdPushConstants(commandBuffer, s->particlePipeline->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleParamsVertGPU), &vertParams);
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = s->dustExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
 	//draw:
 	//---------------
-	vkCmdDraw(commandBuffer, 6 * DRAW_NUM_PARTICLES, 1, 0, 0);
+	_draw_record_particle_commands(s, camera, commandBuffer, cameraOffset, true);
+
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+static void _draw_record_dust_composite_commands(DrawState* s, VkCommandBuffer commandBuffer)
+{
+	//upsample the dust and add it to the frame, with 1 triangle covering the screen:
+	qm::vec2 sizes[2];
+	sizes[0] = qm::vec2(1.0f / s->instance->swapchainExtent.width, 1.0f / s->instance->swapchainExtent.height);
+	sizes[1] = qm::vec2(1.0f / s->dustExtent.width, 1.0f / s->dustExtent.height);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->dustCompositePipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->dustCompositePipeline->layout, 0, 1, &s->dustCompositeDescriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->dustCompositePipeline->layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(sizes), sizes);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+static void _draw_record_dust_compute_commands(DrawState* s, VkCommandBuffer commandBuffer, uint32 cameraOffset)
+{
+	DrawParticleSet* set = &s->particleSets[s->frontParticleSet];
+
+	uint32 meshGroupSize;
+	DustSplatParamsGPU params = {};
+	_draw_primitive_counts(s, &params.countField, &params.countScale, &meshGroupSize);
+	params.width = s->dustExtent.width;
+	params.height = s->dustExtent.height;
+	params.tilesX = s->dustTilesX;
+	params.tilesY = s->dustTilesY;
+	params.maxSplats = s->dustMaxSplats;
+	params.maxTileSplats = DRAW_DUST_MAX_TILE_SPLATS;
+
+	//reset the tile counts and the splats (the transform pass's first barrier ordered this after last frame's use):
+	//---------------
+	uint32 splatHeader[4] = {0, 1, 1, 0}; //no scatter workgroups, no splats
+	vkCmdFillBuffer(commandBuffer, s->dustTileBuffer, 0, VK_WHOLE_SIZE, 0);
+	vkCmdUpdateBuffer(commandBuffer, s->dustSplatBuffer, 0, sizeof(splatHeader), splatHeader);
+
+	//the render particles, the resets and the target (which is overwritten entirely) become visible to the passes:
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	VkImageMemoryBarrier imageBarrier = {};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcAccessMask = 0;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = s->dustImage;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange.baseMipLevel = 0;
+	imageBarrier.subresourceRange.levelCount = 1;
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 1, &imageBarrier);
+
+	//project the dust of each chunk into splats, counting the splats of each tile:
+	//---------------
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustSplatPipeline->pipeline);
+
+	uint64 numGenerated = (uint64)set->genChunksDone * DRAW_PARTICLE_GEN_CHUNK_SIZE;
+	for(uint32 i = 0; i < s->particleRenderChunkCount && set->chunks[i].first < numGenerated; i++)
+	{
+		params.pass = 0;
+		params.commandIdx = DRAW_COMMAND_CHUNKS + i * 2 + DRAW_PARTICLE_DUST;
+		params.lastParticle = set->chunks[i].count - 1;
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustSplatPipeline->layout, 0, 1, &s->dustSplatDescriptorSets->sets[i], 1, &cameraOffset);
+		vkCmdPushConstants(commandBuffer, s->dustSplatPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DustSplatParamsGPU), &params);
+		vkCmdDispatch(commandBuffer, (set->chunks[i].count + DRAW_PARTICLE_WORK_GROUP_SIZE - 1) / DRAW_PARTICLE_WORK_GROUP_SIZE, 1, 1);
+	}
+
+	//turn the counts into the offsets of the tiles' lists:
+	//---------------
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	vkh_scan_record(s->dustTileScan, commandBuffer, s->dustTilesX * s->dustTilesY);
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	//scatter the splats into the lists, as many workgroups as the project pass needed:
+	//---------------
+	params.pass = 1;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustSplatPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustSplatPipeline->layout, 0, 1, &s->dustSplatDescriptorSets->sets[0], 1, &cameraOffset);
+	vkCmdPushConstants(commandBuffer, s->dustSplatPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DustSplatParamsGPU), &params);
+	vkCmdDispatchIndirect(commandBuffer, s->dustSplatBuffer, 0);
+
+	//shade the tiles, each pixel is written once:
+	//---------------
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+
+	params.pass = 2;
+
+	vkCmdPushConstants(commandBuffer, s->dustSplatPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DustSplatParamsGPU), &params);
+	vkCmdDispatch(commandBuffer, s->dustTilesX, s->dustTilesY, 1);
+
+	//the composite samples the target in the final render pass:
+	//---------------
+	imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+	                     0, NULL, 0, NULL, 1, &imageBarrier);
+}
+
+static void _draw_record_dust_volume_resolve_commands(DrawState* s, VkCommandBuffer commandBuffer)
+{
+	//the transform pass has splatted the dust, the previous raymarch has to be done reading the texture:
+	//---------------
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkImageMemoryBarrier imageBarrier = {};
+	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageBarrier.srcAccessMask = 0;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED; //the whole texture is written
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageBarrier.image = s->dustVolumeImage;
+	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageBarrier.subresourceRange.baseMipLevel = 0;
+	imageBarrier.subresourceRange.levelCount = 1;
+	imageBarrier.subresourceRange.baseArrayLayer = 0;
+	imageBarrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+	                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 1, &imageBarrier);
+
+	//resolve every voxel of the texture, the ones outside the grid are cleared:
+	//---------------
+	uint32 size[4] = {s->dustVolumeSize[0], s->dustVolumeSize[1], s->dustVolumeSize[2], s->dustVolume};
+	uint32 groups = (s->dustVolume + DRAW_DUST_VOLUME_GROUP_SIZE - 1) / DRAW_DUST_VOLUME_GROUP_SIZE;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustVolumeResolvePipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, s->dustVolumeResolvePipeline->layout, 0, 1, &s->dustVolumeResolveDescriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->dustVolumeResolvePipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(size), size);
+	vkCmdDispatch(commandBuffer, groups, groups, groups);
+
+	//the raymarch samples the texture in the final render pass, of this frame and the ones until the next build:
+	//---------------
+	imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+	                     0, NULL, 0, NULL, 1, &imageBarrier);
+
+	s->dustVolumeBuilt = true;
+}
+
+static void _draw_record_dust_volume_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer)
+{
+	//march the texture along every pixel's ray, with 1 triangle covering the screen. the rays are unprojected without
+	//the camera's translation, which would cost them their precision far from the origin:
+	qm::mat4 invView = qm::inverse(camera->view);
+	qm::mat4 rotation = camera->view;
+	rotation.m[3][0] = rotation.m[3][1] = rotation.m[3][2] = 0.0f;
+
+	DustVolumeParamsGPU params;
+	params.invViewProj = qm::inverse(camera->proj * rotation);
+	params.camPos = qm::vec4(invView.m[3][0], invView.m[3][1], invView.m[3][2], 1.0f);
+	params.origin = s->dustVolumeOrigin;
+	params.size = qm::vec4((f32)s->dustVolumeSize[0], (f32)s->dustVolumeSize[1], (f32)s->dustVolumeSize[2], (f32)s->dustVolume);
+	params.invFrameSize = qm::vec2(1.0f / s->instance->swapchainExtent.width, 1.0f / s->instance->swapchainExtent.height);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->dustVolumePipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->dustVolumePipeline->layout, 0, 1, &s->dustVolumeDescriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, s->dustVolumePipeline->layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(DustVolumeParamsGPU), &params);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+static void _draw_record_overdraw_pass_commands(DrawState* s, const CameraGPU* camera, VkCommandBuffer commandBuffer, uint32 cameraOffset, uint32 frameIndex)
+{
+	//render pass begin:
+	//---------------
+	VkRenderPassBeginInfo renderBeginInfo = {};
+	renderBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderBeginInfo.renderPass = s->overdrawRenderPass;
+	renderBeginInfo.framebuffer = s->overdrawFramebuffer;
+	renderBeginInfo.renderArea.offset = {0, 0};
+	renderBeginInfo.renderArea.extent = s->instance->swapchainExtent;
+
+	VkClearValue clearValue;
+	clearValue.color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+
+	renderBeginInfo.clearValueCount = 1;
+	renderBeginInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	//set viewport and scissor, flipped like the final render pass so the heatmap maps pixels directly:
+	//---------------
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = (f32)s->instance->swapchainExtent.height;
+	viewport.width = (f32)s->instance->swapchainExtent.width;
+	viewport.height = -(f32)s->instance->swapchainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = s->instance->swapchainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	//draw, counted by the particles' statistics query like the particles of the final render pass would be:
+	//---------------
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		vkCmdBeginQuery(commandBuffer, s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIndex + DRAW_STATS_PARTICLES, 0);
+
+	_draw_record_particle_commands(s, camera, commandBuffer, cameraOffset, false);
+
+	if(s->statsQueryPool != VK_NULL_HANDLE)
+		vkCmdEndQuery(commandBuffer, s->statsQueryPool, DRAW_STATS_QUERY_COUNT * frameIndex + DRAW_STATS_PARTICLES);
+
+	vkCmdEndRenderPass(commandBuffer);
+}
+
+static void _draw_record_overdraw_heatmap_commands(DrawState* s, VkCommandBuffer commandBuffer)
+{
+	//show the counts in place of the particles, with 1 triangle covering the screen:
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->overdrawPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, s->overdrawPipeline->layout, 0, 1, &s->overdrawDescriptorSets->sets[0], 0, NULL);
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+//whether this frame's stars are splatted, the accumulation buffer has to fit the swapchain
+//splatted stars never reach the particle draws, so the overdraw view turns splatting off to count them
+static bool _draw_star_splat_active(DrawState* s)
+{
+	return s->starSplat && !s->overdraw && (uint64)s->instance->swapchainExtent.width * s->instance->swapchainExtent.height <= s->splatCapacity;
+}
+
+//fits the dust volume's grid around the galaxies, with cubic voxels and a voxel of border on every side. also sets how
+//long until the next build: the dust moves at most speed * sqrt(maxRad) (see particle_generate.comp), and may move
+//DRAW_DUST_VOLUME_MAX_DRIFT voxels
+static void _draw_dust_volume_bounds(DrawState* s, const DrawGalaxyGPU* galaxies)
+{
+	qm::vec3 minPos = qm::vec3(INFINITY, INFINITY, INFINITY);
+	qm::vec3 maxPos = qm::vec3(-INFINITY, -INFINITY, -INFINITY);
+	f32 maxSpeed = 0.0f;
+
+	for(uint32 i = 0; i < s->numGalaxies; i++)
+	{
+		const DrawGalaxyGPU* galaxy = &galaxies[i];
+		const ParticleGenParamsGPU* gen = &galaxy->genParams;
+
+		//the box around the dust's orbits and heights in the galaxy's space, transformed into world space:
+		f32 rad = gen->maxRad * (gen->eccentricity > 1.0f ? gen->eccentricity : 1.0f);
+		qm::vec3 localMin = qm::vec3(-rad, gen->baseHeight - 0.5f * gen->height, -rad);
+		qm::vec3 localMax = qm::vec3(rad, gen->baseHeight + 0.5f * gen->height, rad);
+
+		for(uint32 j = 0; j < 8; j++)
+		{
+			qm::vec4 corner = qm::vec4(j & 1 ? localMax.x : localMin.x, j & 2 ? localMax.y : localMin.y,
+			                           j & 4 ? localMax.z : localMin.z, 1.0f);
+			qm::vec4 pos = galaxy->model * corner;
+
+			minPos = qm::min(minPos, qm::vec3(pos.x, pos.y, pos.z));
+			maxPos = qm::max(maxPos, qm::vec3(pos.x, pos.y, pos.z));
+		}
+
+		f32 scale = qm::length(qm::vec3(galaxy->model.m[0][0], galaxy->model.m[0][1], galaxy->model.m[0][2]));
+		f32 speed = gen->speed * sqrtf(gen->maxRad) * (rad / gen->maxRad) * scale;
+		if(speed > maxSpeed)
+			maxSpeed = speed;
+	}
+
+	qm::vec3 extent = maxPos - minPos;
+	f32 maxExtent = extent.x > extent.y ? extent.x : extent.y;
+	maxExtent = extent.z > maxExtent ? extent.z : maxExtent;
+
+	f32 voxelSize = maxExtent / (f32)(s->dustVolume - 2);
+	for(uint32 i = 0; i < 3; i++)
+	{
+		uint32 size = (uint32)ceilf(extent[i] / voxelSize) + 2;
+		s->dustVolumeSize[i] = size < s->dustVolume ? size : s->dustVolume;
+	}
+
+	s->dustVolumeOrigin = qm::vec4(minPos - qm::vec3(voxelSize, voxelSize, voxelSize), voxelSize);
+	s->dustVolumeInterval = maxSpeed > 0.0f ? DRAW_DUST_VOLUME_MAX_DRIFT * voxelSize / maxSpeed : INFINITY;
+}
+
+//how the visible particles are counted in the draw commands of the primitive mode, see append_draw in particle_transform.comp
+static void _draw_primitive_counts(DrawState* s, uint32* countField, uint32* countScale, uint32* meshGroupSize)
+{
+	*meshGroupSize = 0;
+
+	switch(s->primitiveMode)
+	{
+	case CONFIG_PRIMITIVE_INSTANCED: //instanceCount
+		*countField = 1;
+		*countScale = 1;
+		break;
+	case CONFIG_PRIMITIVE_POINTS: //vertexCount
+		*countField = 0;
+		*countScale = 1;
+		break;
+	case CONFIG_PRIMITIVE_MESH: //the particle count after the command, groupCountX follows from it
+		*countField = 3;
+		*countScale = 1;
+		*meshGroupSize = DRAW_PARTICLE_MESH_GROUP_SIZE;
+		break;
+	default: //vertexCount, 6 per particle
+		*countField = 0;
+		*countScale = 6;
+		break;
+	}
 }
 
 //----------------------------------------------------------------------------//
 
-static void _draw_window_resized(DrawState* s)
+//recreates the swapchain if the window's framebuffer changed size or the swapchain was reported out of date, at most
+//once per frame however many resize events arrived since the last one. returns false while the window is minimized
+//or the swapchain could not be recreated
+static bool _draw_update_swapchain(DrawState* s)
 {
 	int32 w, h;
 	glfwGetFramebufferSize(s->instance->window, &w, &h);
 	if(w == 0 || h == 0)
-		return;
+		return false;
 
-	vkh_resize_swapchain(s->instance, w, h);
+	if(!s->swapchainOutdated && (uint32)w == s->windowExtent.width && (uint32)h == s->windowExtent.height)
+		return true;
 
-	_draw_destroy_depth_buffer(s);
-	_draw_create_depth_buffer(s);
+	return _draw_window_resized(s, (uint32)w, (uint32)h);
+}
+
+//nothing is waited on, the old objects are retired into the deletion queue and the new ones are used from this frame on.
+//on failure the swapchain stays outdated, so frames are skipped and the recreation is tried again on the next one
+static bool _draw_window_resized(DrawState* s, uint32 width, uint32 height)
+{
+	s->windowExtent.width = width;
+	s->windowExtent.height = height;
+	s->swapchainOutdated = true;
+
+	if(!vkh_recreate_swapchain(s->instance, width, height, s->deletionQueue))
+	{
+		ERROR_LOG("failed to recreate swapchain");
+		return false;
+	}
 
+	//retire everything sized after the old swapchain, then create it again in dependency order:
+	//---------------
+	_draw_destroy_overdraw_target(s);
+	_draw_destroy_dust_tiles(s);
+	_draw_destroy_dust_target(s);
 	_draw_destroy_framebuffers(s);
-	_draw_create_framebuffers(s);
+	_draw_destroy_depth_buffer(s);
+
+	bool created = _draw_create_depth_buffer(s) && _draw_create_framebuffers(s) && _draw_create_dust_target(s) &&
+	               _draw_create_dust_tiles(s) && _draw_create_overdraw_target(s);
+	if(!created)
+	{
+		ERROR_LOG("failed to recreate window sized objects");
+
+		//the partially created objects are retired too, the destroy functions skip whatever was never created:
+		_draw_destroy_overdraw_target(s);
+		_draw_destroy_dust_tiles(s);
+		_draw_destroy_dust_target(s);
+		_draw_destroy_framebuffers(s);
+		_draw_destroy_depth_buffer(s);
+		return false;
+	}
+
+	s->swapchainOutdated = false;
+	return true;
 }
 
 //----------------------------------------------------------------------------//
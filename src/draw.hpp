@@ -5,10 +5,115 @@
 #include "libs/quickmath.hpp"
 
 #include "globals.hpp"
+#include "config.hpp"
+#include "blackbody.hpp"
 
 //----------------------------------------------------------------------------//
 
-#define FRAMES_IN_FLIGHT 2
+#define DRAW_PARTICLE_SET_COUNT 2
+#define DRAW_MAX_GALAXIES 256 //galaxies are written with vkCmdUpdateBuffer, which is limited to 65536 bytes
+#define DRAW_TIMESTAMP_COUNT 8 //per frame in flight, see _draw_read_timestamps
+#define DRAW_STATS_QUERY_COUNT 2 //per frame in flight, see _draw_read_stats
+
+//particle types, mirrored by the shaders:
+#define DRAW_PARTICLE_STAR 0
+#define DRAW_PARTICLE_DUST 1
+#define DRAW_PARTICLE_H2 2
+#define DRAW_PARTICLE_TYPE_COUNT 3
+
+#define DRAW_PARTICLE_H2_INTERVAL 150 //every 150th star of a galaxy is drawn as a hydrogen cloud
+
+//parameters for generating 1 galaxy, mirrors GenParams in particle_generate.comp
+struct ParticleGenParamsGPU
+{
+	uint32 numStars;
+
+	f32 maxRad;
+	f32 bulgeRad;
+
+	f32 angleOffset;
+	f32 eccentricity;
+
+	f32 baseHeight;
+	f32 height;
+
+	f32 minTemp;
+	f32 maxTemp;
+	f32 dustBaseTemp;
+
+	f32 minStarOpacity;
+	f32 maxStarOpacity;
+
+	f32 minDustOpacity;
+	f32 maxDustOpacity;
+
+	f32 speed;
+
+	uint32 seed;
+};
+
+//1 galaxy of the cluster, mirrors Galaxy in particle_generate.comp and particle.vert (std430)
+struct DrawGalaxyGPU
+{
+	qm::mat4 model;
+
+	uint32 firstParticle; //galaxies own consecutive, non-empty ranges of the particles, in order
+	uint32 numParticles;
+	f32 timeOffset; //rotation phase, so identical galaxies do not spin in lockstep
+	uint32 pad;
+
+	ParticleGenParamsGPU genParams;
+};
+
+//a range of particles stored in its own buffer, keeps every buffer below maxStorageBufferRange
+struct DrawParticleChunk
+{
+	uint32 first;
+	uint32 count;
+
+	VkBuffer buffer;
+	VKHallocation allocation;
+};
+
+//a full copy of the particles, the back set is generated by draw_regenerate while the front set is drawn
+struct DrawParticleSet
+{
+	bool created;
+
+	uint32 chunkCount;
+	DrawParticleChunk* chunks;
+
+	VKHdescriptorSets* transformDescriptorSets; //1 per chunk, for the transform pass
+	VKHdescriptorSets* genDescriptorSets;       //1 per chunk, for generation
+	VKHdescriptorSets* sortDescriptorSets;      //1 per chunk, for sorting, NULL if sorting is disabled
+
+	DrawGalaxyGPU* galaxies; //host copy of galaxyBuffer
+	VkBuffer galaxyBuffer; //read by generation and drawing to find each particle's galaxy
+	VKHallocation galaxyMemory;
+
+	uint32 genChunksDone; //dispatches recorded so far, only the particles they cover are drawn
+};
+
+//GPU time of the last frame that finished, in milliseconds. all 0 if timestamps are unsupported
+struct DrawTimings
+{
+	f64 frame;
+	f64 transform;
+	f64 particles;
+	f64 dust; //the reduced resolution dust pass or the resolve of the dust volume, 0 if the dust is drawn with the other particles
+};
+
+//pipeline statistics of the grid and particle draws of the last frame that finished. all 0 if pipeline statistics are
+//unsupported
+struct DrawStats
+{
+	uint64 gridVertices;
+	uint64 gridFragments;
+
+	uint64 particleVertices; //vertex shader invocations, 0 when drawing with mesh shaders
+	uint64 particlePrimitives; //primitives that reached the clipper
+	uint64 particleFragments; //fragment shader invocations, discarded ones included. divided by the pixels, the overdraw
+};
 
 struct DrawState
 {
@@ -18,42 +123,200 @@ struct DrawState
 	VkFormat depthFormat;
 	VkImage finalDepthImage;
 	VkImageView finalDepthView;
-	VkDeviceMemory finalDepthMemory;
+	VKHallocation finalDepthMemory;
 
 	VkRenderPass finalRenderPass;
 
+	//reduced resolution dust objects, with a dust scale above 1 (or compute dust) the dust is drawn into its own target
+	//before the final render pass, which is then upsampled and added to the frame:
+	uint32 dustScale;
+	bool dustTarget; //false if the dust is drawn with the other particles, none of the objects below exist then
+	VkExtent2D dustExtent;
+	VkImage dustImage;
+	VkImageView dustView;
+	VKHallocation dustMemory;
+	VkRenderPass dustRenderPass;
+	VkFramebuffer dustFramebuffer;
+	VkSampler dustSampler;
+	VKHgraphicsPipeline* dustCompositePipeline;
+	VKHdescriptorSets* dustCompositeDescriptorSets; //1, recreated with the target
+
+	//compute dust objects, the dust target is filled by a compute pipeline instead of the dust render pass. the visible
+	//dust is projected into splats, which are binned into screen tiles, then each tile adds up its splats' falloff:
+	bool dustCompute;
+	VKHcomputePipeline* dustSplatPipeline;
+	uint32 dustMaxSplats;
+	VkBuffer dustSplatBuffer; //headed by the indirect dispatch of the scatter pass
+	VKHallocation dustSplatMemory;
+	VkBuffer dustTileSplatBuffer; //the splat lists of every tile, one after another
+	VKHallocation dustTileSplatMemory;
+
+	uint32 dustTilesX; //the objects below are recreated with the target
+	uint32 dustTilesY;
+	VkBuffer dustTileBuffer; //splats per tile, scanned into the offsets of the tiles' lists
+	VKHallocation dustTileMemory;
+	VKHscan* dustTileScan;
+	VKHdescriptorSets* dustSplatDescriptorSets; //1 per render chunk
+
+	//dust volume objects, the transform pass splats the dust into a grid of voxels around the galaxies instead of
+	//appending it to the draw, which is resolved into a 3D texture and raymarched by a fullscreen draw. the grid is only
+	//rebuilt when the particles change or have moved far enough, so its cost depends on its resolution, not the dust:
+	uint32 dustVolume; //voxels per side of the texture, 0 if the dust is drawn as billboards
+	VkBuffer dustVolumeBuffer; //the splatted light, 3 fixed point channels per voxel. a single voxel if the volume is disabled
+	VKHallocation dustVolumeMemory;
+	VkImage dustVolumeImage;
+	VkImageView dustVolumeView;
+	VKHallocation dustVolumeImageMemory;
+	VkSampler dustVolumeSampler;
+	VKHcomputePipeline* dustVolumeResolvePipeline;
+	VKHdescriptorSets* dustVolumeResolveDescriptorSets; //1
+	VKHgraphicsPipeline* dustVolumePipeline;
+	VKHdescriptorSets* dustVolumeDescriptorSets; //1, for the raymarch
+
+	qm::vec4 dustVolumeOrigin; //the grid's min corner and the size of its voxels, from the last build
+	uint32 dustVolumeSize[3]; //voxels per axis of the grid, at most dustVolume
+	bool dustVolumeBuilt; //false until the first build, the texture is undefined until then
+	bool dustVolumeBuild; //the volume is rebuilt this frame
+	f64 dustVolumeTime; //particle time of the last build
+	f64 dustVolumeInterval; //seconds until the next build, see _draw_dust_volume_bounds
+
+	//overdraw view objects, the particles are drawn into their own target before the final render pass, each fragment
+	//adding 1, and the counts are shown as a heatmap in their place:
+	bool overdraw; //none of the objects below exist if false
+	VkImage overdrawImage;
+	VkImageView overdrawView;
+	VKHallocation overdrawMemory;
+	VkRenderPass overdrawRenderPass;
+	VkFramebuffer overdrawFramebuffer;
+	VkSampler overdrawSampler;
+	VKHgraphicsPipeline* overdrawPipeline; //the heatmap
+	VKHdescriptorSets* overdrawDescriptorSets; //1, recreated with the target
+
 	uint32 framebufferCount;
 	VkFramebuffer* framebuffers;
 
+	//on resize, the objects sized after the swapchain are retired into the queue instead of destroyed, the frames in
+	//flight may still use them. see _draw_update_swapchain:
+	VKHdeletionQueue* deletionQueue;
+	VkExtent2D windowExtent; //the framebuffer size the swapchain was last created for
+	bool swapchainOutdated; //reported when acquiring or presenting, recreated at the start of the next frame
+
+	//per frame objects, 1 of each per frame in flight:
+	uint32 presentMode; //CONFIG_PRESENT_*, the one in use
+	uint32 framesInFlight;
+	uint32 frameIdx; //the frame being recorded
+
 	VkCommandPool commandPool;
-	VkCommandBuffer commandBuffers[FRAMES_IN_FLIGHT];
+	VkCommandBuffer* commandBuffers;
 
-	VkSemaphore imageAvailableSemaphores[FRAMES_IN_FLIGHT];
-	VkSemaphore renderFinishedSemaphores[FRAMES_IN_FLIGHT];
-	VkFence inFlightFences[FRAMES_IN_FLIGHT];
+	VkSemaphore* imageAvailableSemaphores;
+	VkSemaphore* renderFinishedSemaphores;
+	VkFence* inFlightFences;
 
-	VkBuffer cameraBuffers[FRAMES_IN_FLIGHT];
-	VkDeviceMemory cameraBuffersMemory[FRAMES_IN_FLIGHT];
-	VkBuffer cameraStagingBuffer;
-	VkDeviceMemory cameraStagingBufferMemory;
+	VKHuniformRing* uniformRing;
+	VKHuploadContext* uploadContext;
+
+	VkQueryPool timestampQueryPool; //VK_NULL_HANDLE if timestamps are unsupported
+	bool* timestampsWritten; //per frame in flight
+	DrawTimings timings;
+
+	VkQueryPool statsQueryPool; //DRAW_STATS_QUERY_COUNT pipeline statistics queries per frame in flight, VK_NULL_HANDLE if unsupported
+	bool* statsWritten; //per frame in flight
+	DrawStats stats;
 
 	//quad vertex buffers:
 	VkBuffer quadVertexBuffer;
-	VkDeviceMemory quadVertexBufferMemory;
+	VKHallocation quadVertexBufferMemory;
 	VkBuffer quadIndexBuffer;
-	VkDeviceMemory quadIndexBufferMemory;
+	VKHallocation quadIndexBufferMemory;
 
 	//grid pipeline objects:
 	VKHgraphicsPipeline* gridPipeline;
 	VKHdescriptorSets* gridDescriptorSets;
 
-	//particle pipeline objects:
-	VKHgraphicsPipeline* particlePipeline;
-	VKHdescriptorSets* particleDescriptorSets;
+	//particle pipeline objects, each type is drawn with a pipeline specialized for it:
+	VKHgraphicsPipeline* particlePipelines[DRAW_PARTICLE_TYPE_COUNT];
+	uint32 primitiveMode; //CONFIG_PRIMITIVE_*, quads if the configured mode is unsupported
+	VkPipelineStageFlags particleDrawStage; //the stage reading the render buffers, vertex or mesh shader
+
+	uint32 numParticles;
+	uint32 numStars;
+	uint32 seed;
+	uint32 numGalaxies;
+
+	DrawParticleSet particleSets[DRAW_PARTICLE_SET_COUNT];
+	uint32 frontParticleSet;
 
-	VkDeviceSize particleBufferSize;
-	VkBuffer particleBuffer;
-	VkDeviceMemory particleBufferMemory;
+	//particle transform objects, the front set is transformed into the render buffers once per frame, the vertex
+	//shader only expands them into billboards:
+	VKHcomputePipeline* particleTransformPipeline;
+
+	uint32 particleRenderChunkCount; //same ranges as the chunks of the particle sets
+	VkBuffer* particleRenderBuffers; //only the visible particles, stars compacted to the front and dust to the back
+	VKHallocation* particleRenderMemory;
+	VKHdescriptorSets* particleDescriptorSets; //1 per chunk, for drawing
+
+	VkBuffer particleH2Buffer; //the visible H2 regions of every chunk, in their own range so they are drawn together
+	VKHallocation particleH2Memory;
+	VKHdescriptorSets* particleH2DescriptorSets; //1, for drawing
+
+	VkBuffer particleDrawBuffer; //indirect commands of the primitive mode, see DRAW_COMMAND_*. the counts are written by the transform pass
+	VKHallocation particleDrawMemory;
+
+	//the rotation angle of every particle of the front set, wrapped to [0, 2pi) and advanced by the transform pass each
+	//frame, so positions stay precise however long the program runs:
+	VkBuffer* particlePhaseBuffers; //1 per chunk
+	VKHallocation* particlePhaseMemory;
+	uint32 particlePhaseChunks; //generation chunks of the front set whose phases are initialized, reset when the sets swap
+	f64 particleTime; //host clock the phases were last advanced to, in seconds
+
+	//star splatting objects, the transform pass adds the light of the smallest stars to an accumulation buffer instead
+	//of appending them to the draw, which a fullscreen draw then adds to the frame:
+	bool starSplat;
+	uint32 splatCapacity; //pixels of the accumulation buffer, nothing is splatted while the swapchain is larger
+	VkBuffer splatBuffer;
+	VKHallocation splatMemory;
+	VKHgraphicsPipeline* splatPipeline;
+	VKHdescriptorSets* splatDescriptorSets; //1, for the fullscreen draw
+
+	//the colors of the particles' temperatures, looked up by the transform pass:
+	BlackbodyTable* blackbodyTable; //host copy of blackbodyBuffer
+	VkBuffer blackbodyBuffer;
+	VKHallocation blackbodyMemory;
+
+	//particle LOD objects, the transform pass aggregates small stars into the nodes of a view space octree (stored in a
+	//hash table, as it is rebuilt every frame), which are then turned into impostors and drawn after the particles:
+	bool lod;
+	VKHcomputePipeline* lodPipeline;
+	VKHdescriptorSets* lodDescriptorSets; //1, for turning nodes into impostors
+	VKHdescriptorSets* lodImpostorDescriptorSets; //1, for drawing
+
+	VkBuffer lodNodeBuffer;
+	VKHallocation lodNodeMemory;
+	VkBuffer lodImpostorBuffer;
+	VKHallocation lodImpostorMemory;
+
+	//particle generation objects:
+	VKHcomputePipeline* particleGenPipeline;
+	uint32 particleGenChunkCount; //dispatches needed to generate every particle
+	uint64 particleGenShaderHash;
+
+	bool particleCache; //load and save generated particles in SNAPSHOT_DIR
+
+	//particle sorting objects, every chunk is reordered along a Morton curve of the particles' positions once it is
+	//generated, so neighbouring invocations and vertices work on neighbouring particles:
+	bool mortonSort;
+	VKHcomputePipeline* particleSortPipeline; //computes the keys, then moves the particles into the sorted order
+	VKHradixSort* particleSort; //sized for the largest chunk
+
+	bool regenPending; //set by draw_regenerate, picked up by the next frame
+	DrawGalaxyGPU* regenGalaxies;
+
+	//generation is spread over frames within a GPU time budget (progressive startup and regeneration):
+	bool progressiveGen;
+	f64 particleGenChunkCost; //measured GPU milliseconds per dispatch, 0 until the first measurement
+	VkQueryPool particleGenQueryPool; //2 timestamps per frame in flight, VK_NULL_HANDLE if timestamps are unsupported
+	uint32* particleGenQueryChunks; //dispatches timed by each frame in flight's queries
 };
 
 //----------------------------------------------------------------------------//
@@ -64,9 +327,11 @@ struct Vertex
 	qm::vec2 texCoord;
 };
 
+//mirrors Particle in particle_generate.comp and particle_transform.comp (std140)
 struct GalaxyParticle
 {
-	qm::vec2 pos;
+	f32 rad; //the orbit is an ellipse with radii rad and rad * eccentricity of the galaxy
+	uint32 type; //DRAW_PARTICLE_STAR, DRAW_PARTICLE_DUST or DRAW_PARTICLE_H2, stored so it survives reordering
 	f32 height;
 	f32 angle;
 	f32 tiltAngle;
@@ -93,9 +358,19 @@ struct DrawParams
 
 //----------------------------------------------------------------------------//
 
-bool draw_init(DrawState** state);
+bool draw_init(DrawState** state, const Config* config);
 void draw_quit(DrawState* state);
 
 void draw_render(DrawState* state, DrawParams* params, f32 dt);
 
+ParticleGenParamsGPU draw_default_gen_params(uint32 numStars, uint32 seed);
+
+//the parameters of a galaxy, including changes from draw_regenerate that have not been swapped in yet
+ParticleGenParamsGPU draw_get_gen_params(DrawState* state, uint32 galaxy);
+
+//regenerates the particles into the back particle set over the next frames and swaps it in once complete, the current
+//galaxies stay visible until then. calls before that are merged into the same regeneration. returns false if the back
+//set could not be created or the parameters are invalid
+bool draw_regenerate(DrawState* state, uint32 galaxy, const ParticleGenParamsGPU& params);
+
 #endif
\ No newline at end of file
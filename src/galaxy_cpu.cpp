@@ -0,0 +1,583 @@
+#include "galaxy_cpu.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if GALAXY_CPU_USE_AVX2
+	#include <immintrin.h>
+#elif GALAXY_CPU_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+//NOTE: this file must be compiled without floating point contraction (-ffp-contract=off), otherwise the compiler may fuse
+//the reference path's multiply-adds and it would no longer match the vectorized path bit for bit
+
+//----------------------------------------------------------------------------//
+
+#define GALAXY_CPU_PI 3.1415926535897932384626433832795028841971693993751058209749445923078164062f
+
+#define GALAXY_CPU_RANDOM_STREAM_GENERATE 0u
+#define GALAXY_CPU_MAX_RANDS 6 //most random numbers a single particle uses (stars in the bulge)
+
+#define GALAXY_CPU_BENCHMARK_RUNS 3
+
+//----------------------------------------------------------------------------//
+
+struct GalaxyCpuRng
+{
+	uint32 key;
+	uint32 counter;
+};
+
+//values that are the same for every particle, hashed once per call instead of once per particle:
+struct GalaxyCpuConsts
+{
+	uint32 hashedStream;
+	uint32 hashedCounters[GALAXY_CPU_MAX_RANDS];
+};
+
+//----------------------------------------------------------------------------//
+
+static uint32 _galaxy_cpu_pcg_hash(uint32 x);
+static GalaxyCpuRng _galaxy_cpu_rand_init(uint32 seed, uint32 index, uint32 stream);
+static f32 _galaxy_cpu_rand(GalaxyCpuRng* rng);
+
+static f32 _galaxy_cpu_ease_in_exp(f32 x);
+static f32 _galaxy_cpu_ease_in_circ(f32 x);
+
+static uint32 _galaxy_cpu_particle_type(const ParticleGenParamsGPU* params, uint32 idx);
+static void _galaxy_cpu_generate_particle(const ParticleGenParamsGPU* params, uint32 idx, GalaxyParticle* out);
+static void _galaxy_cpu_generate_range(const ParticleGenParamsGPU* params, const GalaxyCpuConsts* consts, uint32 baseIdx, uint32 count, GalaxyParticle* out);
+
+static f64 _galaxy_cpu_time();
+
+//----------------------------------------------------------------------------//
+
+void galaxy_cpu_generate(const ParticleGenParamsGPU* params, uint32 baseIdx, uint32 count, GalaxyParticle* out, uint32 numThreads)
+{
+	GalaxyCpuConsts consts;
+	consts.hashedStream = _galaxy_cpu_pcg_hash(GALAXY_CPU_RANDOM_STREAM_GENERATE);
+	for(uint32 i = 0; i < GALAXY_CPU_MAX_RANDS; i++)
+		consts.hashedCounters[i] = _galaxy_cpu_pcg_hash(i);
+
+	if(numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if(numThreads == 0)
+		numThreads = 1;
+
+	//split into ranges that are a multiple of the vector width so only the last thread has a scalar tail:
+	const uint32 lanes = 8;
+	uint32 perThread = (count / numThreads + lanes - 1) / lanes * lanes;
+	if(perThread == 0)
+		perThread = lanes;
+
+	std::vector<std::thread> threads;
+	for(uint32 first = perThread; first < count; first += perThread)
+	{
+		uint32 rangeCount = count - first < perThread ? count - first : perThread;
+		threads.emplace_back(_galaxy_cpu_generate_range, params, &consts, baseIdx + first, rangeCount, out + first);
+	}
+
+	//the calling thread takes the first range:
+	_galaxy_cpu_generate_range(params, &consts, baseIdx, count < perThread ? count : perThread, out);
+
+	for(uint32 i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+void galaxy_cpu_generate_reference(const ParticleGenParamsGPU* params, uint32 baseIdx, uint32 count, GalaxyParticle* out)
+{
+	for(uint32 i = 0; i < count; i++)
+		_galaxy_cpu_generate_particle(params, baseIdx + i, &out[i]);
+}
+
+uint32 galaxy_cpu_max_ulp_diff(const GalaxyParticle* a, const GalaxyParticle* b, uint32 count)
+{
+	const uint32 numFields = sizeof(GalaxyParticle) / sizeof(f32);
+	const f32* fieldsA = (const f32*)a;
+	const f32* fieldsB = (const f32*)b;
+
+	uint64 maxDiff = 0;
+	for(uint64 i = 0; i < (uint64)count * numFields; i++)
+	{
+		//map the floats onto integers that are ordered the same way, so the difference counts representable values:
+		int32 bitsA, bitsB;
+		memcpy(&bitsA, &fieldsA[i], sizeof(f32));
+		memcpy(&bitsB, &fieldsB[i], sizeof(f32));
+
+		int64 orderedA = bitsA < 0 ? (int64)INT32_MIN - bitsA : bitsA;
+		int64 orderedB = bitsB < 0 ? (int64)INT32_MIN - bitsB : bitsB;
+
+		uint64 diff = orderedA > orderedB ? orderedA - orderedB : orderedB - orderedA;
+		if(diff > maxDiff)
+			maxDiff = diff;
+	}
+
+	return maxDiff > UINT32_MAX ? UINT32_MAX : (uint32)maxDiff;
+}
+
+bool galaxy_cpu_benchmark(const ParticleGenParamsGPU* params, uint32 count)
+{
+	GalaxyParticle* particles = (GalaxyParticle*)malloc((uint64)count * sizeof(GalaxyParticle));
+	GalaxyParticle* reference = (GalaxyParticle*)malloc((uint64)count * sizeof(GalaxyParticle));
+	if(!particles || !reference)
+	{
+		printf("GALAXY CPU ERROR - \"failed to allocate %u particles\"\n", count);
+		free(particles);
+		free(reference);
+		return false;
+	}
+
+#if GALAXY_CPU_USE_AVX2
+	const char* path = "AVX2";
+#elif GALAXY_CPU_USE_SSE2
+	const char* path = "SSE2";
+#else
+	const char* path = "scalar";
+#endif
+
+	//validate:
+	//---------------
+	f64 referenceStart = _galaxy_cpu_time();
+	galaxy_cpu_generate_reference(params, 0, count, reference);
+	f64 referenceTime = _galaxy_cpu_time() - referenceStart;
+
+	galaxy_cpu_generate(params, 0, count, particles, 0);
+	uint32 ulpDiff = galaxy_cpu_max_ulp_diff(particles, reference, count);
+
+	printf("generating %u particles (%u stars) on the CPU, %s path\n", count, params->numStars, path);
+	printf("reference: %.1f Mparticles/s\n", count / referenceTime * 1e-6);
+	printf("max difference to reference: %u ULP\n", ulpDiff);
+
+	//measure:
+	//---------------
+	uint32 maxThreads = std::thread::hardware_concurrency();
+	if(maxThreads == 0)
+		maxThreads = 1;
+
+	printf("%8s %20s %20s\n", "threads", "Mparticles/s", "Mparticles/s/thread");
+	for(uint32 numThreads = 1;; numThreads *= 2)
+	{
+		if(numThreads > maxThreads)
+			numThreads = maxThreads;
+
+		f64 bestTime = INFINITY;
+		for(uint32 i = 0; i < GALAXY_CPU_BENCHMARK_RUNS; i++)
+		{
+			f64 start = _galaxy_cpu_time();
+			galaxy_cpu_generate(params, 0, count, particles, numThreads);
+			f64 time = _galaxy_cpu_time() - start;
+
+			if(time < bestTime)
+				bestTime = time;
+		}
+
+		f64 rate = count / bestTime * 1e-6;
+		printf("%8u %20.1f %20.1f\n", numThreads, rate, rate / numThreads);
+
+		if(numThreads == maxThreads)
+			break;
+	}
+
+	free(particles);
+	free(reference);
+
+	return ulpDiff == 0;
+}
+
+//----------------------------------------------------------------------------//
+//REFERENCE:
+//----------------------------------------------------------------------------//
+
+static uint32 _galaxy_cpu_pcg_hash(uint32 x)
+{
+	uint32 state = x * 747796405u + 2891336453u;
+	uint32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static GalaxyCpuRng _galaxy_cpu_rand_init(uint32 seed, uint32 index, uint32 stream)
+{
+	GalaxyCpuRng rng;
+	rng.key = _galaxy_cpu_pcg_hash(seed ^ _galaxy_cpu_pcg_hash(index ^ _galaxy_cpu_pcg_hash(stream)));
+	rng.counter = 0;
+
+	return rng;
+}
+
+static f32 _galaxy_cpu_rand(GalaxyCpuRng* rng)
+{
+	uint32 bits = _galaxy_cpu_pcg_hash(rng->key ^ _galaxy_cpu_pcg_hash(rng->counter++));
+	return (f32)(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+static f32 _galaxy_cpu_ease_in_exp(f32 x)
+{
+	return x <= 0.0f ? 0.0f : exp2f(10.0f * x - 10.0f);
+}
+
+static f32 _galaxy_cpu_ease_in_circ(f32 x)
+{
+	return x >= 1.0f ? 1.0f : 1.0f - sqrtf(1.0f - x * x);
+}
+
+static uint32 _galaxy_cpu_particle_type(const ParticleGenParamsGPU* p, uint32 idx)
+{
+	if(idx < p->numStars)
+		return idx % 150 == 0 ? DRAW_PARTICLE_H2 : DRAW_PARTICLE_STAR;
+	else
+		return DRAW_PARTICLE_DUST;
+}
+
+static void _galaxy_cpu_generate_particle(const ParticleGenParamsGPU* p, uint32 idx, GalaxyParticle* out)
+{
+	GalaxyCpuRng rng = _galaxy_cpu_rand_init(p->seed, idx, GALAXY_CPU_RANDOM_STREAM_GENERATE);
+
+	GalaxyParticle particle;
+	if(idx < p->numStars) //star
+	{
+		f32 rad = _galaxy_cpu_ease_in_exp(_galaxy_cpu_rand(&rng)) * p->maxRad;
+
+		particle.rad = rad;
+		particle.type = _galaxy_cpu_particle_type(p, idx);
+		particle.angle = _galaxy_cpu_rand(&rng) * 2.0f * GALAXY_CPU_PI;
+		particle.tiltAngle = (rad / p->maxRad) * p->angleOffset;
+		particle.angleVel = -p->speed * sqrtf(1.0f / rad);
+		particle.temp = p->minTemp + (p->maxTemp - p->minTemp) * _galaxy_cpu_rand(&rng);
+		particle.opacity = p->minStarOpacity + (p->maxStarOpacity - p->minStarOpacity) * _galaxy_cpu_rand(&rng);
+
+		f32 r = _galaxy_cpu_ease_in_circ(_galaxy_cpu_rand(&rng));
+		if(_galaxy_cpu_rand(&rng) < 0.5f)
+			r *= -1;
+
+		if(rad < p->bulgeRad)
+		{
+			f32 bound = (p->height * 0.5f) + (p->height * 0.5f) * cosf(GALAXY_CPU_PI * rad / p->bulgeRad);
+			particle.height = p->baseHeight + bound * r;
+		}
+		else
+			particle.height = p->baseHeight + (p->height * 0.5f) * r;
+	}
+	else //dust
+	{
+		f32 rad;
+		if(idx % 2 == 0)
+			rad = _galaxy_cpu_rand(&rng) * p->maxRad;
+		else
+			rad = _galaxy_cpu_ease_in_exp(_galaxy_cpu_rand(&rng)) * p->maxRad;
+
+		particle.rad = rad;
+		particle.type = _galaxy_cpu_particle_type(p, idx);
+		particle.angle = _galaxy_cpu_rand(&rng) * 2.0f * GALAXY_CPU_PI;
+		particle.tiltAngle = (rad / p->maxRad) * p->angleOffset;
+		particle.angleVel = -p->speed * sqrtf(1.0f / rad);
+		particle.temp = p->dustBaseTemp + 2.0f * rad;
+		particle.opacity = p->minDustOpacity + (p->maxDustOpacity - p->minDustOpacity) * _galaxy_cpu_rand(&rng);
+
+		if(rad < p->bulgeRad)
+		{
+			f32 r = _galaxy_cpu_ease_in_circ(_galaxy_cpu_rand(&rng));
+			if(_galaxy_cpu_rand(&rng) < 0.5f)
+				r *= -1;
+
+			f32 bound = (p->height * 0.5f) * cosf(GALAXY_CPU_PI * rad / p->bulgeRad);
+			particle.height = p->baseHeight + bound * r;
+		}
+		else
+			particle.height = p->baseHeight;
+	}
+
+	*out = particle;
+}
+
+//----------------------------------------------------------------------------//
+//VECTORIZED:
+//----------------------------------------------------------------------------//
+
+//thin wrappers so the kernel below is written once for both instruction sets, every operation is the exact IEEE
+//equivalent of the scalar one (sqrt and div are correctly rounded on both), so the results are bit-identical
+
+#if GALAXY_CPU_USE_AVX2
+
+#define GALAXY_CPU_LANES 8
+
+typedef __m256i GalaxyCpuVecU;
+typedef __m256 GalaxyCpuVecF;
+
+static inline GalaxyCpuVecU _gcv_set_u(uint32 x) { return _mm256_set1_epi32((int32)x); }
+static inline GalaxyCpuVecU _gcv_lane_idx(uint32 base) { return _mm256_add_epi32(_mm256_set1_epi32((int32)base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)); }
+static inline GalaxyCpuVecU _gcv_xor_u(GalaxyCpuVecU a, GalaxyCpuVecU b) { return _mm256_xor_si256(a, b); }
+
+static inline GalaxyCpuVecU _gcv_pcg_hash(GalaxyCpuVecU x)
+{
+	__m256i state = _mm256_add_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(747796405)), _mm256_set1_epi32((int32)2891336453u));
+	__m256i shift = _mm256_add_epi32(_mm256_srli_epi32(state, 28), _mm256_set1_epi32(4));
+	__m256i word = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srlv_epi32(state, shift), state), _mm256_set1_epi32(277803737));
+	return _mm256_xor_si256(_mm256_srli_epi32(word, 22), word);
+}
+
+static inline GalaxyCpuVecF _gcv_unorm(GalaxyCpuVecU bits) { return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(bits, 8)), _mm256_set1_ps(1.0f / 16777216.0f)); }
+
+//all bits set in lanes where a < b, as unsigned integers:
+static inline GalaxyCpuVecF _gcv_less_u(GalaxyCpuVecU a, GalaxyCpuVecU b)
+{
+	__m256i flip = _mm256_set1_epi32(INT32_MIN);
+	return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_xor_si256(b, flip), _mm256_xor_si256(a, flip)));
+}
+
+static inline GalaxyCpuVecF _gcv_even_u(GalaxyCpuVecU a) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(a, _mm256_set1_epi32(1)), _mm256_setzero_si256())); }
+
+static inline GalaxyCpuVecF _gcv_set(f32 x) { return _mm256_set1_ps(x); }
+static inline GalaxyCpuVecF _gcv_add(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_add_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_sub(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_sub_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_mul(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_mul_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_div(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_div_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_sqrt(GalaxyCpuVecF a) { return _mm256_sqrt_ps(a); }
+static inline GalaxyCpuVecF _gcv_xor(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_xor_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_and(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_and_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_or(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_or_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_less(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline GalaxyCpuVecF _gcv_less_equal(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline GalaxyCpuVecF _gcv_select(GalaxyCpuVecF mask, GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm256_blendv_ps(b, a, mask); }
+static inline int32 _gcv_mask_bits(GalaxyCpuVecF mask) { return _mm256_movemask_ps(mask); }
+static inline GalaxyCpuVecF _gcv_load(const f32* src) { return _mm256_loadu_ps(src); }
+static inline void _gcv_store(f32* dst, GalaxyCpuVecF a) { _mm256_storeu_ps(dst, a); }
+
+//transposes the 8 field vectors into 8 consecutive GalaxyParticles:
+static inline void _gcv_store_particles(GalaxyParticle* out, const GalaxyCpuVecF* fields)
+{
+	__m256 t0 = _mm256_unpacklo_ps(fields[0], fields[1]);
+	__m256 t1 = _mm256_unpackhi_ps(fields[0], fields[1]);
+	__m256 t2 = _mm256_unpacklo_ps(fields[2], fields[3]);
+	__m256 t3 = _mm256_unpackhi_ps(fields[2], fields[3]);
+	__m256 t4 = _mm256_unpacklo_ps(fields[4], fields[5]);
+	__m256 t5 = _mm256_unpackhi_ps(fields[4], fields[5]);
+	__m256 t6 = _mm256_unpacklo_ps(fields[6], fields[7]);
+	__m256 t7 = _mm256_unpackhi_ps(fields[6], fields[7]);
+
+	__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+	f32* dst = (f32*)out;
+	_mm256_storeu_ps(dst + 0 * 8, _mm256_permute2f128_ps(s0, s4, 0x20));
+	_mm256_storeu_ps(dst + 1 * 8, _mm256_permute2f128_ps(s1, s5, 0x20));
+	_mm256_storeu_ps(dst + 2 * 8, _mm256_permute2f128_ps(s2, s6, 0x20));
+	_mm256_storeu_ps(dst + 3 * 8, _mm256_permute2f128_ps(s3, s7, 0x20));
+	_mm256_storeu_ps(dst + 4 * 8, _mm256_permute2f128_ps(s0, s4, 0x31));
+	_mm256_storeu_ps(dst + 5 * 8, _mm256_permute2f128_ps(s1, s5, 0x31));
+	_mm256_storeu_ps(dst + 6 * 8, _mm256_permute2f128_ps(s2, s6, 0x31));
+	_mm256_storeu_ps(dst + 7 * 8, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+#elif GALAXY_CPU_USE_SSE2
+
+#define GALAXY_CPU_LANES 4
+
+typedef __m128i GalaxyCpuVecU;
+typedef __m128 GalaxyCpuVecF;
+
+static inline GalaxyCpuVecU _gcv_set_u(uint32 x) { return _mm_set1_epi32((int32)x); }
+static inline GalaxyCpuVecU _gcv_lane_idx(uint32 base) { return _mm_add_epi32(_mm_set1_epi32((int32)base), _mm_setr_epi32(0, 1, 2, 3)); }
+static inline GalaxyCpuVecU _gcv_xor_u(GalaxyCpuVecU a, GalaxyCpuVecU b) { return _mm_xor_si128(a, b); }
+
+//SSE2 has no 32-bit multiply, so it is built from the two 32x32->64 multiplies of the even and odd lanes:
+static inline __m128i _gcv_mullo_u(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i _gcv_mulhi_u(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 3, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 3, 3, 1)));
+}
+
+static inline GalaxyCpuVecU _gcv_pcg_hash(GalaxyCpuVecU x)
+{
+	__m128i state = _mm_add_epi32(_gcv_mullo_u(x, _mm_set1_epi32(747796405)), _mm_set1_epi32((int32)2891336453u));
+
+	//SSE2 also has no per-lane shift, state >> s for s in [4, 19] is the high half of state * 2^(32 - s),
+	//the power of 2 is built directly in the exponent of a float:
+	__m128i shift = _mm_add_epi32(_mm_srli_epi32(state, 28), _mm_set1_epi32(4));
+	__m128i exponent = _mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127 + 32), shift), 23);
+	__m128i multiplier = _mm_cvttps_epi32(_mm_castsi128_ps(exponent));
+
+	__m128i word = _gcv_mullo_u(_mm_xor_si128(_gcv_mulhi_u(state, multiplier), state), _mm_set1_epi32(277803737));
+	return _mm_xor_si128(_mm_srli_epi32(word, 22), word);
+}
+
+static inline GalaxyCpuVecF _gcv_unorm(GalaxyCpuVecU bits) { return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), _mm_set1_ps(1.0f / 16777216.0f)); }
+
+//all bits set in lanes where a < b, as unsigned integers:
+static inline GalaxyCpuVecF _gcv_less_u(GalaxyCpuVecU a, GalaxyCpuVecU b)
+{
+	__m128i flip = _mm_set1_epi32(INT32_MIN);
+	return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_xor_si128(b, flip), _mm_xor_si128(a, flip)));
+}
+
+static inline GalaxyCpuVecF _gcv_even_u(GalaxyCpuVecU a) { return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(a, _mm_set1_epi32(1)), _mm_setzero_si128())); }
+
+static inline GalaxyCpuVecF _gcv_set(f32 x) { return _mm_set1_ps(x); }
+static inline GalaxyCpuVecF _gcv_add(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_add_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_sub(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_sub_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_mul(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_mul_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_div(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_div_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_sqrt(GalaxyCpuVecF a) { return _mm_sqrt_ps(a); }
+static inline GalaxyCpuVecF _gcv_xor(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_xor_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_and(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_and_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_or(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_or_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_less(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_cmplt_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_less_equal(GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_cmple_ps(a, b); }
+static inline GalaxyCpuVecF _gcv_select(GalaxyCpuVecF mask, GalaxyCpuVecF a, GalaxyCpuVecF b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline int32 _gcv_mask_bits(GalaxyCpuVecF mask) { return _mm_movemask_ps(mask); }
+static inline GalaxyCpuVecF _gcv_load(const f32* src) { return _mm_loadu_ps(src); }
+static inline void _gcv_store(f32* dst, GalaxyCpuVecF a) { _mm_storeu_ps(dst, a); }
+
+//transposes the 8 field vectors into 4 consecutive GalaxyParticles, as two 4x4 transposes:
+static inline void _gcv_store_particles(GalaxyParticle* out, const GalaxyCpuVecF* fields)
+{
+	__m128 lo0 = fields[0], lo1 = fields[1], lo2 = fields[2], lo3 = fields[3];
+	__m128 hi0 = fields[4], hi1 = fields[5], hi2 = fields[6], hi3 = fields[7];
+	_MM_TRANSPOSE4_PS(lo0, lo1, lo2, lo3);
+	_MM_TRANSPOSE4_PS(hi0, hi1, hi2, hi3);
+
+	f32* dst = (f32*)out;
+	_mm_storeu_ps(dst + 0,  lo0); _mm_storeu_ps(dst + 4,  hi0);
+	_mm_storeu_ps(dst + 8,  lo1); _mm_storeu_ps(dst + 12, hi1);
+	_mm_storeu_ps(dst + 16, lo2); _mm_storeu_ps(dst + 20, hi2);
+	_mm_storeu_ps(dst + 24, lo3); _mm_storeu_ps(dst + 28, hi3);
+}
+
+#endif
+
+#if GALAXY_CPU_USE_AVX2 || GALAXY_CPU_USE_SSE2
+
+//libm has no vector exp2/cos, so those go through the scalar functions one lane at a time, which also guarantees the
+//same results as the reference:
+static inline GalaxyCpuVecF _gcv_ease_in_exp(GalaxyCpuVecF x)
+{
+	f32 lanes[GALAXY_CPU_LANES];
+	_gcv_store(lanes, _gcv_sub(_gcv_mul(_gcv_set(10.0f), x), _gcv_set(10.0f)));
+	for(uint32 i = 0; i < GALAXY_CPU_LANES; i++)
+		lanes[i] = exp2f(lanes[i]);
+
+	GalaxyCpuVecF zero = _gcv_set(0.0f);
+	return _gcv_select(_gcv_less_equal(x, zero), zero, _gcv_load(lanes));
+}
+
+//x comes from rand() so it is always < 1 and the x >= 1 branch of the reference is never taken:
+static inline GalaxyCpuVecF _gcv_ease_in_circ(GalaxyCpuVecF x)
+{
+	GalaxyCpuVecF one = _gcv_set(1.0f);
+	return _gcv_sub(one, _gcv_sqrt(_gcv_sub(one, _gcv_mul(x, x))));
+}
+
+//cos only for the lanes in mask, the rest are left at 0:
+static inline GalaxyCpuVecF _gcv_cos_masked(GalaxyCpuVecF x, GalaxyCpuVecF mask)
+{
+	int32 bits = _gcv_mask_bits(mask);
+
+	f32 lanes[GALAXY_CPU_LANES];
+	_gcv_store(lanes, x);
+	for(uint32 i = 0; i < GALAXY_CPU_LANES; i++)
+		lanes[i] = (bits & (1 << i)) ? cosf(lanes[i]) : 0.0f;
+
+	return _gcv_load(lanes);
+}
+
+//generates GALAXY_CPU_LANES consecutive particles starting at idx, every lane draws all of its random numbers up front
+//and the star and dust formulas are both evaluated and blended by mask
+static void _galaxy_cpu_generate_lanes(const ParticleGenParamsGPU* p, const GalaxyCpuConsts* consts, uint32 idx, GalaxyParticle* out)
+{
+	GalaxyCpuVecU index = _gcv_lane_idx(idx);
+	GalaxyCpuVecU key = _gcv_pcg_hash(_gcv_xor_u(_gcv_set_u(p->seed), _gcv_pcg_hash(_gcv_xor_u(index, _gcv_set_u(consts->hashedStream)))));
+
+	GalaxyCpuVecF rands[GALAXY_CPU_MAX_RANDS];
+	for(uint32 i = 0; i < GALAXY_CPU_MAX_RANDS; i++)
+		rands[i] = _gcv_unorm(_gcv_pcg_hash(_gcv_xor_u(key, _gcv_set_u(consts->hashedCounters[i]))));
+
+	GalaxyCpuVecF isStar = _gcv_less_u(index, _gcv_set_u(p->numStars));
+	GalaxyCpuVecF isEven = _gcv_even_u(index);
+
+	//radius:
+	GalaxyCpuVecF easedRand = _gcv_ease_in_exp(rands[0]);
+	GalaxyCpuVecF rad = _gcv_mul(_gcv_select(isStar, easedRand, _gcv_select(isEven, rands[0], easedRand)), _gcv_set(p->maxRad));
+
+	//fields shared by stars and dust:
+	GalaxyCpuVecF fields[8];
+	fields[0] = rad;
+
+	//the type is an integer field, built one lane at a time and stored by its bits:
+	uint32 types[GALAXY_CPU_LANES];
+	for(uint32 i = 0; i < GALAXY_CPU_LANES; i++)
+		types[i] = _galaxy_cpu_particle_type(p, idx + i);
+
+	f32 typeBits[GALAXY_CPU_LANES];
+	memcpy(typeBits, types, sizeof(types));
+	fields[1] = _gcv_load(typeBits);
+	fields[3] = _gcv_mul(_gcv_mul(rands[1], _gcv_set(2.0f)), _gcv_set(GALAXY_CPU_PI));
+	fields[4] = _gcv_mul(_gcv_div(rad, _gcv_set(p->maxRad)), _gcv_set(p->angleOffset));
+	fields[5] = _gcv_mul(_gcv_set(-p->speed), _gcv_sqrt(_gcv_div(_gcv_set(1.0f), rad)));
+
+	//temperature and opacity:
+	GalaxyCpuVecF starTemp = _gcv_add(_gcv_set(p->minTemp), _gcv_mul(_gcv_set(p->maxTemp - p->minTemp), rands[2]));
+	GalaxyCpuVecF dustTemp = _gcv_add(_gcv_set(p->dustBaseTemp), _gcv_mul(_gcv_set(2.0f), rad));
+	fields[7] = _gcv_select(isStar, starTemp, dustTemp);
+
+	GalaxyCpuVecF starOpacity = _gcv_add(_gcv_set(p->minStarOpacity), _gcv_mul(_gcv_set(p->maxStarOpacity - p->minStarOpacity), rands[3]));
+	GalaxyCpuVecF dustOpacity = _gcv_add(_gcv_set(p->minDustOpacity), _gcv_mul(_gcv_set(p->maxDustOpacity - p->minDustOpacity), rands[2]));
+	fields[6] = _gcv_select(isStar, starOpacity, dustOpacity);
+
+	//height, stars use the 5th and 6th random numbers and dust the 4th and 5th:
+	GalaxyCpuVecF inBulge = _gcv_less(rad, _gcv_set(p->bulgeRad));
+	GalaxyCpuVecF halfHeight = _gcv_set(p->height * 0.5f);
+
+	GalaxyCpuVecF r = _gcv_ease_in_circ(_gcv_select(isStar, rands[4], rands[3]));
+	GalaxyCpuVecF negate = _gcv_less(_gcv_select(isStar, rands[5], rands[4]), _gcv_set(0.5f));
+	r = _gcv_xor(r, _gcv_and(negate, _gcv_set(-0.0f)));
+
+	GalaxyCpuVecF bulgeCos = _gcv_cos_masked(_gcv_div(_gcv_mul(_gcv_set(GALAXY_CPU_PI), rad), _gcv_set(p->bulgeRad)), inBulge);
+	GalaxyCpuVecF starBound = _gcv_select(inBulge, _gcv_add(halfHeight, _gcv_mul(halfHeight, bulgeCos)), halfHeight);
+	GalaxyCpuVecF dustBound = _gcv_mul(halfHeight, bulgeCos);
+
+	GalaxyCpuVecF baseHeight = _gcv_set(p->baseHeight);
+	GalaxyCpuVecF height = _gcv_add(baseHeight, _gcv_mul(_gcv_select(isStar, starBound, dustBound), r));
+	fields[2] = _gcv_select(_gcv_or(isStar, inBulge), height, baseHeight);
+
+	_gcv_store_particles(out, fields);
+}
+
+#endif
+
+static void _galaxy_cpu_generate_range(const ParticleGenParamsGPU* params, const GalaxyCpuConsts* consts, uint32 baseIdx, uint32 count, GalaxyParticle* out)
+{
+	uint32 i = 0;
+
+#if GALAXY_CPU_USE_AVX2 || GALAXY_CPU_USE_SSE2
+	for(; i + GALAXY_CPU_LANES <= count; i += GALAXY_CPU_LANES)
+		_galaxy_cpu_generate_lanes(params, consts, baseIdx + i, &out[i]);
+#else
+	(void)consts;
+#endif
+
+	galaxy_cpu_generate_reference(params, baseIdx + i, count - i, &out[i]);
+}
+
+//----------------------------------------------------------------------------//
+
+static f64 _galaxy_cpu_time()
+{
+	return std::chrono::duration<f64>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
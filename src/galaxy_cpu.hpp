@@ -0,0 +1,48 @@
+#ifndef GALAXY_CPU_H
+#define GALAXY_CPU_H
+
+#include "draw.hpp"
+#include "globals.hpp"
+
+//----------------------------------------------------------------------------//
+
+//CPU port of particle_generate.comp, for generating galaxies without a GPU and for differential testing of the shader
+//
+//vectorized with AVX2 (8 particles at a time) when compiled with AVX2 enabled (e.g. -mavx2, /arch:AVX2), falling back
+//to SSE2 (4 at a time), or to the scalar reference on other architectures. every path produces bit-identical output
+//
+//accuracy relative to the GPU:
+// - the RNG is integer only, so every random number is bit-exact, and so is the type
+// - fields built from random numbers with only + and * (angle, star temp, opacity) are within 1 ULP, the difference
+//   comes from the GPU being allowed to fuse multiply-adds
+// - fields derived from rad (rad, tiltAngle, angleVel, dust temp) inherit the precision of GLSL pow(2, x), which is
+//   (3 + 2 * |x|) ULP for x = 10 * rand() - 10, so at most 23 ULP
+// - height additionally goes through GLSL cos(), which is only specified to an absolute error of 2^-11, so it is
+//   within height * 2^-11 absolute of the GPU value
+
+#if defined(__AVX2__)
+	#define GALAXY_CPU_USE_AVX2 1
+	#define GALAXY_CPU_USE_SSE2 0
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define GALAXY_CPU_USE_AVX2 0
+	#define GALAXY_CPU_USE_SSE2 1
+#else
+	#define GALAXY_CPU_USE_AVX2 0
+	#define GALAXY_CPU_USE_SSE2 0
+#endif
+
+//----------------------------------------------------------------------------//
+
+//generates particles [baseIdx, baseIdx + count) of the galaxy into out, numThreads = 0 uses every core
+void galaxy_cpu_generate(const ParticleGenParamsGPU* params, uint32 baseIdx, uint32 count, GalaxyParticle* out, uint32 numThreads);
+
+//single-threaded, unvectorized, line-by-line port of the shader, used to validate the fast path
+void galaxy_cpu_generate_reference(const ParticleGenParamsGPU* params, uint32 baseIdx, uint32 count, GalaxyParticle* out);
+
+//largest difference in ULP over every field of every particle
+uint32 galaxy_cpu_max_ulp_diff(const GalaxyParticle* a, const GalaxyParticle* b, uint32 count);
+
+//prints throughput in particles/second for 1 thread up to every core, returns false if the fast path disagrees with the reference
+bool galaxy_cpu_benchmark(const ParticleGenParamsGPU* params, uint32 count);
+
+#endif
@@ -8,6 +8,8 @@
 #define CAMERA_MAX_TILT 89.0f
 #define CAMERA_MAX_POSITION 7000.0f
 
+#define BENCHMARK_WARMUP_FRAMES 60 //not measured, covers startup uploads and pipeline warmup
+
 //----------------------------------------------------------------------------//
 
 bool _game_camera_init(GameCamera* cam);
@@ -21,8 +23,12 @@ void _game_cursor_pos_callback(GLFWwindow* window, f64 x, f64 y);
 void _game_key_callback(GLFWwindow* window, int32 key, int32 scancode, int32 action, int32 mods);
 void _game_scroll_callback(GLFWwindow* window, f64 x, f64 y);
 
+bool _game_edit_galaxy(ParticleGenParamsGPU* params, int32 key);
+
 //----------------------------------------------------------------------------//
 
+bool _game_benchmark_frame(GameState* s, f32 dt);
+
 template<typename T>
 void _game_decay_to(T& value, T target, f32 rate, f32 dt);
 
@@ -36,7 +42,7 @@ static void _game_error_log(const char* message, const char* file, int32 line);
 
 //----------------------------------------------------------------------------//
 
-bool game_init(GameState** state)
+bool game_init(GameState** state, const Config* config)
 {
 	*state = (GameState*)malloc(sizeof(GameState));
 	GameState* s = *state;
@@ -47,7 +53,7 @@ bool game_init(GameState** state)
 		return false;
 	}
 
-	if(!draw_init(&s->drawState))
+	if(!draw_init(&s->drawState, config))
 	{
 		ERROR_LOG("failed to intialize rendering");
 		return false;
@@ -59,6 +65,15 @@ bool game_init(GameState** state)
 		return false;
 	}
 
+	s->numGalaxies = config->numGalaxies;
+	s->selectedGalaxy = 0;
+	s->genParams = draw_get_gen_params(s->drawState, s->selectedGalaxy);
+
+	memset(&s->benchmark, 0, sizeof(GameBenchmark));
+	if(config->benchmarkFrames > 0)
+		s->benchmark.numFrames = BENCHMARK_WARMUP_FRAMES + config->benchmarkFrames;
+	s->benchmark.dist = CAMERA_MAX_DIST * config->benchmarkDist;
+
 	glfwSetWindowUserPointer(s->drawState->instance->window, s);
 	glfwSetCursorPosCallback(s->drawState->instance->window, _game_cursor_pos_callback);
 	glfwSetKeyCallback(s->drawState->instance->window, _game_key_callback);
@@ -102,6 +117,9 @@ void game_main_loop(GameState* s)
 			accumFrames = 0;
 		}
 
+		if(s->benchmark.numFrames > 0 && !_game_benchmark_frame(s, dt))
+			break;
+
 		_game_camera_update(&s->cam, dt, s->drawState->instance->window);
 
 		DrawParams drawParams;
@@ -211,6 +229,16 @@ void _game_key_callback(GLFWwindow* window, int32 key, int32 scancode, int32 act
 {
 	if(key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GLFW_TRUE);
+
+	GameState* s = (GameState*)glfwGetWindowUserPointer(window);
+	if(key == GLFW_KEY_TAB && action == GLFW_PRESS)
+	{
+		s->selectedGalaxy = (s->selectedGalaxy + 1) % s->numGalaxies;
+		s->genParams = draw_get_gen_params(s->drawState, s->selectedGalaxy);
+	}
+
+	if((action == GLFW_PRESS || action == GLFW_REPEAT) && _game_edit_galaxy(&s->genParams, key))
+		draw_regenerate(s->drawState, s->selectedGalaxy, s->genParams);
 }
 
 void _game_scroll_callback(GLFWwindow* window, f64 x, f64 y)
@@ -221,6 +249,103 @@ void _game_scroll_callback(GLFWwindow* window, f64 x, f64 y)
 		_game_camera_scroll(&s->cam, (f32)y);
 }
 
+//moves the camera along the benchmark path and accumulates the previous frame's timings, returns false once done
+bool _game_benchmark_frame(GameState* s, f32 dt)
+{
+	GameBenchmark* b = &s->benchmark;
+
+	//the GPU timings lag a few frames (the frames in flight) behind, which does not matter for averages over many frames:
+	if(b->frame > BENCHMARK_WARMUP_FRAMES)
+	{
+		b->cpuFrameTime += dt * 1000.0;
+		b->gpuTimings.frame     += s->drawState->timings.frame;
+		b->gpuTimings.transform += s->drawState->timings.transform;
+		b->gpuTimings.particles += s->drawState->timings.particles;
+		b->gpuTimings.dust      += s->drawState->timings.dust;
+		b->gridVertices         += (f64)s->drawState->stats.gridVertices;
+		b->gridFragments        += (f64)s->drawState->stats.gridFragments;
+		b->particleVertices     += (f64)s->drawState->stats.particleVertices;
+		b->particlePrimitives   += (f64)s->drawState->stats.particlePrimitives;
+		b->particleFragments    += (f64)s->drawState->stats.particleFragments;
+	}
+
+	if(b->frame == b->numFrames)
+	{
+		uint32 measured = b->numFrames - BENCHMARK_WARMUP_FRAMES;
+		f64 pixels = (f64)s->drawState->instance->swapchainExtent.width * s->drawState->instance->swapchainExtent.height;
+
+		printf("{\n");
+		printf("  \"frames\": %u,\n", measured);
+		printf("  \"particles\": %u,\n", s->drawState->numParticles);
+		printf("  \"galaxies\": %u,\n", s->drawState->numGalaxies);
+		printf("  \"primitive\": \"%s\",\n", config_primitive_mode_name(s->drawState->primitiveMode));
+		printf("  \"star_splat\": %s,\n", s->drawState->starSplat ? "true" : "false");
+		printf("  \"width\": %u,\n", s->drawState->instance->swapchainExtent.width);
+		printf("  \"height\": %u,\n", s->drawState->instance->swapchainExtent.height);
+		printf("  \"frames_in_flight\": %u,\n", s->drawState->framesInFlight);
+		printf("  \"present_mode\": \"%s\",\n", config_present_mode_name(s->drawState->presentMode));
+		printf("  \"swapchain_images\": %u,\n", s->drawState->instance->swapchainImageCount);
+		printf("  \"dust_scale\": %u,\n", s->drawState->dustScale);
+		printf("  \"dust_renderer\": \"%s\",\n", s->drawState->dustVolume != 0 ? "volume" : s->drawState->dustCompute ? "compute" : "raster");
+		printf("  \"dust_volume\": %u,\n", s->drawState->dustVolume);
+		printf("  \"camera_dist\": %.1f,\n", b->dist);
+		printf("  \"cpu_frame_ms\": %.4f,\n", b->cpuFrameTime / measured);
+		printf("  \"gpu_frame_ms\": %.4f,\n", b->gpuTimings.frame / measured);
+		printf("  \"gpu_transform_ms\": %.4f,\n", b->gpuTimings.transform / measured);
+		printf("  \"gpu_particles_ms\": %.4f,\n", b->gpuTimings.particles / measured);
+		printf("  \"gpu_dust_ms\": %.4f,\n", b->gpuTimings.dust / measured);
+		printf("  \"grid_vertex_invocations\": %.0f,\n", b->gridVertices / measured);
+		printf("  \"grid_fragment_invocations\": %.0f,\n", b->gridFragments / measured);
+		printf("  \"particle_vertex_invocations\": %.0f,\n", b->particleVertices / measured);
+		printf("  \"particle_primitives\": %.0f,\n", b->particlePrimitives / measured);
+		printf("  \"particle_fragment_invocations\": %.0f,\n", b->particleFragments / measured);
+		printf("  \"particle_overdraw\": %.3f\n", b->particleFragments / measured / pixels); //fragments per pixel
+		printf("}\n");
+
+		return false;
+	}
+
+	//1 full orbit over the measured frames, at a fixed distance and tilt so every run sees the same views:
+	f32 t = b->frame < BENCHMARK_WARMUP_FRAMES ? 0.0f : (f32)(b->frame - BENCHMARK_WARMUP_FRAMES) / (b->numFrames - BENCHMARK_WARMUP_FRAMES);
+	s->cam.angle = s->cam.targetAngle = 45.0f + 360.0f * t;
+	s->cam.tilt = s->cam.targetTilt = 45.0f;
+	s->cam.dist = s->cam.targetDist = b->dist;
+
+	b->frame++;
+	return true;
+}
+
+//returns true if the key changed a generation parameter
+bool _game_edit_galaxy(ParticleGenParamsGPU* params, int32 key)
+{
+	switch(key)
+	{
+	case GLFW_KEY_1:
+		params->bulgeRad = fmaxf(params->bulgeRad - 50.0f, 0.0f);
+		return true;
+	case GLFW_KEY_2:
+		params->bulgeRad = fminf(params->bulgeRad + 50.0f, params->maxRad);
+		return true;
+	case GLFW_KEY_3:
+		params->eccentricity = fmaxf(params->eccentricity - 0.025f, 0.0f);
+		return true;
+	case GLFW_KEY_4:
+		params->eccentricity = fminf(params->eccentricity + 0.025f, 1.0f);
+		return true;
+	case GLFW_KEY_5:
+		params->angleOffset -= 0.25f;
+		return true;
+	case GLFW_KEY_6:
+		params->angleOffset += 0.25f;
+		return true;
+	case GLFW_KEY_N:
+		params->seed++;
+		return true;
+	default:
+		return false;
+	}
+}
+
 //----------------------------------------------------------------------------//
 
 template<typename T>
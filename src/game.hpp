@@ -2,6 +2,7 @@
 #define GAME_H
 
 #include "draw.hpp"
+#include "config.hpp"
 #include "globals.hpp"
 
 //----------------------------------------------------------------------------//
@@ -23,16 +24,38 @@ struct GameCamera
 	float targetAngle;
 };
 
+//accumulated over the measured frames of --benchmark
+struct GameBenchmark
+{
+	uint32 numFrames; //0 if not benchmarking
+	uint32 frame;
+	f32 dist; //of the camera, constant along the path
+
+	f64 cpuFrameTime;
+	DrawTimings gpuTimings;
+	f64 gridVertices;
+	f64 gridFragments;
+	f64 particleVertices;
+	f64 particlePrimitives;
+	f64 particleFragments;
+};
+
 struct GameState
 {
     DrawState* drawState;
 
     GameCamera cam;
+
+    uint32 numGalaxies;
+    uint32 selectedGalaxy; //the galaxy edited with the galaxy keys, cycled with tab
+    ParticleGenParamsGPU genParams; //edited with the galaxy keys, see _game_key_callback
+
+    GameBenchmark benchmark;
 };
 
 //----------------------------------------------------------------------------//
 
-bool game_init(GameState** state);
+bool game_init(GameState** state, const Config* config);
 void game_quit(GameState* state);
 
 void game_main_loop(GameState* state);
@@ -17,20 +17,44 @@ static vkh_bool_t _vkh_create_vk_instance(VKHinstance* instance, const char* nam
 static void _vkh_destroy_vk_instance(VKHinstance* instance);
 
 static vkh_bool_t _vkh_pick_physical_device(VKHinstance* instance);
+static vkh_bool_t _vkh_device_extensions_supported(VkPhysicalDevice device, const char** names, uint32_t count);
 
 static vkh_bool_t _vkh_create_device(VKHinstance* instance);
 static void _vkh_destroy_vk_device(VKHinstance* instance);
 
-static vkh_bool_t _vkh_create_swapchain(VKHinstance* instance, uint32_t w, uint32_t h);
+static vkh_bool_t _vkh_create_swapchain(VKHinstance* instance, uint32_t w, uint32_t h, VkSwapchainKHR oldSwapchain);
 static void _vkh_destroy_swapchain(VKHinstance* instance);
 
 static vkh_bool_t _vkh_create_command_pool(VKHinstance* instance);
 static void _vkh_destroy_command_pool(VKHinstance* instance);
 
+static vkh_bool_t _vkh_create_memory_pools(VKHinstance* instance);
+static void _vkh_destroy_memory_pools(VKHinstance* instance);
+
 //----------------------------------------------------------------------------//
 
 static uint32_t _vkh_find_memory_type(VKHinstance* instance, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+static VKHmemoryBlock* _vkh_memory_block_create(VKHinstance* instance, uint32_t memoryType, vkh_bool_t optimal);
+static void _vkh_memory_block_destroy(VKHinstance* instance, VKHmemoryBlock* block);
+static vkh_bool_t _vkh_memory_block_alloc(VKHmemoryBlock* block, uint32_t order, VkDeviceSize* offset);
+static void _vkh_memory_block_free(VKHmemoryBlock* block, VkDeviceSize offset, uint32_t order);
+static void _vkh_memory_block_update_parents(VKHmemoryBlock* block, uint64_t node, uint32_t order);
+
+static void _vkh_record_image_transition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+
+//----------------------------------------------------------------------------//
+
+static VkDeviceSize _vkh_upload_alloc(VKHuploadContext* context, VKHinstance* instance, VkDeviceSize size);
+static void _vkh_upload_begin_batch(VKHuploadContext* context, VKHinstance* instance);
+static void _vkh_upload_retire_batch(VKHuploadContext* context, VKHinstance* instance, VKHuploadBatch* batch);
+
+static void _vkh_destroy_retired_object(VKHinstance* instance, VKHretiredObject* object);
+
+static VKHcomputePipeline* _vkh_create_compute_pass(VKHinstance* instance, const char* shaderDir, const char* name, uint32_t bindingCount, uint32_t pushConstantSize);
+static void _vkh_destroy_compute_pass(VKHinstance* instance, VKHcomputePipeline* pipeline);
+static void _vkh_record_compute_barrier(VkCommandBuffer commandBuffer);
+
 //----------------------------------------------------------------------------//
 
 static VKAPI_ATTR VkBool32 _vkh_vk_debug_callback(
@@ -75,13 +99,25 @@ const char* REQUIRED_DEVICE_EXTENSIONS[REQUIRED_DEVICE_EXTENSION_COUNT] = {
 #endif
 };
 
+//enabled together if the device supports all of them
+#define VKH_MESH_SHADER_EXTENSION_COUNT 3
+const char* VKH_MESH_SHADER_EXTENSIONS[VKH_MESH_SHADER_EXTENSION_COUNT] = {
+    "VK_EXT_mesh_shader",
+    "VK_KHR_spirv_1_4",
+    "VK_KHR_shader_float_controls"
+};
+
 //----------------------------------------------------------------------------//
 
-vkh_bool_t vkh_init(VKHinstance** instance, uint32_t windowW, uint32_t windowH, const char* windowName)
+vkh_bool_t vkh_init(VKHinstance** instance, uint32_t windowW, uint32_t windowH, const char* windowName,
+                    VkPresentModeKHR presentMode, uint32_t imageCount)
 {
 	*instance = (VKHinstance*)malloc(sizeof(VKHinstance));
 	VKHinstance* inst = *instance;
 
+	inst->requestedPresentMode = presentMode;
+	inst->requestedImageCount = imageCount;
+
 	if(!_vkh_init_glfw(inst, windowW, windowH, windowName))
 		return VKH_FALSE;
 
@@ -94,7 +130,10 @@ vkh_bool_t vkh_init(VKHinstance** instance, uint32_t windowW, uint32_t windowH,
 	if(!_vkh_create_device(inst))
 		return VKH_FALSE;
 
-	if(!_vkh_create_swapchain(inst, windowW, windowH))
+	if(!_vkh_create_memory_pools(inst))
+		return VKH_FALSE;
+
+	if(!_vkh_create_swapchain(inst, windowW, windowH, VK_NULL_HANDLE))
 		return VKH_FALSE;
 
 	if(!_vkh_create_command_pool(inst))
@@ -107,6 +146,7 @@ void vkh_quit(VKHinstance* inst)
 {
 	_vkh_destroy_command_pool(inst);
 	_vkh_destroy_swapchain(inst);
+	_vkh_destroy_memory_pools(inst);
 	_vkh_destroy_vk_device(inst);
 	_vkh_destroy_vk_instance(inst);
 	_vkh_quit_glfw(inst);
@@ -124,13 +164,217 @@ void vkh_resize_swapchain(VKHinstance* inst, uint32_t w, uint32_t h)
 	vkDeviceWaitIdle(inst->device);
 
 	_vkh_destroy_swapchain(inst);
-	_vkh_create_swapchain(inst, w, h);
+	_vkh_create_swapchain(inst, w, h, VK_NULL_HANDLE);
+}
+
+vkh_bool_t vkh_recreate_swapchain(VKHinstance* inst, uint32_t w, uint32_t h, VKHdeletionQueue* queue)
+{
+	//the old swapchain is handed to the new one, which lets the presentation engine switch without a gap. it is retired
+	//by this even if no new swapchain is created:
+	VkSwapchainKHR oldSwapchain = inst->swapchain;
+	uint32_t oldImageCount = inst->swapchainImageCount;
+	VkImage* oldImages = inst->swapchainImages;
+	VkImageView* oldImageViews = inst->swapchainImageViews;
+
+	vkh_bool_t created = _vkh_create_swapchain(inst, w, h, oldSwapchain);
+
+	//the views go first, they are destroyed in the order they are retired:
+	for(uint32_t i = 0; i < oldImageCount; i++)
+		vkh_retire_image_view(queue, oldImageViews[i]);
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_SWAPCHAIN;
+	object.frame = queue->frame;
+	object.swapchain = oldSwapchain;
+	qd_dynarray_push(queue->objects, &object);
+
+	free(oldImages);
+	free(oldImageViews);
+
+	if(!created)
+	{
+		inst->swapchain = VK_NULL_HANDLE;
+		inst->swapchainImageCount = 0;
+		inst->swapchainImages = NULL;
+		inst->swapchainImageViews = NULL;
+	}
+
+	return created;
+}
+
+//----------------------------------------------------------------------------//
+
+vkh_bool_t vkh_allocate_memory(VKHinstance* inst, VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, vkh_bool_t optimal, VKHallocation* allocation)
+{
+	memset(allocation, 0, sizeof(VKHallocation));
+
+	uint32_t memoryType = _vkh_find_memory_type(inst, requirements.memoryTypeBits, properties);
+	if(memoryType == UINT32_MAX)
+		return VKH_FALSE;
+
+	allocation->memoryType = memoryType;
+	VKHmemoryPool* pool = &inst->memoryPools[memoryType];
+
+	//find node size, buddy nodes are naturally aligned to their size:
+	//---------------
+	VkDeviceSize size = requirements.size > requirements.alignment ? requirements.size : requirements.alignment;
+	uint32_t order = 0;
+	while((VKH_MEMORY_LEAF_SIZE << order) < size)
+		order++;
+
+	//sub-allocate from an existing or new block:
+	//---------------
+	if(order < VKH_MEMORY_MAX_ORDER)
+	{
+		//when the granularity is larger than a leaf, linear and optimal resources must live in separate blocks:
+		vkh_bool_t separateTiling = inst->properties.limits.bufferImageGranularity > VKH_MEMORY_LEAF_SIZE;
+
+		VKHmemoryBlock* block = pool->blocks;
+		VkDeviceSize offset;
+		for(; block; block = block->next)
+		{
+			if(separateTiling && block->optimal != optimal)
+				continue;
+
+			if(_vkh_memory_block_alloc(block, order, &offset))
+				break;
+		}
+
+		if(!block)
+		{
+			block = _vkh_memory_block_create(inst, memoryType, optimal);
+			if(block)
+			{
+				block->next = pool->blocks;
+				pool->blocks = block;
+
+				_vkh_memory_block_alloc(block, order, &offset);
+			}
+		}
+
+		if(block)
+		{
+			block->allocCount++;
+			block->used += VKH_MEMORY_LEAF_SIZE << order;
+
+			allocation->memory = block->memory;
+			allocation->offset = offset;
+			allocation->size = VKH_MEMORY_LEAF_SIZE << order;
+			allocation->mapped = block->mapped ? block->mapped + offset : NULL;
+			allocation->block = block;
+			return VKH_TRUE;
+		}
+
+		//fall back to a dedicated allocation, it may still fit if a whole block does not
+	}
+
+	//allocate dedicated memory:
+	//---------------
+	VkMemoryAllocateInfo allocInfo = {0};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if(vkAllocateMemory(inst->device, &allocInfo, NULL, &allocation->memory) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to allocate device memory");
+		return VKH_FALSE;
+	}
+
+	if(inst->memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if(vkMapMemory(inst->device, allocation->memory, 0, VK_WHOLE_SIZE, 0, (void**)&allocation->mapped) != VK_SUCCESS)
+			ERROR_LOG("failed to map dedicated allocation");
+	}
+
+	allocation->offset = 0;
+	allocation->size = requirements.size;
+
+	pool->dedicatedCount++;
+	pool->dedicatedSize += requirements.size;
+
+	return VKH_TRUE;
+}
+
+void vkh_free_memory(VKHinstance* inst, VKHallocation* allocation)
+{
+	if(allocation->memory == VK_NULL_HANDLE)
+		return;
+
+	VKHmemoryPool* pool = &inst->memoryPools[allocation->memoryType];
+	VKHmemoryBlock* block = allocation->block;
+
+	if(!block)
+	{
+		if(allocation->mapped)
+			vkUnmapMemory(inst->device, allocation->memory);
+		vkFreeMemory(inst->device, allocation->memory, NULL);
+
+		pool->dedicatedCount--;
+		pool->dedicatedSize -= allocation->size;
+	}
+	else
+	{
+		uint32_t order = 0;
+		while((VKH_MEMORY_LEAF_SIZE << order) < allocation->size)
+			order++;
+
+		_vkh_memory_block_free(block, allocation->offset, order);
+		block->allocCount--;
+		block->used -= allocation->size;
+
+		//release empty blocks, but keep the last one around so that resizes and streaming don't hit the driver:
+		if(block->allocCount == 0 && !(pool->blocks == block && block->next == NULL))
+		{
+			VKHmemoryBlock** link = &pool->blocks;
+			while(*link != block)
+				link = &(*link)->next;
+			*link = block->next;
+
+			_vkh_memory_block_destroy(inst, block);
+		}
+	}
+
+	memset(allocation, 0, sizeof(VKHallocation));
+}
+
+uint32_t vkh_get_memory_stats(VKHinstance* inst, VKHmemoryHeapStats* stats)
+{
+	memset(stats, 0, sizeof(VKHmemoryHeapStats) * inst->memProperties.memoryHeapCount);
+
+	for(uint32_t i = 0; i < inst->memProperties.memoryTypeCount; i++)
+	{
+		VKHmemoryPool* pool = &inst->memoryPools[i];
+		VKHmemoryHeapStats* heapStats = &stats[inst->memProperties.memoryTypes[i].heapIndex];
+
+		heapStats->allocationCount += pool->dedicatedCount;
+		heapStats->allocatedBytes += pool->dedicatedSize;
+		heapStats->usedBytes += pool->dedicatedSize;
+
+		for(VKHmemoryBlock* block = pool->blocks; block; block = block->next)
+		{
+			heapStats->blockCount++;
+			heapStats->allocationCount += block->allocCount;
+			heapStats->allocatedBytes += VKH_MEMORY_BLOCK_SIZE;
+			heapStats->usedBytes += block->used;
+			heapStats->freeBytes += VKH_MEMORY_BLOCK_SIZE - block->used;
+
+			VkDeviceSize largest = block->longest[0] ? VKH_MEMORY_LEAF_SIZE << (block->longest[0] - 1) : 0;
+			if(largest > heapStats->largestFreeRange)
+				heapStats->largestFreeRange = largest;
+		}
+	}
+
+	for(uint32_t i = 0; i < inst->memProperties.memoryHeapCount; i++)
+		stats[i].fragmentation = stats[i].freeBytes > 0 ? 1.0f - (float)stats[i].largestFreeRange / (float)stats[i].freeBytes : 0.0f;
+
+	return inst->memProperties.memoryHeapCount;
 }
 
 //----------------------------------------------------------------------------//
 
 VkImage vkh_create_image(VKHinstance* inst, uint32_t w, uint32_t h, uint32_t mipLevels, VkSampleCountFlagBits samples, 
-	VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory* memory)
+	VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VKHallocation* allocation)
 {
 	VkImageCreateInfo imageInfo = {0};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -147,7 +391,7 @@ VkImage vkh_create_image(VKHinstance* inst, uint32_t w, uint32_t h, uint32_t mip
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //TODO: allow this to be specified, not sure if we'd ever want a concurrently shared image
 	imageInfo.samples = samples;
 
-	VkImage image;
+	VkImage image = VK_NULL_HANDLE;
 	if(vkCreateImage(inst->device, &imageInfo, NULL, &image) != VK_SUCCESS)
 	{
 		ERROR_LOG("failed to create image");
@@ -157,25 +401,20 @@ VkImage vkh_create_image(VKHinstance* inst, uint32_t w, uint32_t h, uint32_t mip
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(inst->device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {0};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = _vkh_find_memory_type(inst, memRequirements.memoryTypeBits, properties);
-
-	if(vkAllocateMemory(inst->device, &allocInfo, NULL, memory) != VK_SUCCESS)
+	if(!vkh_allocate_memory(inst, memRequirements, properties, tiling == VK_IMAGE_TILING_OPTIMAL, allocation))
 	{
 		ERROR_LOG("failed to allocate device memory for image");
 		return image;
 	}
 
-	vkBindImageMemory(inst->device, image, *memory, 0);
+	vkBindImageMemory(inst->device, image, allocation->memory, allocation->offset);
 	return image;
 }
 
-void vkh_destroy_image(VKHinstance* inst, VkImage image, VkDeviceMemory memory)
+void vkh_destroy_image(VKHinstance* inst, VkImage image, VKHallocation* allocation)
 {
-	vkFreeMemory(inst->device, memory, NULL);
 	vkDestroyImage(inst->device, image, NULL);
+	vkh_free_memory(inst, allocation);
 }
 
 VkImageView vkh_create_image_view(VKHinstance* inst, VkImage image, VkFormat format, VkImageAspectFlags aspects, uint32_t mipLevels)
@@ -191,7 +430,7 @@ VkImageView vkh_create_image_view(VKHinstance* inst, VkImage image, VkFormat for
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
-	VkImageView view;
+	VkImageView view = VK_NULL_HANDLE;
 	if(vkCreateImageView(inst->device, &viewInfo, NULL, &view) != VK_SUCCESS)
 		ERROR_LOG("failed to create image view");
 
@@ -203,7 +442,7 @@ void vkh_destroy_image_view(VKHinstance* inst, VkImageView view)
 	vkDestroyImageView(inst->device, view, NULL);
 }
 
-VkBuffer vkh_create_buffer(VKHinstance* inst, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory* memory)
+VkBuffer vkh_create_buffer(VKHinstance* inst, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VKHallocation* allocation)
 {
 	VkBufferCreateInfo createInfo = {0};
 	createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -211,7 +450,10 @@ VkBuffer vkh_create_buffer(VKHinstance* inst, VkDeviceSize size, VkBufferUsageFl
 	createInfo.usage = usage;
 	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-	VkBuffer buffer;
+	//cleared so callers can tell a failed creation apart and destroy it like any other buffer:
+	memset(allocation, 0, sizeof(VKHallocation));
+
+	VkBuffer buffer = VK_NULL_HANDLE;
 	if(vkCreateBuffer(inst->device, &createInfo, NULL, &buffer) != VK_SUCCESS)
 	{
 		ERROR_LOG("failed to create buffer");
@@ -221,86 +463,25 @@ VkBuffer vkh_create_buffer(VKHinstance* inst, VkDeviceSize size, VkBufferUsageFl
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(inst->device, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {0};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = _vkh_find_memory_type(inst, memRequirements.memoryTypeBits, properties);
-
-	if(vkAllocateMemory(inst->device, &allocInfo, NULL, memory) != VK_SUCCESS)
+	if(!vkh_allocate_memory(inst, memRequirements, properties, VKH_FALSE, allocation))
 	{
 		ERROR_LOG("failed to allocate memory for buffer");
 		return buffer;
 	}
 	
-	vkBindBufferMemory(inst->device, buffer, *memory, 0);
+	vkBindBufferMemory(inst->device, buffer, allocation->memory, allocation->offset);
 
 	return buffer;
 }
 
-void vkh_destroy_buffer(VKHinstance* inst, VkBuffer buffer, VkDeviceMemory memory)
+void vkh_destroy_buffer(VKHinstance* inst, VkBuffer buffer, VKHallocation* allocation)
 {
-	vkFreeMemory(inst->device, memory, NULL);
 	vkDestroyBuffer(inst->device, buffer, NULL);
+	vkh_free_memory(inst, allocation);
 }
 
-void vkh_copy_buffer(VKHinstance* inst, VkBuffer src, VkBuffer dst, VkDeviceSize size, uint64_t srcOffset, uint64_t dstOffset)
-{
-	VkCommandBuffer commandBuffer = vkh_start_single_time_command(inst);
-
-	VkBufferCopy copyRegion = {0};
-	copyRegion.srcOffset = srcOffset;
-	copyRegion.dstOffset = dstOffset;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copyRegion);
-
-	vkh_end_single_time_command(inst, commandBuffer);
-}
-
-void vkh_copy_buffer_to_image(VKHinstance* inst, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-	VkCommandBuffer commandBuffer = vkh_start_single_time_command(inst);
-
-	VkBufferImageCopy region = {0};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = (VkOffset3D){0, 0, 0};
-	region.imageExtent = (VkExtent3D){width, height, 1};
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	vkh_end_single_time_command(inst, commandBuffer);
-}
-
-void vkh_copy_with_staging_buf(VKHinstance* inst, VkBuffer stagingBuf, VkDeviceMemory stagingBufMem, VkBuffer buf, uint64_t size, uint64_t offset, void* data)
-{
-	void* mem;
-	vkMapMemory(inst->device, stagingBufMem, 0, size, 0, &mem);
-	memcpy(mem, data, size);
-	vkUnmapMemory(inst->device, stagingBufMem);
-
-	vkh_copy_buffer(inst, stagingBuf, buf, size, 0, offset);
-}
-
-void vkh_copy_with_staging_buf_implicit(VKHinstance* inst, VkBuffer buf, uint64_t size, uint64_t offset, void* data)
-{
-	VkDeviceMemory stagingBufferMemory;
-	VkBuffer stagingBuffer = vkh_create_buffer(inst, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBufferMemory);
-
-	vkh_copy_with_staging_buf(inst, stagingBuffer, stagingBufferMemory, buf, size, offset, data);
-
-	vkh_destroy_buffer(inst, stagingBuffer, stagingBufferMemory);
-}
-
-void vkh_transition_image_layout(VKHinstance* inst, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+static void _vkh_record_image_transition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
 {
-	VkCommandBuffer commandBuffer = vkh_start_single_time_command(inst);
-
 	VkImageMemoryBarrier barrier = {0};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
@@ -338,11 +519,10 @@ void vkh_transition_image_layout(VKHinstance* inst, VkImage image, VkFormat form
 	else
 	{
 		ERROR_LOG("unsupported image transition");
+		return;
 	}
 
 	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, NULL, 0, NULL, 1, &barrier);
-
-	vkh_end_single_time_command(inst, commandBuffer);
 }
 
 uint32_t* vkh_load_spirv(const char* path, uint64_t* size)
@@ -399,38 +579,14 @@ void vkh_destroy_shader_module(VKHinstance* inst, VkShaderModule module)
 
 //----------------------------------------------------------------------------//
 
-VkCommandBuffer vkh_start_single_time_command(VKHinstance* inst)
-{
-	VkCommandBufferAllocateInfo allocInfo = {0};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = inst->commandPool;
-	allocInfo.commandBufferCount = 1;
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(inst->device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {0};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-	return commandBuffer;
-}
-
-void vkh_end_single_time_command(VKHinstance* inst, VkCommandBuffer commandBuffer)
+void vkh_cmd_draw_mesh_tasks_indirect(VKHinstance* inst, VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                      uint32_t drawCount, uint32_t stride)
 {
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo = {0};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(inst->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(inst->graphicsQueue);
-
-	vkFreeCommandBuffers(inst->device, inst->commandPool, 1, &commandBuffer);
+#ifdef VK_EXT_mesh_shader
+	((PFN_vkCmdDrawMeshTasksIndirectEXT)inst->drawMeshTasksIndirect)(commandBuffer, buffer, offset, drawCount, stride);
+#else
+	ERROR_LOG("vkh was built without VK_EXT_mesh_shader");
+#endif
 }
 
 //----------------------------------------------------------------------------//
@@ -452,6 +608,11 @@ VKHgraphicsPipeline* vkh_pipeline_create()
 
 	pipeline->vertShader = VK_NULL_HANDLE;
 	pipeline->fragShader = VK_NULL_HANDLE;
+	pipeline->meshShader = VK_NULL_HANDLE;
+
+	pipeline->vertSpecialization = NULL;
+	pipeline->fragSpecialization = NULL;
+	pipeline->meshSpecialization = NULL;
 
 	pipeline->inputAssemblyState = (VkPipelineInputAssemblyStateCreateInfo){0};
 	pipeline->inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -582,6 +743,7 @@ vkh_bool_t vkh_pipeline_generate(VKHgraphicsPipeline* pipeline, VKHinstance* ins
 		vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
 		vertStage.module = pipeline->vertShader;
 		vertStage.pName = "main";
+		vertStage.pSpecializationInfo = pipeline->vertSpecialization;
 
 		qd_dynarray_push(shaderStages, &vertStage);
 	}
@@ -593,10 +755,27 @@ vkh_bool_t vkh_pipeline_generate(VKHgraphicsPipeline* pipeline, VKHinstance* ins
 		fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		fragStage.module = pipeline->fragShader;
 		fragStage.pName = "main";
+		fragStage.pSpecializationInfo = pipeline->fragSpecialization;
 
 		qd_dynarray_push(shaderStages, &fragStage);
 	}
 
+	if(pipeline->meshShader != VK_NULL_HANDLE)
+	{
+	#ifdef VK_EXT_mesh_shader
+		VkPipelineShaderStageCreateInfo meshStage = {0};
+		meshStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		meshStage.stage = VK_SHADER_STAGE_MESH_BIT_EXT;
+		meshStage.module = pipeline->meshShader;
+		meshStage.pName = "main";
+		meshStage.pSpecializationInfo = pipeline->meshSpecialization;
+
+		qd_dynarray_push(shaderStages, &meshStage);
+	#else
+		ERROR_LOG("vkh was built without VK_EXT_mesh_shader");
+	#endif
+	}
+
 	VkPipelineVertexInputStateCreateInfo vertInputInfo = {0};
 	vertInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertInputInfo.vertexBindingDescriptionCount = (uint32_t)pipeline->vertInputBindings->len;
@@ -635,8 +814,8 @@ vkh_bool_t vkh_pipeline_generate(VKHgraphicsPipeline* pipeline, VKHinstance* ins
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineInfo.stageCount = (uint32_t)shaderStages->len;
 	pipelineInfo.pStages = shaderStages->arr;
-	pipelineInfo.pVertexInputState = &vertInputInfo;
-	pipelineInfo.pInputAssemblyState = &pipeline->inputAssemblyState;
+	pipelineInfo.pVertexInputState = pipeline->meshShader == VK_NULL_HANDLE ? &vertInputInfo : NULL; //mesh pipelines have no vertex input
+	pipelineInfo.pInputAssemblyState = pipeline->meshShader == VK_NULL_HANDLE ? &pipeline->inputAssemblyState : NULL;
 	pipelineInfo.pTessellationState = &pipeline->tesselationState;
 	pipelineInfo.pViewportState = &viewportInfo;
 	pipelineInfo.pRasterizationState = &pipeline->rasterState;
@@ -729,6 +908,25 @@ void vkh_pipeline_set_frag_shader(VKHgraphicsPipeline* pipeline, VkShaderModule
 	pipeline->fragShader = shader;
 }
 
+void vkh_pipeline_set_mesh_shader(VKHgraphicsPipeline* pipeline, VkShaderModule shader)
+{
+	pipeline->meshShader = shader;
+}
+
+void vkh_pipeline_set_specialization(VKHgraphicsPipeline* pipeline, VkShaderStageFlagBits stage, const VkSpecializationInfo* info)
+{
+	if(stage == VK_SHADER_STAGE_VERTEX_BIT)
+		pipeline->vertSpecialization = info;
+	else if(stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+		pipeline->fragSpecialization = info;
+#ifdef VK_EXT_mesh_shader
+	else if(stage == VK_SHADER_STAGE_MESH_BIT_EXT)
+		pipeline->meshSpecialization = info;
+#endif
+	else
+		ERROR_LOG("unsupported shader stage for specialization");
+}
+
 void vkh_pipeline_set_input_assembly_state(VKHgraphicsPipeline* pipeline, VkPrimitiveTopology topology, VkBool32 primitiveRestart)
 {
 	pipeline->inputAssemblyState.topology = topology;
@@ -1112,104 +1310,979 @@ void vkh_descriptor_sets_add_texel_views(VKHdescriptorSets* descriptorSets, uint
 
 //----------------------------------------------------------------------------//
 
-static vkh_bool_t _vkh_init_glfw(VKHinstance* inst, uint32_t w, uint32_t h, const char* name)
+VKHuniformRing* vkh_uniform_ring_create(VKHinstance* inst, VkDeviceSize frameSize, uint32_t frameCount)
 {
-	MSG_LOG("initlalizing GLFW...");
+	VKHuniformRing* ring = (VKHuniformRing*)malloc(sizeof(VKHuniformRing));
+	if(!ring)
+		return NULL;
 
-	if(!glfwInit())
+	ring->alignment = inst->properties.limits.minUniformBufferOffsetAlignment;
+	if(ring->alignment == 0)
+		ring->alignment = 1;
+
+	ring->frameSize = (frameSize + ring->alignment - 1) / ring->alignment * ring->alignment;
+	ring->frameCount = frameCount;
+	ring->frameStart = 0;
+	ring->head = 0;
+
+	ring->buffer = vkh_create_buffer(inst, ring->frameSize * frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+	                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ring->allocation);
+	if(ring->buffer == VK_NULL_HANDLE || ring->allocation.memory == VK_NULL_HANDLE)
 	{
-		ERROR_LOG("failed to initialize GLFW");
-		return VKH_FALSE;
-	}
+		ERROR_LOG("failed to create uniform ring buffer");
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+		vkh_destroy_buffer(inst, ring->buffer, &ring->allocation);
+		free(ring);
+		return NULL;
+	}
 
-	inst->window = glfwCreateWindow(w, h, name, NULL, NULL);
-	if(!inst->window)
+	//memory stays mapped for the lifetime of the ring, host coherent so no flushes are needed:
+	ring->mapped = ring->allocation.mapped;
+	if(!ring->mapped)
 	{
-		ERROR_LOG("failed to create GLFW window");
-		return VKH_FALSE;
+		ERROR_LOG("failed to map uniform ring memory");
+
+		vkh_destroy_buffer(inst, ring->buffer, &ring->allocation);
+		free(ring);
+		return NULL;
 	}
 
-	return VKH_TRUE;
+	return ring;
 }
 
-static void _vkh_quit_glfw(VKHinstance* inst)
+void vkh_uniform_ring_destroy(VKHuniformRing* ring, VKHinstance* inst)
 {
-	MSG_LOG("quitting GLFW...");
+	vkh_destroy_buffer(inst, ring->buffer, &ring->allocation);
 
-	glfwDestroyWindow(inst->window);
-	glfwTerminate();
+	free(ring);
 }
 
-static vkh_bool_t _vkh_create_vk_instance(VKHinstance* inst, const char* name)
+void vkh_uniform_ring_begin_frame(VKHuniformRing* ring, uint32_t frameIdx)
 {
-	MSG_LOG("creating Vulkan instance...");
+	ring->frameStart = ring->frameSize * (frameIdx % ring->frameCount);
+	ring->head = ring->frameStart;
+}
 
-	//get required GLFW extensions:
-	//---------------
-	uint32_t requiredExtensionCount;
-	char** requiredGlfwExtensions = (char**)glfwGetRequiredInstanceExtensions(&requiredExtensionCount);
-	if(!requiredGlfwExtensions)
+uint32_t vkh_uniform_ring_push(VKHuniformRing* ring, VkDeviceSize size, const void* data)
+{
+	if(ring->head + size > ring->frameStart + ring->frameSize)
 	{
-		ERROR_LOG("Vulkan rendering not supported on this machine");
-		return VKH_FALSE;
+		ERROR_LOG("uniform ring frame region is full");
+		return VKH_UNIFORM_RING_FULL;
 	}
-	vkh_bool_t freeExtensionList = VKH_FALSE;
 
-    //reserve space for portability extension
-    //---------------
-#if __APPLE__
-    requiredExtensionCount += 2;
-#endif
+	VkDeviceSize offset = ring->head;
+	memcpy(ring->mapped + offset, data, size);
 
-    #if VKH_VALIDATION_LAYERS
-    requiredExtensionCount++;
-    #endif
+	ring->head = (offset + size + ring->alignment - 1) / ring->alignment * ring->alignment;
+	return (uint32_t)offset;
+}
 
-    char** requiredExtensions = (char**)malloc(requiredExtensionCount * sizeof(char*));
-    memcpy(requiredExtensions, requiredGlfwExtensions, requiredExtensionCount * sizeof(char*));
+//----------------------------------------------------------------------------//
 
-    //set portability extension
-    //---------------
-#if __APPLE__
-    requiredExtensions[requiredExtensionCount - 1] = VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME;
-    requiredExtensions[requiredExtensionCount - 2] = "VK_KHR_get_physical_device_properties2";
-    #if VKH_VALIDATION_LAYERS
-    requiredExtensions[requiredExtensionCount - 3] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
-    #endif
-#else
-    requiredExtensions[requiredExtensionCount - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
-#endif
+VKHuploadContext* vkh_upload_context_create(VKHinstance* inst, VkDeviceSize stagingSize)
+{
+	VKHuploadContext* context = (VKHuploadContext*)malloc(sizeof(VKHuploadContext));
+	if(!context)
+		return NULL;
 
-	//check if glfw extensions are supported:
+	context->stagingSize = stagingSize;
+	context->head = 0;
+	context->curBatch = 0;
+
+	//create staging ring:
 	//---------------
-	uint32_t extensionCount;
-	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
-	VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(extensionCount * sizeof(VkExtensionProperties));
-	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions);
+	context->stagingBuffer = vkh_create_buffer(inst, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &context->stagingAllocation);
 
-	for(uint32_t i = 0; i < requiredExtensionCount; i++)
+	context->stagingMapped = context->stagingAllocation.mapped;
+	if(!context->stagingMapped)
 	{
-		vkh_bool_t found = VKH_FALSE;
-		for(uint32_t j = 0; j < extensionCount; j++)
-			if(strcmp(requiredExtensions[i], extensions[j].extensionName) == 0)
-			{
-				found = VKH_TRUE;
-				break;
-			}
-		
-		if(!found)
-		{
-			ERROR_LOG("1 or more required GLFW extensions not supported");;
-			return VKH_FALSE;
-		}
-	}
+		ERROR_LOG("failed to map upload staging memory");
 
-	free(extensions);
+		vkh_destroy_buffer(inst, context->stagingBuffer, &context->stagingAllocation);
+		free(context);
+		return NULL;
+	}
 
-	//check if validation layers are supported:
+	//create command buffers and fences:
+	//---------------
+	VkCommandPoolCreateInfo poolInfo = {0};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = inst->graphicsComputeFamilyIdx;
+
+	if(vkCreateCommandPool(inst->device, &poolInfo, NULL, &context->commandPool) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to create upload command pool");
+
+		vkh_destroy_buffer(inst, context->stagingBuffer, &context->stagingAllocation);
+		free(context);
+		return NULL;
+	}
+
+	VkCommandBuffer commandBuffers[VKH_UPLOAD_BATCH_COUNT];
+
+	VkCommandBufferAllocateInfo allocInfo = {0};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = context->commandPool;
+	allocInfo.commandBufferCount = VKH_UPLOAD_BATCH_COUNT;
+
+	if(vkAllocateCommandBuffers(inst->device, &allocInfo, commandBuffers) != VK_SUCCESS)
+	{
+		ERROR_LOG("failed to allocate upload command buffers");
+
+		vkDestroyCommandPool(inst->device, context->commandPool, NULL);
+		vkh_destroy_buffer(inst, context->stagingBuffer, &context->stagingAllocation);
+		free(context);
+		return NULL;
+	}
+
+	VkFenceCreateInfo fenceInfo = {0};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+	{
+		context->batches[i].commandBuffer = commandBuffers[i];
+		context->batches[i].state = VKH_UPLOAD_BATCH_IDLE;
+		context->batches[i].stagingStart = 0;
+
+		if(vkCreateFence(inst->device, &fenceInfo, NULL, &context->batches[i].fence) != VK_SUCCESS)
+		{
+			ERROR_LOG("failed to create upload fence");
+
+			for(uint32_t j = 0; j < i; j++)
+				vkDestroyFence(inst->device, context->batches[j].fence, NULL);
+			vkDestroyCommandPool(inst->device, context->commandPool, NULL); //frees the command buffers
+			vkh_destroy_buffer(inst, context->stagingBuffer, &context->stagingAllocation);
+			free(context);
+			return NULL;
+		}
+	}
+
+	return context;
+}
+
+void vkh_upload_context_destroy(VKHuploadContext* context, VKHinstance* inst)
+{
+	vkh_upload_flush(context, inst);
+	vkh_upload_wait(context, inst);
+
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+		vkDestroyFence(inst->device, context->batches[i].fence, NULL);
+	vkDestroyCommandPool(inst->device, context->commandPool, NULL);
+
+	vkh_destroy_buffer(inst, context->stagingBuffer, &context->stagingAllocation);
+
+	free(context);
+}
+
+void vkh_upload_buffer(VKHuploadContext* context, VKHinstance* inst, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data)
+{
+	//split into chunks so that uploads larger than the staging ring still work:
+	const uint8_t* src = (const uint8_t*)data;
+	while(size > 0)
+	{
+		VkDeviceSize chunkSize = size < context->stagingSize ? size : context->stagingSize;
+
+		VkDeviceSize stagingOffset = _vkh_upload_alloc(context, inst, chunkSize);
+		memcpy(context->stagingMapped + stagingOffset, src, chunkSize);
+
+		VkBufferCopy copyRegion = {0};
+		copyRegion.srcOffset = stagingOffset;
+		copyRegion.dstOffset = offset;
+		copyRegion.size = chunkSize;
+		vkCmdCopyBuffer(context->batches[context->curBatch].commandBuffer, context->stagingBuffer, buffer, 1, &copyRegion);
+
+		src += chunkSize;
+		offset += chunkSize;
+		size -= chunkSize;
+	}
+}
+
+void vkh_upload_buffer_to_image(VKHuploadContext* context, VKHinstance* inst, VkImage image, uint32_t width, uint32_t height, VkDeviceSize size, const void* data)
+{
+	if(size > context->stagingSize)
+	{
+		ERROR_LOG("image upload is larger than the staging ring");
+		return;
+	}
+
+	VkDeviceSize stagingOffset = _vkh_upload_alloc(context, inst, size);
+	memcpy(context->stagingMapped + stagingOffset, data, size);
+
+	VkBufferImageCopy region = {0};
+	region.bufferOffset = stagingOffset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = (VkOffset3D){0, 0, 0};
+	region.imageExtent = (VkExtent3D){width, height, 1};
+
+	vkCmdCopyBufferToImage(context->batches[context->curBatch].commandBuffer, context->stagingBuffer, image, 
+	                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void vkh_upload_transition_image(VKHuploadContext* context, VKHinstance* inst, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+{
+	VkCommandBuffer commandBuffer = vkh_upload_command_buffer(context, inst);
+	_vkh_record_image_transition(commandBuffer, image, oldLayout, newLayout, mipLevels);
+}
+
+VkCommandBuffer vkh_upload_command_buffer(VKHuploadContext* context, VKHinstance* inst)
+{
+	_vkh_upload_begin_batch(context, inst);
+	return context->batches[context->curBatch].commandBuffer;
+}
+
+void vkh_upload_flush(VKHuploadContext* context, VKHinstance* inst)
+{
+	VKHuploadBatch* batch = &context->batches[context->curBatch];
+	if(batch->state != VKH_UPLOAD_BATCH_RECORDING)
+		return;
+
+	//make all transfers visible to whatever is submitted after this batch:
+	VkMemoryBarrier barrier = {0};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+	                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+	vkEndCommandBuffer(batch->commandBuffer);
+
+	VkSubmitInfo submitInfo = {0};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch->commandBuffer;
+
+	if(vkQueueSubmit(inst->graphicsQueue, 1, &submitInfo, batch->fence) != VK_SUCCESS)
+		ERROR_LOG("failed to submit upload batch");
+
+	batch->state = VKH_UPLOAD_BATCH_PENDING;
+	context->curBatch = (context->curBatch + 1) % VKH_UPLOAD_BATCH_COUNT;
+}
+
+void vkh_upload_wait(VKHuploadContext* context, VKHinstance* inst)
+{
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+		_vkh_upload_retire_batch(context, inst, &context->batches[i]);
+}
+
+static void _vkh_upload_retire_batch(VKHuploadContext* context, VKHinstance* inst, VKHuploadBatch* batch)
+{
+	if(batch->state != VKH_UPLOAD_BATCH_PENDING)
+		return;
+
+	vkWaitForFences(inst->device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(inst->device, 1, &batch->fence);
+	batch->state = VKH_UPLOAD_BATCH_IDLE;
+}
+
+static void _vkh_upload_begin_batch(VKHuploadContext* context, VKHinstance* inst)
+{
+	VKHuploadBatch* batch = &context->batches[context->curBatch];
+	if(batch->state == VKH_UPLOAD_BATCH_RECORDING)
+		return;
+
+	_vkh_upload_retire_batch(context, inst, batch);
+
+	VkCommandBufferBeginInfo beginInfo = {0};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkResetCommandBuffer(batch->commandBuffer, 0);
+	vkBeginCommandBuffer(batch->commandBuffer, &beginInfo);
+
+	batch->state = VKH_UPLOAD_BATCH_RECORDING;
+	batch->stagingStart = context->head;
+}
+
+static VkDeviceSize _vkh_upload_alloc(VKHuploadContext* context, VKHinstance* inst, VkDeviceSize size)
+{
+	//find start, skipping to the next lap of the ring if the allocation would straddle the end:
+	//---------------
+	VkDeviceSize start = (context->head + VKH_UPLOAD_ALIGNMENT - 1) / VKH_UPLOAD_ALIGNMENT * VKH_UPLOAD_ALIGNMENT;
+	if(start / context->stagingSize != (start + size - 1) / context->stagingSize)
+		start = (start / context->stagingSize + 1) * context->stagingSize;
+
+	VkDeviceSize end = start + size;
+
+	//retire batches from oldest to newest until the allocation no longer overlaps in-flight data:
+	//---------------
+	for(uint32_t i = 1; i <= VKH_UPLOAD_BATCH_COUNT; i++)
+	{
+		VKHuploadBatch* batch = &context->batches[(context->curBatch + i) % VKH_UPLOAD_BATCH_COUNT];
+		if(batch->state == VKH_UPLOAD_BATCH_IDLE)
+			continue;
+
+		if(end - batch->stagingStart <= context->stagingSize)
+			break;
+
+		//the current batch alone fills the ring, submit it so it can be retired:
+		if(batch->state == VKH_UPLOAD_BATCH_RECORDING)
+			vkh_upload_flush(context, inst);
+
+		_vkh_upload_retire_batch(context, inst, batch);
+	}
+
+	_vkh_upload_begin_batch(context, inst);
+
+	//the batch's range starts at its first reservation, once alignment and wrapping have placed it:
+	VKHuploadBatch* batch = &context->batches[context->curBatch];
+	if(batch->stagingStart == context->head)
+		batch->stagingStart = start;
+
+	context->head = end;
+	return start % context->stagingSize;
+}
+
+//----------------------------------------------------------------------------//
+
+VKHdeletionQueue* vkh_deletion_queue_create(uint32_t delay)
+{
+	VKHdeletionQueue* queue = (VKHdeletionQueue*)malloc(sizeof(VKHdeletionQueue));
+	if(!queue)
+		return NULL;
+
+	queue->objects = qd_dynarray_create(sizeof(VKHretiredObject), NULL);
+	queue->frame = 0;
+	queue->delay = delay;
+
+	return queue;
+}
+
+void vkh_deletion_queue_destroy(VKHdeletionQueue* queue, VKHinstance* inst)
+{
+	vkh_deletion_queue_flush(queue, inst);
+
+	qd_dynarray_free(queue->objects);
+	free(queue);
+}
+
+static void _vkh_destroy_retired_object(VKHinstance* inst, VKHretiredObject* object)
+{
+	switch(object->type)
+	{
+	case VKH_RETIRED_IMAGE:
+		vkh_destroy_image(inst, object->image, &object->allocation);
+		break;
+	case VKH_RETIRED_IMAGE_VIEW:
+		vkh_destroy_image_view(inst, object->imageView);
+		break;
+	case VKH_RETIRED_FRAMEBUFFER:
+		vkDestroyFramebuffer(inst->device, object->framebuffer, NULL);
+		break;
+	case VKH_RETIRED_BUFFER:
+		vkh_destroy_buffer(inst, object->buffer, &object->allocation);
+		break;
+	case VKH_RETIRED_DESCRIPTOR_SETS:
+		vkh_descriptor_sets_cleanup(object->descriptorSets, inst);
+		vkh_descriptor_sets_destroy(object->descriptorSets);
+		break;
+	case VKH_RETIRED_SCAN:
+		vkh_scan_destroy(object->scan, inst);
+		break;
+	case VKH_RETIRED_SWAPCHAIN:
+		vkDestroySwapchainKHR(inst->device, object->swapchain, NULL);
+		break;
+	}
+}
+
+void vkh_deletion_queue_next_frame(VKHdeletionQueue* queue, VKHinstance* inst)
+{
+	queue->frame++;
+
+	//objects are retired in frame order, so the ones that are due are at the front:
+	VKHretiredObject* objects = (VKHretiredObject*)queue->objects->arr;
+	size_t due = 0;
+	while(due < queue->objects->len && objects[due].frame + queue->delay <= queue->frame)
+	{
+		_vkh_destroy_retired_object(inst, &objects[due]);
+		due++;
+	}
+
+	if(due == 0)
+		return;
+
+	memmove(objects, objects + due, (queue->objects->len - due) * sizeof(VKHretiredObject));
+	queue->objects->len -= due;
+}
+
+void vkh_deletion_queue_flush(VKHdeletionQueue* queue, VKHinstance* inst)
+{
+	VKHretiredObject* objects = (VKHretiredObject*)queue->objects->arr;
+	for(size_t i = 0; i < queue->objects->len; i++)
+		_vkh_destroy_retired_object(inst, &objects[i]);
+
+	queue->objects->len = 0;
+}
+
+void vkh_retire_image(VKHdeletionQueue* queue, VkImage image, VKHallocation* allocation)
+{
+	if(image == VK_NULL_HANDLE && allocation->memory == VK_NULL_HANDLE)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_IMAGE;
+	object.frame = queue->frame;
+	object.image = image;
+	object.allocation = *allocation;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+void vkh_retire_image_view(VKHdeletionQueue* queue, VkImageView view)
+{
+	if(view == VK_NULL_HANDLE)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_IMAGE_VIEW;
+	object.frame = queue->frame;
+	object.imageView = view;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+void vkh_retire_framebuffer(VKHdeletionQueue* queue, VkFramebuffer framebuffer)
+{
+	if(framebuffer == VK_NULL_HANDLE)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_FRAMEBUFFER;
+	object.frame = queue->frame;
+	object.framebuffer = framebuffer;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+void vkh_retire_buffer(VKHdeletionQueue* queue, VkBuffer buffer, VKHallocation* allocation)
+{
+	if(buffer == VK_NULL_HANDLE && allocation->memory == VK_NULL_HANDLE)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_BUFFER;
+	object.frame = queue->frame;
+	object.buffer = buffer;
+	object.allocation = *allocation;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+void vkh_retire_descriptor_sets(VKHdeletionQueue* queue, VKHdescriptorSets* descriptorSets)
+{
+	if(!descriptorSets)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_DESCRIPTOR_SETS;
+	object.frame = queue->frame;
+	object.descriptorSets = descriptorSets;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+void vkh_retire_scan(VKHdeletionQueue* queue, VKHscan* scan)
+{
+	if(!scan)
+		return;
+
+	VKHretiredObject object = {0};
+	object.type = VKH_RETIRED_SCAN;
+	object.frame = queue->frame;
+	object.scan = scan;
+	qd_dynarray_push(queue->objects, &object);
+}
+
+//----------------------------------------------------------------------------//
+
+VKHscan* vkh_scan_create(VKHinstance* inst, VkBuffer data, uint32_t maxCount, const char* shaderDir)
+{
+	if(maxCount == 0 || maxCount > VKH_SCAN_MAX_COUNT)
+	{
+		ERROR_LOG("scan count must be between 1 and VKH_SCAN_MAX_COUNT");
+		return NULL;
+	}
+
+	//zeroed so that vkh_scan_destroy() can tear down a partially created scan:
+	VKHscan* scan = (VKHscan*)calloc(1, sizeof(VKHscan));
+	if(!scan)
+		return NULL;
+
+	scan->maxCount = maxCount;
+
+	//create pipelines (data and sums, both take the count as a push constant):
+	//---------------
+	scan->blockPipeline = _vkh_create_compute_pass(inst, shaderDir, "scan.comp.spv", 2, sizeof(uint32_t));
+	scan->addPipeline   = _vkh_create_compute_pass(inst, shaderDir, "scan_add.comp.spv", 2, sizeof(uint32_t));
+	if(!scan->blockPipeline || !scan->addPipeline)
+	{
+		ERROR_LOG("failed to create scan pipelines");
+		vkh_scan_destroy(scan, inst);
+		return NULL;
+	}
+
+	//create block sums, the total of the second level goes after them at an offset that is always aligned:
+	//---------------
+	uint32_t numBlocks = (maxCount + VKH_SCAN_BLOCK_SIZE - 1) / VKH_SCAN_BLOCK_SIZE;
+	VkDeviceSize totalOffset = VKH_SCAN_BLOCK_SIZE * sizeof(uint32_t);
+
+	scan->blockSums = vkh_create_buffer(inst, totalOffset + sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scan->blockSumsMemory);
+	if(scan->blockSums == VK_NULL_HANDLE || scan->blockSumsMemory.memory == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create scan block sums");
+		vkh_scan_destroy(scan, inst);
+		return NULL;
+	}
+
+	//create descriptor sets, the add pass uses set 0 too since its layout is identical:
+	//---------------
+	VkDescriptorBufferInfo bufferInfos[4] = {0};
+	bufferInfos[0].buffer = data;
+	bufferInfos[0].offset = 0;
+	bufferInfos[0].range = VK_WHOLE_SIZE;
+
+	bufferInfos[1].buffer = scan->blockSums;
+	bufferInfos[1].offset = 0;
+	bufferInfos[1].range = numBlocks * sizeof(uint32_t);
+
+	bufferInfos[2] = bufferInfos[1];
+
+	bufferInfos[3].buffer = scan->blockSums;
+	bufferInfos[3].offset = totalOffset;
+	bufferInfos[3].range = sizeof(uint32_t);
+
+	scan->descriptorSets = vkh_descriptor_sets_create(2);
+	if(!scan->descriptorSets)
+	{
+		vkh_scan_destroy(scan, inst);
+		return NULL;
+	}
+
+	for(uint32_t i = 0; i < 2; i++)
+	{
+		vkh_descriptor_sets_add_buffers(scan->descriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, 0, 1, &bufferInfos[2 * i]);
+		vkh_descriptor_sets_add_buffers(scan->descriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 0, 1, &bufferInfos[2 * i + 1]);
+	}
+
+	if(!vkh_desctiptor_sets_generate(scan->descriptorSets, inst, scan->blockPipeline->descriptorLayout))
+	{
+		ERROR_LOG("failed to create scan descriptor sets");
+		vkh_scan_destroy(scan, inst);
+		return NULL;
+	}
+
+	return scan;
+}
+
+void vkh_scan_destroy(VKHscan* scan, VKHinstance* inst)
+{
+	if(scan->descriptorSets)
+	{
+		vkh_descriptor_sets_cleanup(scan->descriptorSets, inst);
+		vkh_descriptor_sets_destroy(scan->descriptorSets);
+	}
+
+	vkh_destroy_buffer(inst, scan->blockSums, &scan->blockSumsMemory);
+
+	_vkh_destroy_compute_pass(inst, scan->addPipeline);
+	_vkh_destroy_compute_pass(inst, scan->blockPipeline);
+
+	free(scan);
+}
+
+void vkh_scan_record(VKHscan* scan, VkCommandBuffer commandBuffer, uint32_t count)
+{
+	if(count > scan->maxCount)
+	{
+		ERROR_LOG("scan count is larger than the scan was created for");
+		return;
+	}
+
+	uint32_t numBlocks = (count + VKH_SCAN_BLOCK_SIZE - 1) / VKH_SCAN_BLOCK_SIZE;
+	if(numBlocks == 0)
+		return;
+
+	//scan every block:
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scan->blockPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scan->blockPipeline->layout, 0, 1, &scan->descriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, scan->blockPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &count);
+	vkCmdDispatch(commandBuffer, numBlocks, 1, 1);
+
+	//a single block is already complete:
+	if(numBlocks == 1)
+		return;
+
+	//scan the blocks' totals, which all fit in 1 block:
+	_vkh_record_compute_barrier(commandBuffer);
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scan->blockPipeline->layout, 0, 1, &scan->descriptorSets->sets[1], 0, NULL);
+	vkCmdPushConstants(commandBuffer, scan->blockPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &numBlocks);
+	vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+	//add them to every block but the first:
+	_vkh_record_compute_barrier(commandBuffer);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scan->addPipeline->pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scan->addPipeline->layout, 0, 1, &scan->descriptorSets->sets[0], 0, NULL);
+	vkCmdPushConstants(commandBuffer, scan->addPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &count);
+	vkCmdDispatch(commandBuffer, (count - VKH_SCAN_BLOCK_SIZE + 255) / 256, 1, 1);
+}
+
+//----------------------------------------------------------------------------//
+
+VKHradixSort* vkh_radix_sort_create(VKHinstance* inst, uint32_t maxCount, const char* shaderDir)
+{
+	uint32_t maxBlocks = (maxCount + VKH_RADIX_BLOCK_SIZE - 1) / VKH_RADIX_BLOCK_SIZE;
+	if(maxCount == 0 || (uint64_t)maxBlocks << VKH_RADIX_BITS > VKH_SCAN_MAX_COUNT)
+	{
+		ERROR_LOG("radix sort count is too large for the histogram scan");
+		return NULL;
+	}
+
+	//zeroed so that vkh_radix_sort_destroy() can tear down a partially created sort:
+	VKHradixSort* sort = (VKHradixSort*)calloc(1, sizeof(VKHradixSort));
+	if(!sort)
+		return NULL;
+
+	sort->maxCount = maxCount;
+
+	//create pipelines (count, shift, block count as push constants):
+	//---------------
+	sort->histogramPipeline = _vkh_create_compute_pass(inst, shaderDir, "radix_histogram.comp.spv", 2, 3 * sizeof(uint32_t));
+	sort->scatterPipeline   = _vkh_create_compute_pass(inst, shaderDir, "radix_scatter.comp.spv", 5, 3 * sizeof(uint32_t));
+	if(!sort->histogramPipeline || !sort->scatterPipeline)
+	{
+		ERROR_LOG("failed to create radix sort pipelines");
+		vkh_radix_sort_destroy(sort, inst);
+		return NULL;
+	}
+
+	//create buffers:
+	//---------------
+	VkDeviceSize size = (VkDeviceSize)maxCount * sizeof(uint32_t);
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	sort->keys       = vkh_create_buffer(inst, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort->keysMemory);
+	sort->values     = vkh_create_buffer(inst, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort->valuesMemory);
+	sort->tempKeys   = vkh_create_buffer(inst, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort->tempKeysMemory);
+	sort->tempValues = vkh_create_buffer(inst, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort->tempValuesMemory);
+
+	uint32_t histogramCount = maxBlocks << VKH_RADIX_BITS;
+	sort->histograms = vkh_create_buffer(inst, histogramCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &sort->histogramsMemory);
+
+	if(sort->keysMemory.memory == VK_NULL_HANDLE || sort->valuesMemory.memory == VK_NULL_HANDLE ||
+	   sort->tempKeysMemory.memory == VK_NULL_HANDLE || sort->tempValuesMemory.memory == VK_NULL_HANDLE ||
+	   sort->histogramsMemory.memory == VK_NULL_HANDLE)
+	{
+		ERROR_LOG("failed to create radix sort buffers");
+		vkh_radix_sort_destroy(sort, inst);
+		return NULL;
+	}
+
+	sort->scan = vkh_scan_create(inst, sort->histograms, histogramCount, shaderDir);
+	if(!sort->scan)
+	{
+		vkh_radix_sort_destroy(sort, inst);
+		return NULL;
+	}
+
+	//create descriptor sets, 1 per direction of the ping-pong:
+	//---------------
+	VkBuffer buffers[5] = {sort->keys, sort->values, sort->tempKeys, sort->tempValues, sort->histograms};
+	VkDescriptorBufferInfo bufferInfos[5] = {0};
+	for(uint32_t i = 0; i < 5; i++)
+	{
+		bufferInfos[i].buffer = buffers[i];
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+	}
+
+	sort->histogramDescriptorSets = vkh_descriptor_sets_create(2);
+	sort->scatterDescriptorSets = vkh_descriptor_sets_create(2);
+	if(!sort->histogramDescriptorSets || !sort->scatterDescriptorSets)
+	{
+		vkh_radix_sort_destroy(sort, inst);
+		return NULL;
+	}
+
+	for(uint32_t i = 0; i < 2; i++)
+	{
+		uint32_t src = 2 * i;
+		uint32_t dst = 2 - 2 * i;
+
+		vkh_descriptor_sets_add_buffers(sort->histogramDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, 0, 1, &bufferInfos[src]);
+		vkh_descriptor_sets_add_buffers(sort->histogramDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 0, 1, &bufferInfos[4]);
+
+		vkh_descriptor_sets_add_buffers(sort->scatterDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, 0, 1, &bufferInfos[src]);
+		vkh_descriptor_sets_add_buffers(sort->scatterDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 0, 1, &bufferInfos[src + 1]);
+		vkh_descriptor_sets_add_buffers(sort->scatterDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, 0, 1, &bufferInfos[dst]);
+		vkh_descriptor_sets_add_buffers(sort->scatterDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, 0, 1, &bufferInfos[dst + 1]);
+		vkh_descriptor_sets_add_buffers(sort->scatterDescriptorSets, i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, 0, 1, &bufferInfos[4]);
+	}
+
+	if(!vkh_desctiptor_sets_generate(sort->histogramDescriptorSets, inst, sort->histogramPipeline->descriptorLayout) ||
+	   !vkh_desctiptor_sets_generate(sort->scatterDescriptorSets, inst, sort->scatterPipeline->descriptorLayout))
+	{
+		ERROR_LOG("failed to create radix sort descriptor sets");
+		vkh_radix_sort_destroy(sort, inst);
+		return NULL;
+	}
+
+	return sort;
+}
+
+void vkh_radix_sort_destroy(VKHradixSort* sort, VKHinstance* inst)
+{
+	if(sort->scatterDescriptorSets)
+	{
+		vkh_descriptor_sets_cleanup(sort->scatterDescriptorSets, inst);
+		vkh_descriptor_sets_destroy(sort->scatterDescriptorSets);
+	}
+	if(sort->histogramDescriptorSets)
+	{
+		vkh_descriptor_sets_cleanup(sort->histogramDescriptorSets, inst);
+		vkh_descriptor_sets_destroy(sort->histogramDescriptorSets);
+	}
+
+	if(sort->scan)
+		vkh_scan_destroy(sort->scan, inst);
+
+	vkh_destroy_buffer(inst, sort->histograms, &sort->histogramsMemory);
+	vkh_destroy_buffer(inst, sort->tempValues, &sort->tempValuesMemory);
+	vkh_destroy_buffer(inst, sort->tempKeys, &sort->tempKeysMemory);
+	vkh_destroy_buffer(inst, sort->values, &sort->valuesMemory);
+	vkh_destroy_buffer(inst, sort->keys, &sort->keysMemory);
+
+	_vkh_destroy_compute_pass(inst, sort->scatterPipeline);
+	_vkh_destroy_compute_pass(inst, sort->histogramPipeline);
+
+	free(sort);
+}
+
+void vkh_radix_sort_record(VKHradixSort* sort, VkCommandBuffer commandBuffer, uint32_t count, uint32_t keyBits)
+{
+	if(count > sort->maxCount)
+	{
+		ERROR_LOG("radix sort count is larger than the sort was created for");
+		return;
+	}
+
+	if(keyBits % (2 * VKH_RADIX_BITS) != 0 || keyBits > 32)
+	{
+		ERROR_LOG("radix sort key bits must be a multiple of 2 * VKH_RADIX_BITS");
+		return;
+	}
+
+	uint32_t numBlocks = (count + VKH_RADIX_BLOCK_SIZE - 1) / VKH_RADIX_BLOCK_SIZE;
+	if(numBlocks == 0)
+		return;
+
+	//each pass counts the digits of every block, scans the counts into offsets and moves the keys there, every block
+	//in order, so equal digits keep the order of the pass before:
+	for(uint32_t shift = 0; shift < keyBits; shift += VKH_RADIX_BITS)
+	{
+		uint32_t direction = (shift / VKH_RADIX_BITS) % 2;
+		uint32_t pass[3] = {count, shift, numBlocks};
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort->histogramPipeline->pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort->histogramPipeline->layout, 0, 1, &sort->histogramDescriptorSets->sets[direction], 0, NULL);
+		vkCmdPushConstants(commandBuffer, sort->histogramPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pass), pass);
+		vkCmdDispatch(commandBuffer, numBlocks, 1, 1);
+
+		_vkh_record_compute_barrier(commandBuffer);
+		vkh_scan_record(sort->scan, commandBuffer, numBlocks << VKH_RADIX_BITS);
+		_vkh_record_compute_barrier(commandBuffer);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort->scatterPipeline->pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, sort->scatterPipeline->layout, 0, 1, &sort->scatterDescriptorSets->sets[direction], 0, NULL);
+		vkCmdPushConstants(commandBuffer, sort->scatterPipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pass), pass);
+		vkCmdDispatch(commandBuffer, numBlocks, 1, 1);
+
+		if(shift + VKH_RADIX_BITS < keyBits)
+			_vkh_record_compute_barrier(commandBuffer);
+	}
+}
+
+static VKHcomputePipeline* _vkh_create_compute_pass(VKHinstance* inst, const char* shaderDir, const char* name, uint32_t bindingCount, uint32_t pushConstantSize)
+{
+	char path[256];
+	snprintf(path, sizeof(path), "%s/%s", shaderDir, name);
+
+	uint64_t codeSize;
+	uint32_t* code = vkh_load_spirv(path, &codeSize);
+	if(!code)
+		return NULL;
+
+	VKHcomputePipeline* pipeline = vkh_compute_pipeline_create();
+	if(!pipeline)
+	{
+		vkh_free_spirv(code);
+		return NULL;
+	}
+
+	VkShaderModule module = vkh_create_shader_module(inst, codeSize, code);
+	vkh_compute_pipeline_set_shader(pipeline, module);
+
+	//only storage buffers:
+	for(uint32_t i = 0; i < bindingCount; i++)
+	{
+		VkDescriptorSetLayoutBinding binding = {0};
+		binding.binding = i;
+		binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		binding.descriptorCount = 1;
+		binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		binding.pImmutableSamplers = NULL;
+
+		vkh_compute_pipeline_add_desc_set_binding(pipeline, binding);
+	}
+
+	VkPushConstantRange pushConstant = {0};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = pushConstantSize;
+
+	vkh_compute_pipeline_add_push_constant(pipeline, pushConstant);
+
+	vkh_bool_t generated = vkh_compute_pipeline_generate(pipeline, inst);
+
+	vkh_free_spirv(code);
+	vkh_destroy_shader_module(inst, module);
+
+	if(!generated)
+	{
+		vkh_compute_pipeline_destroy(pipeline);
+		return NULL;
+	}
+
+	return pipeline;
+}
+
+static void _vkh_destroy_compute_pass(VKHinstance* inst, VKHcomputePipeline* pipeline)
+{
+	if(!pipeline)
+		return;
+
+	vkh_compute_pipeline_cleanup(pipeline, inst);
+	vkh_compute_pipeline_destroy(pipeline);
+}
+
+static void _vkh_record_compute_barrier(VkCommandBuffer commandBuffer)
+{
+	VkMemoryBarrier barrier = {0};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+	                     1, &barrier, 0, NULL, 0, NULL);
+}
+
+//----------------------------------------------------------------------------//
+
+static vkh_bool_t _vkh_init_glfw(VKHinstance* inst, uint32_t w, uint32_t h, const char* name)
+{
+	MSG_LOG("initlalizing GLFW...");
+
+	if(!glfwInit())
+	{
+		ERROR_LOG("failed to initialize GLFW");
+		return VKH_FALSE;
+	}
+
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+	inst->window = glfwCreateWindow(w, h, name, NULL, NULL);
+	if(!inst->window)
+	{
+		ERROR_LOG("failed to create GLFW window");
+		return VKH_FALSE;
+	}
+
+	return VKH_TRUE;
+}
+
+static void _vkh_quit_glfw(VKHinstance* inst)
+{
+	MSG_LOG("quitting GLFW...");
+
+	glfwDestroyWindow(inst->window);
+	glfwTerminate();
+}
+
+static vkh_bool_t _vkh_create_vk_instance(VKHinstance* inst, const char* name)
+{
+	MSG_LOG("creating Vulkan instance...");
+
+	//get required GLFW extensions:
+	//---------------
+	uint32_t requiredExtensionCount;
+	char** requiredGlfwExtensions = (char**)glfwGetRequiredInstanceExtensions(&requiredExtensionCount);
+	if(!requiredGlfwExtensions)
+	{
+		ERROR_LOG("Vulkan rendering not supported on this machine");
+		return VKH_FALSE;
+	}
+	vkh_bool_t freeExtensionList = VKH_FALSE;
+
+    //reserve space for portability extension
+    //---------------
+#if __APPLE__
+    requiredExtensionCount += 2;
+#endif
+
+    #if VKH_VALIDATION_LAYERS
+    requiredExtensionCount++;
+    #endif
+
+    char** requiredExtensions = (char**)malloc(requiredExtensionCount * sizeof(char*));
+    memcpy(requiredExtensions, requiredGlfwExtensions, requiredExtensionCount * sizeof(char*));
+
+    //set portability extension
+    //---------------
+#if __APPLE__
+    requiredExtensions[requiredExtensionCount - 1] = VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME;
+    requiredExtensions[requiredExtensionCount - 2] = "VK_KHR_get_physical_device_properties2";
+    #if VKH_VALIDATION_LAYERS
+    requiredExtensions[requiredExtensionCount - 3] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+    #endif
+#else
+    requiredExtensions[requiredExtensionCount - 1] = VK_EXT_DEBUG_UTILS_EXTENSION_NAME;
+#endif
+
+	//check if glfw extensions are supported:
+	//---------------
+	uint32_t extensionCount;
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
+	VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(extensionCount * sizeof(VkExtensionProperties));
+	vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, extensions);
+
+	for(uint32_t i = 0; i < requiredExtensionCount; i++)
+	{
+		vkh_bool_t found = VKH_FALSE;
+		for(uint32_t j = 0; j < extensionCount; j++)
+			if(strcmp(requiredExtensions[i], extensions[j].extensionName) == 0)
+			{
+				found = VKH_TRUE;
+				break;
+			}
+		
+		if(!found)
+		{
+			ERROR_LOG("1 or more required GLFW extensions not supported");;
+			return VKH_FALSE;
+		}
+	}
+
+	free(extensions);
+
+	//check if validation layers are supported:
 	//---------------
 	uint32_t requiredLayerCount = 0;
 	const char** requiredLayers;
@@ -1254,7 +2327,7 @@ static vkh_bool_t _vkh_create_vk_instance(VKHinstance* inst, const char* name)
 	appInfo.applicationVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
 	appInfo.pEngineName = "";
 	appInfo.engineVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
-	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 0, 0);
+	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, 1, 0);
 	
 	VkInstanceCreateInfo instanceInfo = {0};
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -1402,35 +2475,14 @@ static vkh_bool_t _vkh_pick_physical_device(VKHinstance* inst)
 		if(graphicsComputeFamilyIdx < 0 || presentFamilyIdx < 0)
 			continue;
 
-		//check if required extensions are supported:
+		//check if vulkan 1.1 is supported (needed for subgroup operations):
 		//---------------
-		vkh_bool_t extensionsSupported = VKH_TRUE;
-
-		uint32_t extensionCount;
-		vkEnumerateDeviceExtensionProperties(devices[i], NULL, &extensionCount, NULL);
-		VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(extensionCount * sizeof(VkExtensionProperties));
-		vkEnumerateDeviceExtensionProperties(devices[i], NULL, &extensionCount, extensions);
-
-		for(uint32_t j = 0; j < REQUIRED_DEVICE_EXTENSION_COUNT; j++)
-		{
-			vkh_bool_t found = VKH_FALSE;
-			for(uint32_t k = 0; k < extensionCount; k++)
-				if(strcmp(REQUIRED_DEVICE_EXTENSIONS[j], extensions[k].extensionName) == 0)
-				{
-					found = VKH_TRUE;
-					break;
-				}
-
-			if(!found)
-			{
-				extensionsSupported = VKH_FALSE;
-				break;
-			}
-		}
-
-		free(extensions);
+		if(properties.apiVersion < VK_API_VERSION_1_1)
+			continue;
 
-		if(!extensionsSupported)
+		//check if required extensions are supported:
+		//---------------
+		if(!_vkh_device_extensions_supported(devices[i], REQUIRED_DEVICE_EXTENSIONS, REQUIRED_DEVICE_EXTENSION_COUNT))
 			continue;
 
 		//check if swapchain is supported:
@@ -1475,6 +2527,36 @@ static vkh_bool_t _vkh_pick_physical_device(VKHinstance* inst)
 	return VKH_TRUE;
 }
 
+static vkh_bool_t _vkh_device_extensions_supported(VkPhysicalDevice device, const char** names, uint32_t count)
+{
+	vkh_bool_t supported = VKH_TRUE;
+
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, NULL);
+	VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(extensionCount * sizeof(VkExtensionProperties));
+	vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, extensions);
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		vkh_bool_t found = VKH_FALSE;
+		for(uint32_t j = 0; j < extensionCount; j++)
+			if(strcmp(names[i], extensions[j].extensionName) == 0)
+			{
+				found = VKH_TRUE;
+				break;
+			}
+
+		if(!found)
+		{
+			supported = VKH_FALSE;
+			break;
+		}
+	}
+
+	free(extensions);
+	return supported;
+}
+
 static vkh_bool_t _vkh_create_device(VKHinstance* inst)
 {
 	MSG_LOG("creating Vulkan device...");
@@ -1511,20 +2593,70 @@ static vkh_bool_t _vkh_create_device(VKHinstance* inst)
 		queueInfos[i] = queueInfo;
 	}
 
-	//set features:
+	//set features, the optional ones are enabled whenever they are supported:
 	//---------------
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(inst->physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures features = {0}; //TODO: allow wanted features to be passed in
 	features.samplerAnisotropy = VK_TRUE;
+	features.largePoints = supportedFeatures.largePoints;
+	features.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	inst->features = features;
+
+	VkPhysicalDeviceFeatures2 features2 = {0};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.features = features;
+
+	//enable mesh shaders if supported (VK_EXT_mesh_shader needs SPIR-V 1.4, which is an extension in Vulkan 1.1):
+	//---------------
+	const char* extensionNames[REQUIRED_DEVICE_EXTENSION_COUNT + VKH_MESH_SHADER_EXTENSION_COUNT];
+	uint32_t extensionNameCount = 0;
+	for(uint32_t i = 0; i < REQUIRED_DEVICE_EXTENSION_COUNT; i++)
+		extensionNames[extensionNameCount++] = REQUIRED_DEVICE_EXTENSIONS[i];
+
+	inst->meshShaderSupported = VKH_FALSE;
+	inst->drawMeshTasksIndirect = NULL;
+
+#ifdef VK_EXT_mesh_shader
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshFeatures = {0};
+	meshFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+	if(_vkh_device_extensions_supported(inst->physicalDevice, VKH_MESH_SHADER_EXTENSIONS, VKH_MESH_SHADER_EXTENSION_COUNT))
+	{
+		VkPhysicalDeviceFeatures2 queryFeatures = {0};
+		queryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		queryFeatures.pNext = &meshFeatures;
+		vkGetPhysicalDeviceFeatures2(inst->physicalDevice, &queryFeatures);
+
+		if(meshFeatures.meshShader)
+		{
+			//only the features that are used, the others have requirements of their own:
+			meshFeatures.pNext = NULL;
+			meshFeatures.taskShader = VK_FALSE;
+			meshFeatures.multiviewMeshShader = VK_FALSE;
+			meshFeatures.primitiveFragmentShadingRateMeshShader = VK_FALSE;
+			meshFeatures.meshShaderQueries = VK_FALSE;
+			features2.pNext = &meshFeatures;
+
+			for(uint32_t i = 0; i < VKH_MESH_SHADER_EXTENSION_COUNT; i++)
+				extensionNames[extensionNameCount++] = VKH_MESH_SHADER_EXTENSIONS[i];
+
+			inst->meshShaderSupported = VKH_TRUE;
+		}
+	}
+#endif
 
 	//create device:
 	//---------------
 	VkDeviceCreateInfo deviceInfo = {0};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = &features2;
 	deviceInfo.queueCreateInfoCount = queueCount;
 	deviceInfo.pQueueCreateInfos = queueInfos;
-	deviceInfo.pEnabledFeatures = &features;
-	deviceInfo.enabledExtensionCount = REQUIRED_DEVICE_EXTENSION_COUNT;
-	deviceInfo.ppEnabledExtensionNames = REQUIRED_DEVICE_EXTENSIONS;
+	deviceInfo.pEnabledFeatures = NULL; //in features2
+	deviceInfo.enabledExtensionCount = extensionNameCount;
+	deviceInfo.ppEnabledExtensionNames = extensionNames;
 	#if VKH_VALIDATION_LAYERS
 	{
 		deviceInfo.enabledLayerCount = REQUIRED_LAYER_COUNT;
@@ -1542,6 +2674,13 @@ static vkh_bool_t _vkh_create_device(VKHinstance* inst)
 	vkGetDeviceQueue(inst->device, inst->graphicsComputeFamilyIdx, 0, &inst->computeQueue);
 	vkGetDeviceQueue(inst->device, inst->presentFamilyIdx, 0, &inst->presentQueue);
 
+	if(inst->meshShaderSupported)
+	{
+		inst->drawMeshTasksIndirect = vkGetDeviceProcAddr(inst->device, "vkCmdDrawMeshTasksIndirectEXT");
+		if(!inst->drawMeshTasksIndirect)
+			inst->meshShaderSupported = VKH_FALSE;
+	}
+
 	return VKH_TRUE;
 }
 
@@ -1552,7 +2691,7 @@ static void _vkh_destroy_vk_device(VKHinstance* inst)
 	vkDestroyDevice(inst->device, NULL);
 }
 
-static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t h)
+static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t h, VkSwapchainKHR oldSwapchain)
 {
 	MSG_LOG("creating Vulkan swapchain...");
 
@@ -1578,11 +2717,15 @@ static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t
 	VkPresentModeKHR* supportedPresentModes = (VkPresentModeKHR*)malloc(presentModeCount * sizeof(VkPresentModeKHR));
 	vkGetPhysicalDeviceSurfacePresentModesKHR(inst->physicalDevice, inst->surface, &presentModeCount, supportedPresentModes);
 	
-	VkPresentModeKHR presentMode = supportedPresentModes[0];
+	//FIFO is the only mode every surface has to support:
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
 	for(uint32_t i = 0; i < presentModeCount; i++)
-		if(supportedPresentModes[i] == VK_PRESENT_MODE_MAILBOX_KHR)
+		if(supportedPresentModes[i] == inst->requestedPresentMode)
 			presentMode = supportedPresentModes[i];
 
+	if(presentMode != inst->requestedPresentMode)
+		MSG_LOG("requested present mode is unsupported, falling back to FIFO");
+
 	free(supportedPresentModes);
 
 	//get extent:
@@ -1610,7 +2753,9 @@ static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t
 
 	//get image count:
 	//---------------
-	uint32_t imageCount = capabilities.minImageCount + 1;
+	uint32_t imageCount = inst->requestedImageCount > 0 ? inst->requestedImageCount : capabilities.minImageCount + 1;
+	if(imageCount < capabilities.minImageCount)
+		imageCount = capabilities.minImageCount;
 	if(capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount)
 		imageCount = capabilities.maxImageCount;
 	
@@ -1629,7 +2774,7 @@ static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t
 	swapchainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	swapchainInfo.presentMode = presentMode;
 	swapchainInfo.clipped = VK_TRUE;
-	swapchainInfo.oldSwapchain = VK_NULL_HANDLE;
+	swapchainInfo.oldSwapchain = oldSwapchain;
 
 	uint32_t indices[] = {inst->graphicsComputeFamilyIdx, inst->presentFamilyIdx};
 
@@ -1650,6 +2795,7 @@ static vkh_bool_t _vkh_create_swapchain(VKHinstance* inst, uint32_t w, uint32_t
 
 	inst->swapchainExtent = extent;
 	inst->swapchainFormat = format.format;
+	inst->swapchainPresentMode = presentMode;
 
 	vkGetSwapchainImagesKHR(inst->device, inst->swapchain, &inst->swapchainImageCount, NULL);
 	inst->swapchainImages     =     (VkImage*)malloc(inst->swapchainImageCount * sizeof(VkImage));
@@ -1702,19 +2848,169 @@ static void _vkh_destroy_command_pool(VKHinstance* inst)
 
 //----------------------------------------------------------------------------//
 
-static uint32_t _vkh_find_memory_type(VKHinstance* inst, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+static vkh_bool_t _vkh_create_memory_pools(VKHinstance* inst)
+{
+	MSG_LOG("creating memory pools...");
+
+	//cache device properties, these are queried for every allocation:
+	vkGetPhysicalDeviceProperties(inst->physicalDevice, &inst->properties);
+	vkGetPhysicalDeviceMemoryProperties(inst->physicalDevice, &inst->memProperties);
+
+	//subgroup support is only reported through the vulkan 1.1 query:
+	inst->subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+	inst->subgroupProperties.pNext = NULL;
+
+	VkPhysicalDeviceProperties2 properties2;
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &inst->subgroupProperties;
+	vkGetPhysicalDeviceProperties2(inst->physicalDevice, &properties2);
+
+	//blocks are only created once memory of that type is requested:
+	memset(inst->memoryPools, 0, sizeof(inst->memoryPools));
+
+	return VKH_TRUE;
+}
+
+static void _vkh_destroy_memory_pools(VKHinstance* inst)
 {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(inst->physicalDevice, &memProperties);
+	MSG_LOG("destroying memory pools...");
+
+	for(uint32_t i = 0; i < inst->memProperties.memoryTypeCount; i++)
+	{
+		VKHmemoryPool* pool = &inst->memoryPools[i];
+
+		if(pool->dedicatedCount > 0)
+			ERROR_LOG("dedicated allocations were not freed");
+
+		VKHmemoryBlock* block = pool->blocks;
+		while(block)
+		{
+			if(block->allocCount > 0)
+				ERROR_LOG("memory block still has live allocations");
 
-	for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		if((typeFilter & (1 << i)) && ((memProperties.memoryTypes[i].propertyFlags & properties) == properties))
+			VKHmemoryBlock* next = block->next;
+			_vkh_memory_block_destroy(inst, block);
+			block = next;
+		}
+
+		pool->blocks = NULL;
+	}
+}
+
+//----------------------------------------------------------------------------//
+
+static uint32_t _vkh_find_memory_type(VKHinstance* inst, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+	for(uint32_t i = 0; i < inst->memProperties.memoryTypeCount; i++)
+		if((typeFilter & (1 << i)) && ((inst->memProperties.memoryTypes[i].propertyFlags & properties) == properties))
 			return i;
 	
 	ERROR_LOG("failed to find a suitable memory type");
 	return UINT32_MAX;
 }
 
+static VKHmemoryBlock* _vkh_memory_block_create(VKHinstance* inst, uint32_t memoryType, vkh_bool_t optimal)
+{
+	VKHmemoryBlock* block = (VKHmemoryBlock*)malloc(sizeof(VKHmemoryBlock));
+	if(!block)
+		return NULL;
+
+	//allocate memory:
+	//---------------
+	VkMemoryAllocateInfo allocInfo = {0};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = VKH_MEMORY_BLOCK_SIZE;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	if(vkAllocateMemory(inst->device, &allocInfo, NULL, &block->memory) != VK_SUCCESS)
+	{
+		free(block);
+		return NULL;
+	}
+
+	block->mapped = NULL;
+	if(inst->memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if(vkMapMemory(inst->device, block->memory, 0, VK_WHOLE_SIZE, 0, (void**)&block->mapped) != VK_SUCCESS)
+			ERROR_LOG("failed to map memory block");
+	}
+
+	//initialize buddy tree, every node starts out fully free:
+	//---------------
+	block->longest = (uint8_t*)malloc((2ull << VKH_MEMORY_MAX_ORDER) - 1);
+	if(!block->longest)
+	{
+		vkFreeMemory(inst->device, block->memory, NULL);
+		free(block);
+		return NULL;
+	}
+
+	for(uint32_t depth = 0; depth <= VKH_MEMORY_MAX_ORDER; depth++)
+		memset(block->longest + (1ull << depth) - 1, VKH_MEMORY_MAX_ORDER - depth + 1, 1ull << depth);
+
+	block->optimal = optimal;
+	block->allocCount = 0;
+	block->used = 0;
+	block->next = NULL;
+
+	return block;
+}
+
+static void _vkh_memory_block_destroy(VKHinstance* inst, VKHmemoryBlock* block)
+{
+	if(block->mapped)
+		vkUnmapMemory(inst->device, block->memory);
+	vkFreeMemory(inst->device, block->memory, NULL);
+
+	free(block->longest);
+	free(block);
+}
+
+static void _vkh_memory_block_update_parents(VKHmemoryBlock* block, uint64_t node, uint32_t order)
+{
+	while(node > 0)
+	{
+		node = (node - 1) / 2;
+		order++;
+
+		uint8_t left = block->longest[2 * node + 1];
+		uint8_t right = block->longest[2 * node + 2];
+
+		//merge buddies if both halves are completely free:
+		if(left == order && right == order)
+			block->longest[node] = (uint8_t)(order + 1);
+		else
+			block->longest[node] = left > right ? left : right;
+	}
+}
+
+static vkh_bool_t _vkh_memory_block_alloc(VKHmemoryBlock* block, uint32_t order, VkDeviceSize* offset)
+{
+	if(block->longest[0] < order + 1)
+		return VKH_FALSE;
+
+	//descend to a free node of the requested order, preferring the left child to keep the low end packed:
+	uint64_t node = 0;
+	for(uint32_t nodeOrder = VKH_MEMORY_MAX_ORDER; nodeOrder > order; nodeOrder--)
+		node = block->longest[2 * node + 1] >= order + 1 ? 2 * node + 1 : 2 * node + 2;
+
+	block->longest[node] = 0;
+	_vkh_memory_block_update_parents(block, node, order);
+
+	uint64_t firstAtDepth = (1ull << (VKH_MEMORY_MAX_ORDER - order)) - 1;
+	*offset = (node - firstAtDepth) * (VKH_MEMORY_LEAF_SIZE << order);
+	return VKH_TRUE;
+}
+
+static void _vkh_memory_block_free(VKHmemoryBlock* block, VkDeviceSize offset, uint32_t order)
+{
+	uint64_t firstAtDepth = (1ull << (VKH_MEMORY_MAX_ORDER - order)) - 1;
+	uint64_t node = firstAtDepth + offset / (VKH_MEMORY_LEAF_SIZE << order);
+
+	block->longest[node] = (uint8_t)(order + 1);
+	_vkh_memory_block_update_parents(block, node, order);
+}
+
 //----------------------------------------------------------------------------//
 
 static VKAPI_ATTR VkBool32 _vkh_vk_debug_callback(
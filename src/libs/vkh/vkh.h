@@ -20,6 +20,59 @@ typedef int32_t vkh_bool_t;
 #define VKH_TRUE  1
 #define VKH_FALSE 0
 
+#define VKH_MEMORY_BLOCK_SIZE (64ull * 1024 * 1024)
+#define VKH_MEMORY_LEAF_SIZE 256ull
+#define VKH_MEMORY_MAX_ORDER 18 //log2(VKH_MEMORY_BLOCK_SIZE / VKH_MEMORY_LEAF_SIZE)
+
+//----------------------------------------------------------------------------//
+
+typedef struct VKHmemoryBlock
+{
+	VkDeviceMemory memory;
+	uint8_t* mapped; //NULL if not host visible
+
+	vkh_bool_t optimal;  //whether the block holds optimally tiled images, only used if bufferImageGranularity > leaf size
+	uint32_t allocCount;
+	VkDeviceSize used;
+
+	//buddy tree, each node stores (order + 1) of the largest free node in its subtree, 0 if there is none:
+	uint8_t* longest;
+
+	struct VKHmemoryBlock* next;
+} VKHmemoryBlock;
+
+typedef struct VKHmemoryPool
+{
+	VKHmemoryBlock* blocks;
+
+	uint32_t dedicatedCount;
+	VkDeviceSize dedicatedSize;
+} VKHmemoryPool;
+
+typedef struct VKHallocation
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint8_t* mapped; //NULL if not host visible
+
+	uint32_t memoryType;
+	VKHmemoryBlock* block; //NULL for dedicated allocations
+} VKHallocation;
+
+typedef struct VKHmemoryHeapStats
+{
+	uint32_t blockCount;
+	uint32_t allocationCount;
+
+	VkDeviceSize allocatedBytes; //total memory allocated from the driver
+	VkDeviceSize usedBytes;
+	VkDeviceSize freeBytes;
+	VkDeviceSize largestFreeRange;
+
+	float fragmentation; //1 - largestFreeRange / freeBytes
+} VKHmemoryHeapStats;
+
 typedef struct VKHinstance
 {
 	GLFWwindow* window;
@@ -38,12 +91,24 @@ typedef struct VKHinstance
 	VkSwapchainKHR swapchain;
 	VkFormat swapchainFormat;
 	VkExtent2D swapchainExtent;
+	VkPresentModeKHR swapchainPresentMode; //the mode in use, FIFO if the requested one is unsupported
 	uint32_t swapchainImageCount;
+
+	VkPresentModeKHR requestedPresentMode; //see vkh_init, kept for recreating the swapchain
+	uint32_t requestedImageCount;
 	VkImage* swapchainImages;
 	VkImageView* swapchainImageViews;
 
 	VkCommandPool commandPool;
 
+	VkPhysicalDeviceProperties properties;
+	VkPhysicalDeviceSubgroupProperties subgroupProperties;
+	VkPhysicalDeviceFeatures features; //the optional features that are supported are enabled, see _vkh_create_device
+	vkh_bool_t meshShaderSupported; //VK_EXT_mesh_shader is enabled, with mesh (not task) shaders
+	PFN_vkVoidFunction drawMeshTasksIndirect; //vkCmdDrawMeshTasksIndirectEXT, NULL if mesh shaders are unsupported
+	VkPhysicalDeviceMemoryProperties memProperties;
+	VKHmemoryPool memoryPools[VK_MAX_MEMORY_TYPES];
+
 	#if VKH_VALIDATION_LAYERS
 		VkDebugUtilsMessengerEXT debugMessenger;
 	#endif
@@ -64,6 +129,11 @@ typedef struct VKHgraphicsPipeline
 
 	VkShaderModule vertShader;
 	VkShaderModule fragShader;
+	VkShaderModule meshShader; //replaces the vertex shader and the vertex input, see vkh_pipeline_set_mesh_shader
+
+	const VkSpecializationInfo* vertSpecialization;
+	const VkSpecializationInfo* fragSpecialization;
+	const VkSpecializationInfo* meshSpecialization;
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState;
 	VkPipelineTessellationStateCreateInfo tesselationState;
@@ -134,32 +204,170 @@ typedef struct VKHdescriptorSets
 	VkDescriptorSet* sets;
 } VKHdescriptorSets;
 
+typedef struct VKHuniformRing
+{
+	VkBuffer buffer;
+	VKHallocation allocation;
+	uint8_t* mapped;
+
+	VkDeviceSize alignment;
+	VkDeviceSize frameSize;
+	uint32_t frameCount;
+
+	VkDeviceSize frameStart;
+	VkDeviceSize head;
+} VKHuniformRing;
+
+#define VKH_UNIFORM_RING_FULL UINT32_MAX //returned by vkh_uniform_ring_push(), must never be bound as an offset
+
+#define VKH_UPLOAD_BATCH_COUNT 3
+#define VKH_UPLOAD_ALIGNMENT 16
+
+typedef enum VKHuploadBatchState
+{
+	VKH_UPLOAD_BATCH_IDLE,
+	VKH_UPLOAD_BATCH_RECORDING,
+	VKH_UPLOAD_BATCH_PENDING
+} VKHuploadBatchState;
+
+typedef struct VKHuploadBatch
+{
+	VkCommandBuffer commandBuffer;
+	VkFence fence;
+	VKHuploadBatchState state;
+
+	VkDeviceSize stagingStart; //first byte of the staging ring used by this batch, in unwrapped ring offsets
+} VKHuploadBatch;
+
+typedef struct VKHuploadContext
+{
+	VkBuffer stagingBuffer;
+	VKHallocation stagingAllocation;
+	uint8_t* stagingMapped;
+	VkDeviceSize stagingSize;
+
+	VkDeviceSize head; //unwrapped, the physical offset is head % stagingSize
+
+	VkCommandPool commandPool;
+	uint32_t curBatch;
+	VKHuploadBatch batches[VKH_UPLOAD_BATCH_COUNT];
+} VKHuploadContext;
+
+#define VKH_SCAN_BLOCK_SIZE 1024 //elements per workgroup, mirrors scan.comp
+#define VKH_SCAN_MAX_COUNT (VKH_SCAN_BLOCK_SIZE * VKH_SCAN_BLOCK_SIZE) //2 levels of blocks
+
+typedef struct VKHscan
+{
+	VKHcomputePipeline* blockPipeline; //scans each block, writing the block's total
+	VKHcomputePipeline* addPipeline;   //adds the scanned totals of the blocks before
+
+	uint32_t maxCount;
+
+	VkBuffer blockSums; //1 per block, followed by the grand total
+	VKHallocation blockSumsMemory;
+
+	VKHdescriptorSets* descriptorSets; //0: data -> block sums, 1: block sums -> total
+} VKHscan;
+
+#define VKH_RADIX_BITS 4 //per pass
+#define VKH_RADIX_BLOCK_SIZE 4096 //keys per workgroup, mirrors radix_histogram.comp and radix_scatter.comp
+
+typedef struct VKHradixSort
+{
+	VKHcomputePipeline* histogramPipeline;
+	VKHcomputePipeline* scatterPipeline;
+	VKHscan* scan; //turns the histograms into each block's output offsets
+
+	uint32_t maxCount;
+
+	//keys and values are written by the caller and sorted in place, the temporary buffers are ping-ponged with them:
+	VkBuffer keys;
+	VKHallocation keysMemory;
+	VkBuffer values;
+	VKHallocation valuesMemory;
+
+	VkBuffer tempKeys;
+	VKHallocation tempKeysMemory;
+	VkBuffer tempValues;
+	VKHallocation tempValuesMemory;
+
+	VkBuffer histograms; //digit-major, so scanning them orders the keys by digit, then by block
+	VKHallocation histogramsMemory;
+
+	VKHdescriptorSets* histogramDescriptorSets; //0: keys, 1: temp keys
+	VKHdescriptorSets* scatterDescriptorSets;   //0: keys -> temp, 1: temp -> keys
+} VKHradixSort;
+
+typedef enum VKHretiredType
+{
+	VKH_RETIRED_IMAGE,
+	VKH_RETIRED_IMAGE_VIEW,
+	VKH_RETIRED_FRAMEBUFFER,
+	VKH_RETIRED_BUFFER,
+	VKH_RETIRED_DESCRIPTOR_SETS,
+	VKH_RETIRED_SCAN,
+	VKH_RETIRED_SWAPCHAIN
+} VKHretiredType;
+
+typedef struct VKHretiredObject
+{
+	VKHretiredType type;
+	uint64_t frame; //of the queue when it was retired
+
+	union
+	{
+		VkImage image;
+		VkImageView imageView;
+		VkFramebuffer framebuffer;
+		VkBuffer buffer;
+		VKHdescriptorSets* descriptorSets;
+		VKHscan* scan;
+		VkSwapchainKHR swapchain;
+	};
+	VKHallocation allocation; //images and buffers only
+} VKHretiredObject;
+
+typedef struct VKHdeletionQueue
+{
+	QDdynArray* objects; //type - VKHretiredObject, in the order they were retired
+	uint64_t frame;
+	uint32_t delay;
+} VKHdeletionQueue;
+
 //----------------------------------------------------------------------------//
 
-vkh_bool_t vkh_init(VKHinstance** instance, uint32_t windowW, uint32_t windowH, const char* windowName);
+//NOTE: imageCount is clamped to what the surface supports, 0 requests 1 more than its minimum
+vkh_bool_t vkh_init(VKHinstance** instance, uint32_t windowW, uint32_t windowH, const char* windowName,
+                    VkPresentModeKHR presentMode, uint32_t imageCount);
 void       vkh_quit(VKHinstance* instance);
 
-void vkh_resize_swapchain(VKHinstance* instance, uint32_t w, uint32_t h);
+void vkh_resize_swapchain(VKHinstance* instance, uint32_t w, uint32_t h); //waits for the device to be idle
+
+//NOTE: the new swapchain replaces the old one, which (with its image views) is retired into the queue instead of being
+//      destroyed, so frames still in flight can finish with it. returns false if no new swapchain could be created,
+//      the old one is retired either way
+vkh_bool_t vkh_recreate_swapchain(VKHinstance* instance, uint32_t w, uint32_t h, VKHdeletionQueue* queue);
 
 //----------------------------------------------------------------------------//
 
-VkImage     vkh_create_image                  (VKHinstance* instance, uint32_t w, uint32_t h, uint32_t mipLevels, VkSampleCountFlagBits samples, 
-                                               VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory* memory);
-void        vkh_destroy_image                 (VKHinstance* instance, VkImage image, VkDeviceMemory memory);
+//NOTE: requests larger than half a block get their own VkDeviceMemory, everything else is sub-allocated,
+//      host visible memory is persistently mapped so allocation->mapped can be written directly
+vkh_bool_t vkh_allocate_memory(VKHinstance* instance, VkMemoryRequirements requirements, VkMemoryPropertyFlags properties, vkh_bool_t optimal, VKHallocation* allocation);
+void       vkh_free_memory    (VKHinstance* instance, VKHallocation* allocation);
 
-VkImageView vkh_create_image_view             (VKHinstance* instance, VkImage image, VkFormat format, VkImageAspectFlags aspects, uint32_t mipLevels);
-void        vkh_destroy_image_view            (VKHinstance* instance, VkImageView view);
+uint32_t   vkh_get_memory_stats(VKHinstance* instance, VKHmemoryHeapStats* stats); //stats must hold VK_MAX_MEMORY_HEAPS entries, returns the heap count
 
-VkBuffer    vkh_create_buffer                 (VKHinstance* instance, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory* memory);
-void        vkh_destroy_buffer                (VKHinstance* instance, VkBuffer buffer, VkDeviceMemory memory);
+//----------------------------------------------------------------------------//
 
-void        vkh_copy_buffer                   (VKHinstance* instance, VkBuffer src, VkBuffer dst, VkDeviceSize size, uint64_t srcOffset, uint64_t dstOffset);
-void        vkh_copy_buffer_to_image          (VKHinstance* instance, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+VkImage     vkh_create_image                  (VKHinstance* instance, uint32_t w, uint32_t h, uint32_t mipLevels, VkSampleCountFlagBits samples, 
+                                               VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VKHallocation* allocation);
+void        vkh_destroy_image                 (VKHinstance* instance, VkImage image, VKHallocation* allocation);
 
-void        vkh_copy_with_staging_buf         (VKHinstance* instance, VkBuffer stagingBuf, VkDeviceMemory stagingBufMem, VkBuffer buf, uint64_t size, uint64_t offset, void* data);
-void        vkh_copy_with_staging_buf_implicit(VKHinstance* instance, VkBuffer buf, uint64_t size, uint64_t offset, void* data);
+VkImageView vkh_create_image_view             (VKHinstance* instance, VkImage image, VkFormat format, VkImageAspectFlags aspects, uint32_t mipLevels);
+void        vkh_destroy_image_view            (VKHinstance* instance, VkImageView view);
 
-void        vkh_transition_image_layout       (VKHinstance* instance, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+VkBuffer    vkh_create_buffer                 (VKHinstance* instance, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VKHallocation* allocation);
+void        vkh_destroy_buffer                (VKHinstance* instance, VkBuffer buffer, VKHallocation* allocation);
 
 //----------------------------------------------------------------------------//
 
@@ -171,13 +379,14 @@ void           vkh_destroy_shader_module(VKHinstance* instance, VkShaderModule m
 
 //----------------------------------------------------------------------------//
 
-VkCommandBuffer vkh_start_single_time_command(VKHinstance* inst);
-void            vkh_end_single_time_command  (VKHinstance* inst, VkCommandBuffer commandBuffer);
+//vkCmdDrawMeshTasksIndirectEXT, which is not exported by the loader. only if instance->meshShaderSupported
+void            vkh_cmd_draw_mesh_tasks_indirect(VKHinstance* inst, VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset,
+                                                 uint32_t drawCount, uint32_t stride);
 
 //----------------------------------------------------------------------------//
 
 //NOTE: only supports 1 desciptor layout, FIXME
-//NOTE: only supports vert/frag shaders, FIXME
+//NOTE: only supports vert/frag and mesh/frag shaders, FIXME
 VKHgraphicsPipeline* vkh_pipeline_create    ();
 void                 vkh_pipeline_destroy   (VKHgraphicsPipeline* pipeline);
 
@@ -195,6 +404,10 @@ void vkh_pipeline_add_push_constant         (VKHgraphicsPipeline* pipeline, VkPu
 
 void vkh_pipeline_set_vert_shader           (VKHgraphicsPipeline* pipeline, VkShaderModule shader);
 void vkh_pipeline_set_frag_shader           (VKHgraphicsPipeline* pipeline, VkShaderModule shader);
+void vkh_pipeline_set_mesh_shader           (VKHgraphicsPipeline* pipeline, VkShaderModule shader); //only if instance->meshShaderSupported
+
+//NOTE: info must stay valid until vkh_pipeline_generate(), stage is VK_SHADER_STAGE_VERTEX_BIT, _FRAGMENT_BIT or _MESH_BIT_EXT
+void vkh_pipeline_set_specialization        (VKHgraphicsPipeline* pipeline, VkShaderStageFlagBits stage, const VkSpecializationInfo* info);
 
 void vkh_pipeline_set_input_assembly_state  (VKHgraphicsPipeline* pipeline, VkPrimitiveTopology topology, VkBool32 primitiveRestart);
 void vkh_pipeline_set_tesselation_state     (VKHgraphicsPipeline* pipeline, uint32_t patchControlPoints);
@@ -237,6 +450,71 @@ void               vkh_descriptor_sets_add_texel_views(VKHdescriptorSets* descri
 
 //----------------------------------------------------------------------------//
 
+//NOTE: the ring is split into 1 region per frame in flight, only call vkh_uniform_ring_begin_frame() once the
+//      frame that last used the region has finished executing (i.e. after waiting on its fence)
+VKHuniformRing* vkh_uniform_ring_create     (VKHinstance* instance, VkDeviceSize frameSize, uint32_t frameCount);
+void            vkh_uniform_ring_destroy    (VKHuniformRing* ring, VKHinstance* instance);
+
+void            vkh_uniform_ring_begin_frame(VKHuniformRing* ring, uint32_t frameIdx);
+uint32_t        vkh_uniform_ring_push       (VKHuniformRing* ring, VkDeviceSize size, const void* data); //returns the dynamic offset to bind with, or VKH_UNIFORM_RING_FULL
+
+//----------------------------------------------------------------------------//
+
+//NOTE: uploads are gathered into a batch command buffer and only submitted on vkh_upload_flush(), every batch ends
+//      with a barrier making the transfers visible to all later submissions on the graphics queue, so only call
+//      vkh_upload_wait() when the host needs the results (e.g. before destroying resources the batch references)
+//NOTE: uploads flush the current batch on their own when the staging ring is full, so a command buffer returned by
+//      vkh_upload_command_buffer() is only valid until the next upload call, fetch it again after every upload
+VKHuploadContext* vkh_upload_context_create  (VKHinstance* instance, VkDeviceSize stagingSize);
+void              vkh_upload_context_destroy (VKHuploadContext* context, VKHinstance* instance);
+
+void              vkh_upload_buffer          (VKHuploadContext* context, VKHinstance* instance, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const void* data);
+void              vkh_upload_buffer_to_image (VKHuploadContext* context, VKHinstance* instance, VkImage image, uint32_t width, uint32_t height, VkDeviceSize size, const void* data);
+void              vkh_upload_transition_image(VKHuploadContext* context, VKHinstance* instance, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+
+VkCommandBuffer   vkh_upload_command_buffer  (VKHuploadContext* context, VKHinstance* instance); //for recording extra work (e.g. compute) into the current batch
+
+void              vkh_upload_flush           (VKHuploadContext* context, VKHinstance* instance);
+void              vkh_upload_wait            (VKHuploadContext* context, VKHinstance* instance);
+
+//----------------------------------------------------------------------------//
+
+//NOTE: retired objects are destroyed delay frames after they are retired, call vkh_deletion_queue_next_frame() once
+//      per frame after waiting on the fence of the frame delay - 1 frames before it. vkh_deletion_queue_flush() destroys
+//      everything, only call it once the device is idle. null handles are ignored, so partially created objects can
+//      be retired as they are
+VKHdeletionQueue* vkh_deletion_queue_create    (uint32_t delay);
+void              vkh_deletion_queue_destroy   (VKHdeletionQueue* queue, VKHinstance* instance); //flushes first
+
+void              vkh_deletion_queue_next_frame(VKHdeletionQueue* queue, VKHinstance* instance);
+void              vkh_deletion_queue_flush     (VKHdeletionQueue* queue, VKHinstance* instance);
+
+void              vkh_retire_image             (VKHdeletionQueue* queue, VkImage image, VKHallocation* allocation);
+void              vkh_retire_image_view        (VKHdeletionQueue* queue, VkImageView view);
+void              vkh_retire_framebuffer       (VKHdeletionQueue* queue, VkFramebuffer framebuffer);
+void              vkh_retire_buffer            (VKHdeletionQueue* queue, VkBuffer buffer, VKHallocation* allocation);
+void              vkh_retire_descriptor_sets   (VKHdeletionQueue* queue, VKHdescriptorSets* descriptorSets);
+void              vkh_retire_scan              (VKHdeletionQueue* queue, VKHscan* scan);
+
+//----------------------------------------------------------------------------//
+
+//NOTE: compute building blocks, their shaders are loaded from shaderDir. the passes are recorded into the caller's
+//      command buffer with barriers between them, the caller orders its own writes of the input before and its reads
+//      of the results after with compute shader barriers
+
+//exclusive prefix sum of data[0, count) in place, count at most maxCount (up to VKH_SCAN_MAX_COUNT)
+VKHscan*      vkh_scan_create       (VKHinstance* instance, VkBuffer data, uint32_t maxCount, const char* shaderDir);
+void          vkh_scan_destroy      (VKHscan* scan, VKHinstance* instance);
+void          vkh_scan_record       (VKHscan* scan, VkCommandBuffer commandBuffer, uint32_t count);
+
+//stable LSD radix sort of sort->keys[0, count) by their lowest keyBits bits (a multiple of 2 * VKH_RADIX_BITS, so the
+//result ends up back in sort->keys), sort->values are moved along with them
+VKHradixSort* vkh_radix_sort_create (VKHinstance* instance, uint32_t maxCount, const char* shaderDir);
+void          vkh_radix_sort_destroy(VKHradixSort* sort, VKHinstance* instance);
+void          vkh_radix_sort_record (VKHradixSort* sort, VkCommandBuffer commandBuffer, uint32_t count, uint32_t keyBits);
+
+//----------------------------------------------------------------------------//
+
 #ifdef __cplusplus
 } //extern "C"
 #endif
@@ -3,11 +3,23 @@
 
 #include <iostream>
 #include "game.hpp"
+#include "config.hpp"
+#include "galaxy_cpu.hpp"
 
-int main()
+int main(int argc, char** argv)
 {
+	Config config;
+	if (!config_parse(&config, argc, argv))
+		return -1;
+
+	if (config.benchCpuGen)
+	{
+		ParticleGenParamsGPU params = draw_default_gen_params(config.numStars, config.seed);
+		return galaxy_cpu_benchmark(&params, config.numParticles) ? 0 : -1;
+	}
+
 	GameState* state;
-	if (!game_init(&state))
+	if (!game_init(&state, &config))
 		return -1;
 
 	game_main_loop(state);
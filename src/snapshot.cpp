@@ -0,0 +1,220 @@
+#include "snapshot.hpp"
+#include <stdlib.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <direct.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------//
+
+static bool _snapshot_map(const char* path, SnapshotFile* file);
+static void _snapshot_unmap(SnapshotFile* file);
+
+//----------------------------------------------------------------------------//
+
+static void _snapshot_error_log(const char* message, const char* file, int32 line);
+#define ERROR_LOG(m) _snapshot_error_log(m, __FILENAME__, __LINE__)
+
+//----------------------------------------------------------------------------//
+
+uint64 snapshot_hash(uint64 hash, const void* data, uint64 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for(uint64 i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull; //FNV-1a 64-bit prime
+	}
+
+	return hash;
+}
+
+void snapshot_path(uint64 key, char* path, uint32 maxLen)
+{
+	snprintf(path, maxLen, "%s/galaxy_%016llx.bin", SNAPSHOT_DIR, (unsigned long long)key);
+}
+
+bool snapshot_open(const char* path, uint64 key, uint32 numParticles, uint32 particleSize, SnapshotFile* file)
+{
+	if(!_snapshot_map(path, file))
+		return false;
+
+	//validate, a mismatch means a hash collision, a different format version, or a damaged file:
+	//---------------
+	bool valid = file->size >= sizeof(SnapshotHeader);
+	if(valid)
+	{
+		file->header = (const SnapshotHeader*)file->base;
+		file->data = (const uint8*)file->base + sizeof(SnapshotHeader);
+
+		valid = file->header->magic == SNAPSHOT_MAGIC && file->header->version == SNAPSHOT_VERSION &&
+		        file->header->key == key && file->header->numParticles == numParticles && file->header->particleSize == particleSize &&
+		        file->size == sizeof(SnapshotHeader) + (uint64)numParticles * particleSize;
+	}
+
+	if(!valid)
+	{
+		ERROR_LOG("snapshot file does not match, ignoring it");
+		_snapshot_unmap(file);
+		return false;
+	}
+
+	return true;
+}
+
+void snapshot_close(SnapshotFile* file)
+{
+	_snapshot_unmap(file);
+}
+
+bool snapshot_write_begin(SnapshotWriter* writer, const char* path, uint64 key, uint32 numParticles, uint32 particleSize)
+{
+#ifdef _WIN32
+	_mkdir(SNAPSHOT_DIR);
+#else
+	mkdir(SNAPSHOT_DIR, 0755);
+#endif
+
+	snprintf(writer->path, sizeof(writer->path), "%s", path);
+	snprintf(writer->tempPath, sizeof(writer->tempPath), "%s.tmp", path);
+	writer->failed = false;
+
+	writer->file = fopen(writer->tempPath, "wb");
+	if(!writer->file)
+	{
+		ERROR_LOG("failed to open snapshot file for writing");
+		return false;
+	}
+
+	SnapshotHeader header;
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.key = key;
+	header.numParticles = numParticles;
+	header.particleSize = particleSize;
+	snapshot_write(writer, &header, sizeof(SnapshotHeader));
+
+	return true;
+}
+
+void snapshot_write(SnapshotWriter* writer, const void* data, uint64 size)
+{
+	if(!writer->failed && fwrite(data, 1, size, writer->file) != size)
+		writer->failed = true;
+}
+
+bool snapshot_write_end(SnapshotWriter* writer)
+{
+	if(fclose(writer->file) != 0)
+		writer->failed = true;
+
+	if(writer->failed)
+	{
+		ERROR_LOG("failed to write snapshot file");
+		remove(writer->tempPath);
+		return false;
+	}
+
+	remove(writer->path); //rename does not replace existing files on windows
+	if(rename(writer->tempPath, writer->path) != 0)
+	{
+		ERROR_LOG("failed to rename snapshot file");
+		remove(writer->tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------//
+
+static bool _snapshot_map(const char* path, SnapshotFile* file)
+{
+	memset(file, 0, sizeof(SnapshotFile));
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mappingHandle)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file->base = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if(!file->base)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file->size = (uint64)size.QuadPart;
+	file->fileHandle = fileHandle;
+	file->mappingHandle = mappingHandle;
+#else
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //the mapping keeps the file alive
+	if(base == MAP_FAILED)
+		return false;
+
+	//the file is read front to back exactly once:
+	madvise(base, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	file->base = base;
+	file->size = (uint64)info.st_size;
+#endif
+
+	return true;
+}
+
+static void _snapshot_unmap(SnapshotFile* file)
+{
+	if(!file->base)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(file->base);
+	CloseHandle((HANDLE)file->mappingHandle);
+	CloseHandle((HANDLE)file->fileHandle);
+#else
+	munmap(file->base, (size_t)file->size);
+#endif
+
+	file->base = NULL;
+}
+
+//----------------------------------------------------------------------------//
+
+static void _snapshot_error_log(const char* message, const char* file, int32 line)
+{
+	printf("SNAPSHOT ERROR in %s at line %i - \"%s\"\n\n", file, line, message);
+}
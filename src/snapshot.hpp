@@ -0,0 +1,66 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "globals.hpp"
+#include <stdio.h>
+
+//----------------------------------------------------------------------------//
+
+//on-disk cache of generated particles. files are named after a hash of everything that affects generation, so a
+//changed parameter or shader is simply a different file and stale snapshots are never loaded
+
+#define SNAPSHOT_DIR "cache"
+#define SNAPSHOT_MAGIC 0x53474b56 //"VKGS"
+#define SNAPSHOT_VERSION 2 //2: particles store their type instead of the second orbit radius
+
+#define SNAPSHOT_HASH_INIT 0xcbf29ce484222325ull //FNV-1a 64-bit offset basis
+
+struct SnapshotHeader
+{
+	uint32 magic;
+	uint32 version;
+	uint64 key;
+
+	uint32 numParticles;
+	uint32 particleSize;
+};
+
+//a read-only, memory mapped snapshot file
+struct SnapshotFile
+{
+	const SnapshotHeader* header;
+	const void* data; //the particles, directly after the header
+
+	void* base;
+	uint64 size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+//a snapshot being written, goes to a temporary file that is renamed once complete so readers never see a partial one
+struct SnapshotWriter
+{
+	FILE* file;
+	char path[256];
+	char tempPath[260];
+	bool failed;
+};
+
+//----------------------------------------------------------------------------//
+
+//FNV-1a, chain calls starting from SNAPSHOT_HASH_INIT to hash several pieces
+uint64 snapshot_hash(uint64 hash, const void* data, uint64 size);
+void snapshot_path(uint64 key, char* path, uint32 maxLen);
+
+//returns false if the file does not exist or does not match the given key and layout
+bool snapshot_open(const char* path, uint64 key, uint32 numParticles, uint32 particleSize, SnapshotFile* file);
+void snapshot_close(SnapshotFile* file);
+
+//particles are written in pieces so they never have to be in host memory all at once
+bool snapshot_write_begin(SnapshotWriter* writer, const char* path, uint64 key, uint32 numParticles, uint32 particleSize);
+void snapshot_write(SnapshotWriter* writer, const void* data, uint64 size);
+bool snapshot_write_end(SnapshotWriter* writer);
+
+#endif
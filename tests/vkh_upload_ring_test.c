@@ -0,0 +1,219 @@
+#define QD_IMPLEMENTATION
+#include "libs/vkh/vkh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//----------------------------------------------------------------------------//
+
+//drives the upload context's staging ring past its end many times without a device. the Vulkan entry points it uses
+//are replaced below: copies record which staging bytes each batch reads, and waiting on a batch's fence releases
+//them. the test fails if a reservation overlaps bytes that a batch still reads, or a batch is reused before its
+//fence was waited on
+
+#define TEST_STAGING_SIZE 1024
+#define TEST_UPLOAD_COUNT 2000
+#define TEST_MAX_UPLOAD_SIZE 400
+#define TEST_MAX_RANGES 8192
+
+#define TEST_HANDLE(type, i) ((type)(uintptr_t)(i))
+
+typedef struct TestRange
+{
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t batch;
+	int live;
+} TestRange;
+
+static VKHuploadContext* g_context;
+static TestRange g_ranges[TEST_MAX_RANGES];
+static uint32_t g_rangeCount;
+
+static VkDeviceSize g_lastOffset;
+static uint32_t g_wraps;
+static int g_failed;
+
+//----------------------------------------------------------------------------//
+
+static uint32_t _test_batch_of_command_buffer(VkCommandBuffer commandBuffer)
+{
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+		if(g_context->batches[i].commandBuffer == commandBuffer)
+			return i;
+
+	printf("FAIL: unknown command buffer\n");
+	exit(1);
+}
+
+static uint32_t _test_batch_of_fence(VkFence fence)
+{
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+		if(g_context->batches[i].fence == fence)
+			return i;
+
+	printf("FAIL: unknown fence\n");
+	exit(1);
+}
+
+//----------------------------------------------------------------------------//
+
+VKAPI_ATTR void VKAPI_CALL vkCmdCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount,
+                                           const VkBufferCopy* regions)
+{
+	uint32_t batch = _test_batch_of_command_buffer(commandBuffer);
+
+	for(uint32_t i = 0; i < regionCount; i++)
+	{
+		VkDeviceSize offset = regions[i].srcOffset;
+		VkDeviceSize size = regions[i].size;
+
+		if(offset + size > TEST_STAGING_SIZE)
+		{
+			printf("FAIL: staging range [%llu, %llu) is past the end of the ring\n", (unsigned long long)offset, (unsigned long long)(offset + size));
+			g_failed = 1;
+		}
+
+		for(uint32_t j = 0; j < g_rangeCount; j++)
+		{
+			TestRange* range = &g_ranges[j];
+			if(range->live && offset < range->offset + range->size && range->offset < offset + size)
+			{
+				printf("FAIL: staging range [%llu, %llu) overlaps [%llu, %llu), still read by batch %u\n",
+				       (unsigned long long)offset, (unsigned long long)(offset + size),
+				       (unsigned long long)range->offset, (unsigned long long)(range->offset + range->size), range->batch);
+				g_failed = 1;
+			}
+		}
+
+		if(offset < g_lastOffset)
+			g_wraps++;
+		g_lastOffset = offset;
+
+		if(g_rangeCount == TEST_MAX_RANGES)
+		{
+			//drop ranges that are no longer read to make room:
+			uint32_t count = 0;
+			for(uint32_t j = 0; j < g_rangeCount; j++)
+				if(g_ranges[j].live)
+					g_ranges[count++] = g_ranges[j];
+			g_rangeCount = count;
+		}
+
+		TestRange range = {offset, size, batch, 1};
+		g_ranges[g_rangeCount++] = range;
+	}
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkWaitForFences(VkDevice device, uint32_t fenceCount, const VkFence* fences, VkBool32 waitAll, uint64_t timeout)
+{
+	for(uint32_t i = 0; i < fenceCount; i++)
+	{
+		uint32_t batch = _test_batch_of_fence(fences[i]);
+		for(uint32_t j = 0; j < g_rangeCount; j++)
+			if(g_ranges[j].batch == batch)
+				g_ranges[j].live = 0;
+	}
+
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkResetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags flags)
+{
+	uint32_t batch = _test_batch_of_command_buffer(commandBuffer);
+	for(uint32_t i = 0; i < g_rangeCount; i++)
+	{
+		if(g_ranges[i].live && g_ranges[i].batch == batch)
+		{
+			printf("FAIL: batch %u is reset before its fence was waited on\n", batch);
+			g_failed = 1;
+			break;
+		}
+	}
+
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo* beginInfo)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+                                                VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* memoryBarriers,
+                                                uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* bufferMemoryBarriers,
+                                                uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* imageMemoryBarriers)
+{
+
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* submits, VkFence fence)
+{
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkResetFences(VkDevice device, uint32_t fenceCount, const VkFence* fences)
+{
+	return VK_SUCCESS;
+}
+
+//----------------------------------------------------------------------------//
+
+int main()
+{
+	static VKHinstance inst;
+	static VKHuploadContext context;
+	static uint8_t staging[TEST_STAGING_SIZE];
+	static uint8_t data[TEST_STAGING_SIZE * 2];
+
+	context.stagingSize = TEST_STAGING_SIZE;
+	context.stagingMapped = staging;
+	context.head = 0;
+	context.curBatch = 0;
+	for(uint32_t i = 0; i < VKH_UPLOAD_BATCH_COUNT; i++)
+	{
+		context.batches[i].commandBuffer = TEST_HANDLE(VkCommandBuffer, i + 1);
+		context.batches[i].fence = TEST_HANDLE(VkFence, i + 1);
+		context.batches[i].state = VKH_UPLOAD_BATCH_IDLE;
+		context.batches[i].stagingStart = 0;
+	}
+
+	g_context = &context;
+
+	//odd sizes so allocations need aligning and often straddle the end of the ring, with a flush every few uploads
+	//so several batches are pending at once:
+	uint32_t seed = 12345;
+	for(uint32_t i = 0; i < TEST_UPLOAD_COUNT; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		VkDeviceSize size = 1 + (seed >> 8) % TEST_MAX_UPLOAD_SIZE;
+
+		vkh_upload_buffer(&context, &inst, TEST_HANDLE(VkBuffer, 1), 0, size, data);
+
+		if((seed >> 4) % 3 == 0)
+			vkh_upload_flush(&context, &inst);
+	}
+
+	//an upload larger than the ring is split:
+	vkh_upload_buffer(&context, &inst, TEST_HANDLE(VkBuffer, 1), 0, sizeof(data), data);
+
+	vkh_upload_flush(&context, &inst);
+	vkh_upload_wait(&context, &inst);
+
+	if(g_wraps == 0)
+	{
+		printf("FAIL: the staging ring never wrapped\n");
+		g_failed = 1;
+	}
+
+	if(g_failed)
+		return 1;
+
+	printf("PASS: %u uploads, the staging ring wrapped %u times\n", TEST_UPLOAD_COUNT + 1, g_wraps);
+	return 0;
+}